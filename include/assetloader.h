@@ -0,0 +1,53 @@
+#ifndef TRABALHO_FINAL_FCG_ASSETLOADER_H
+#define TRABALHO_FINAL_FCG_ASSETLOADER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Carregamento assíncrono de recursos (texturas, modelos, ...).
+//
+// Cada recurso é um "job" dividido em duas partes:
+//  - "work" executa em uma thread de trabalho e faz tudo que não precisa de
+//    OpenGL (leitura do disco, decodificação de imagens, processamento de
+//    malhas). Erros são reportados lançando uma exceção (std::exception).
+//  - "finish" executa na thread principal, que é a única com o contexto
+//    OpenGL, e envia o resultado para a GPU.
+// Os dois lados normalmente compartilham os dados através de um
+// std::shared_ptr capturado pelas duas funções.
+//
+// Jobs terminados ficam em uma fila de conclusão até que a thread principal
+// chame AssetLoader_ProcessCompleted(), tipicamente uma vez por quadro, entre
+// chamadas a glfwPollEvents().
+
+typedef std::function<void()> AssetJobFunction;
+
+struct AssetLoaderProgress
+{
+    size_t      num_submitted; // Jobs submetidos desde AssetLoader_Init()
+    size_t      num_finished;  // Jobs cujo "finish" já foi executado
+    std::string last_finished; // Nome do último job concluído
+};
+
+// Cria as threads de trabalho. Se num_threads == 0, utiliza uma thread a
+// menos que o número de núcleos (pelo menos uma).
+void AssetLoader_Init(unsigned int num_threads = 0);
+
+// Descarta os jobs que ainda não começaram, espera os que estão em execução
+// e termina as threads de trabalho.
+void AssetLoader_Shutdown();
+
+// Enfileira um job. "name" é utilizado somente para mensagens.
+void AssetLoader_Submit(const std::string& name, AssetJobFunction work, AssetJobFunction finish);
+
+// Executa o "finish" dos jobs concluídos, em ordem de conclusão, por no
+// máximo "max_seconds" segundos (pelo menos um job é processado, se houver).
+// Retorna false se algum job falhou; neste caso "error" recebe a mensagem.
+bool AssetLoader_ProcessCompleted(double max_seconds, std::string* error);
+
+AssetLoaderProgress AssetLoader_Progress();
+
+// Todos os jobs submetidos já foram concluídos na thread principal?
+bool AssetLoader_Idle();
+
+#endif //TRABALHO_FINAL_FCG_ASSETLOADER_H
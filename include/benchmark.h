@@ -0,0 +1,32 @@
+#ifndef TRABALHO_FINAL_FCG_BENCHMARK_H
+#define TRABALHO_FINAL_FCG_BENCHMARK_H
+
+#include <cstddef>
+
+#include "renderqueue.h"
+
+// Coleta de medidas do modo "--headless --frames N" (veja main.cpp), que
+// executa o loop de quadros completo sem interação do usuário e escreve os
+// resultados em um arquivo JSON, para acompanhar regressões de desempenho.
+
+// Descarta as medidas anteriores e reserva espaço para "num_frames" quadros.
+void Benchmark_Begin(size_t num_frames);
+
+// Registra um quadro: tempo de CPU em segundos, do início do quadro até o
+// retorno de glfwSwapBuffers(), e os contadores da fila de renderização.
+void Benchmark_RecordFrame(double cpu_seconds, const RenderQueueStats& stats);
+
+// Escreve em "path" os percentis do tempo por quadro e a média e o total
+// de cada contador. "renderer" é a string GL_RENDERER, para identificar a
+// máquina. Retorna false se o arquivo não pode ser escrito.
+bool Benchmark_WriteJson(const char* path, const char* renderer, double load_seconds, double steps_per_second);
+
+// Microbenchmark do modo "--bench-collisions N": compara os testes de colisão
+// de um par de objetos (checkSphereSphereCollision() etc.) chamados em um
+// laço com as funções "Batch" de collisions.h, em cada conjunto de
+// instruções suportado pelo processador, sobre N objetos aleatórios.
+// Imprime o tempo por objeto na saída padrão e retorna false se alguma
+// versão discorda do laço escalar.
+bool Benchmark_Collisions(size_t num_objects, int repetitions);
+
+#endif //TRABALHO_FINAL_FCG_BENCHMARK_H
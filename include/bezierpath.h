@@ -0,0 +1,91 @@
+#ifndef TRABALHO_FINAL_FCG_BEZIERPATH_H
+#define TRABALHO_FINAL_FCG_BEZIERPATH_H
+
+#include <cstddef>
+
+#include <glm/vec3.hpp>
+
+// Curva de Bézier cúbica percorrida com velocidade constante.
+//
+// O parâmetro t de uma curva de Bézier não é proporcional à distância
+// percorrida: avançar t a uma taxa fixa faz o objeto acelerar e frear ao
+// longo da curva. Por isso, quando a curva é criada, BezierPath_Init() monta
+// uma tabela com o comprimento de arco s(t) em pontos igualmente espaçados
+// de t. A posição a uma distância "s" do início é obtida invertendo a
+// tabela (busca binária e interpolação linear entre duas amostras).
+
+// Número de intervalos da tabela de comprimento de arco.
+#define BEZIERPATH_ARC_LENGTH_SAMPLES 64
+
+struct BezierPath
+{
+    glm::vec3 control_points[4];
+    float     length; // Comprimento total (aproximado) da curva
+    float     arc_lengths[BEZIERPATH_ARC_LENGTH_SAMPLES + 1]; // s(i / BEZIERPATH_ARC_LENGTH_SAMPLES)
+};
+
+void BezierPath_Init(BezierPath* path, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3);
+
+// Ponto da curva no parâmetro t em [0,1].
+glm::vec3 BezierPath_Point(const BezierPath& path, float t);
+
+// Parâmetro t do ponto a uma distância "distance" do início, medida ao longo
+// da curva. Distâncias fora de [0, length] são limitadas a esse intervalo.
+float BezierPath_ParameterAtDistance(const BezierPath& path, float distance);
+
+glm::vec3 BezierPath_PointAtDistance(const BezierPath& path, float distance);
+
+// Como BezierPath_PointAtDistance(), para "count" curvas de uma vez: o ponto
+// i é o da curva paths[i] a uma distância distances[i] do seu início. Os
+// polinômios são avaliados para 4 curvas por instrução (SSE), quando
+// disponível.
+void BezierPath_PointsAtDistances(const BezierPath* const* paths, const float* distances, size_t count,
+                                  glm::vec3* points);
+
+// Caminho sem fim formado por curvas de Bézier, uma emendada na outra,
+// passando por pontos sorteados. As próximas curvas são geradas com
+// antecedência e guardadas em um buffer circular de tamanho fixo, dentro da
+// própria estrutura: avançar pelo caminho nunca aloca memória.
+//
+// As tangentes nos pontos de passagem são as de uma spline de Catmull-Rom,
+// iguais dos dois lados de cada emenda (continuidade C1). Como o caminho é
+// percorrido com velocidade constante, a velocidade do objeto não muda
+// bruscamente nas emendas.
+
+#define BEZIERPATH_STREAM_SEGMENTS 4
+
+// Região, no plano XZ com altura "y" fixa, que contém o caminho. Os pontos
+// de passagem são sorteados pelo menos "margin" para dentro da região; as
+// tangentes são encurtadas quando necessário para que todos os pontos de
+// controle (e portanto as curvas) fiquem dentro dela.
+struct BezierPathBounds
+{
+    float min_x, max_x;
+    float min_z, max_z;
+    float y;
+    float margin;
+};
+
+struct BezierPathStream
+{
+    BezierPathBounds bounds;
+    BezierPath segments[BEZIERPATH_STREAM_SEGMENTS]; // Buffer circular
+    int        current;  // Curva sendo percorrida; as seguintes vêm depois dela no buffer
+    float      distance; // Distância percorrida ao longo da curva atual
+    glm::vec3  next_waypoint; // Ponto de passagem depois do fim da última curva
+};
+
+// Descarta as curvas existentes e gera novas a partir de "start". Os pontos
+// são sorteados com rand().
+void BezierPathStream_Init(BezierPathStream* stream, const BezierPathBounds& bounds, const glm::vec3& start);
+
+// Avança "distance" ao longo do caminho. Cada curva terminada é substituída,
+// na mesma posição do buffer, por uma nova curva no fim do caminho.
+void BezierPathStream_Advance(BezierPathStream* stream, float distance);
+
+inline const BezierPath& BezierPathStream_Current(const BezierPathStream& stream)
+{
+    return stream.segments[stream.current];
+}
+
+#endif //TRABALHO_FINAL_FCG_BEZIERPATH_H
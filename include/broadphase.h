@@ -0,0 +1,64 @@
+#ifndef TRABALHO_FINAL_FCG_BROADPHASE_H
+#define TRABALHO_FINAL_FCG_BROADPHASE_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "collisions.h"
+
+// Grade uniforme sobre o plano XZ da arena, utilizada como "broadphase": em
+// vez de testar a câmera ou um tiro contra todos os objetos, testamos somente
+// os objetos registrados nas células que a esfera, caixa ou raio atravessa.
+//
+// Cada objeto é identificado por um inteiro (tipicamente seu índice em um
+// vetor) e representado por uma AABB. Um objeto é registrado em todas as
+// células que sua AABB cobre; Broadphase_Update() só mexe nas listas das
+// células quando esse conjunto de células muda, o que para objetos que se
+// movem pouco a cada passo da simulação é raro. Objetos que saem da grade
+// são registrados nas células da borda e também em uma lista à parte, que
+// os raios sempre testam (eles podem ser atingidos fora das células).
+struct BroadphaseEntry
+{
+    AABB     box;
+    int      cell_min_x, cell_min_z; // Células cobertas pela AABB (inclusivo)
+    int      cell_max_x, cell_max_z;
+    bool     active;
+    bool     outside; // A AABB passa dos limites da grade? Veja "outside" abaixo
+    uint32_t query_stamp; // Evita testar duas vezes um objeto em várias células
+};
+
+struct BroadphaseGrid
+{
+    float min_x, min_z;
+    float cell_size;
+    int   num_cells_x, num_cells_z;
+    std::vector<std::vector<uint32_t> > cells; // Objetos de cada célula, linha a linha em Z
+    std::vector<BroadphaseEntry>        entries; // Indexado pelo identificador do objeto
+    std::vector<uint32_t>               outside; // Objetos cuja AABB não está inteira dentro da grade
+    uint32_t query_stamp;
+};
+
+// Cobre o retângulo [min_x,max_x] x [min_z,max_z] com células quadradas.
+void Broadphase_Init(BroadphaseGrid* grid, float min_x, float min_z, float max_x, float max_z, float cell_size);
+
+// Insere o objeto "id", ou atualiza sua AABB se ele já está na grade.
+void Broadphase_Update(BroadphaseGrid* grid, uint32_t id, const AABB& box);
+void Broadphase_Remove(BroadphaseGrid* grid, uint32_t id);
+
+// Acrescenta em "result" os objetos cuja AABB intercepta "box".
+void Broadphase_QueryAABB(BroadphaseGrid* grid, const AABB& box, std::vector<uint32_t>* result);
+
+// Teste exato de um raio contra um objeto: retorna true se há interseção e
+// escreve em "distance" o parâmetro t do ponto atingido no raio.
+typedef std::function<bool(uint32_t id, float* distance)> BroadphaseRayTest;
+
+// Percorre as células atravessadas pelo raio em ordem (algoritmo de
+// Amanatides e Woo), chamando "hit_test" para os objetos cuja AABB é
+// atingida, e para assim que nenhuma célula restante pode conter uma
+// interseção mais próxima. Retorna o objeto atingido mais próximo com
+// t <= max_distance, se algum.
+bool Broadphase_Raycast(BroadphaseGrid* grid, const Ray& ray, float max_distance, const BroadphaseRayTest& hit_test,
+                        uint32_t* hit_id, float* hit_distance);
+
+#endif //TRABALHO_FINAL_FCG_BROADPHASE_H
@@ -0,0 +1,52 @@
+#ifndef TRABALHO_FINAL_FCG_BVH_H
+#define TRABALHO_FINAL_FCG_BVH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "collisions.h"
+
+// Bounding Volume Hierarchy sobre os triângulos de uma malha, para testes
+// exatos de raios contra a geometria (por exemplo, tiros), em vez de somente
+// contra a bounding box do modelo.
+//
+// A árvore é construída uma única vez, quando o modelo é carregado, pela
+// heurística de área de superfície (SAH) avaliada em "bins" ao longo de cada
+// eixo. Veja Wald, "On fast Construction of SAH-based Bounding Volume
+// Hierarchies" (2007).
+
+// Nó da árvore, com 32 bytes. Nós internos têm count == 0 e seus filhos em
+// nodes[first] e nodes[first + 1]; folhas têm "count" triângulos a partir do
+// triângulo "first" (na ordem da árvore, veja MeshBvh).
+struct BvhNode
+{
+    float    bbox_min[3];
+    uint32_t first;
+    float    bbox_max[3];
+    uint32_t count;
+};
+
+struct MeshBvh
+{
+    std::vector<BvhNode>   nodes; // nodes[0] é a raiz
+    std::vector<glm::vec3> triangles; // Três vértices por triângulo, na ordem das folhas
+    std::vector<uint32_t>  triangle_ids; // Índice original de cada triângulo acima
+};
+
+// "vertices" contém os três vértices de cada um dos "num_triangles" triângulos.
+void MeshBvh_Build(MeshBvh* bvh, const glm::vec3* vertices, size_t num_triangles);
+
+struct BvhHit
+{
+    float    distance; // Parâmetro t do ponto atingido: origin + t*direction
+    uint32_t triangle; // Índice do triângulo, na numeração passada para MeshBvh_Build()
+};
+
+// Triângulo mais próximo atingido pelo raio com t em [0, max_distance].
+// Os dois lados dos triângulos são considerados.
+bool MeshBvh_Raycast(const MeshBvh& bvh, const Ray& ray, float max_distance, BvhHit* hit);
+
+#endif //TRABALHO_FINAL_FCG_BVH_H
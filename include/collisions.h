@@ -1,6 +1,11 @@
 #ifndef TRABALHO_FINAL_FCG_COLLISIONS_H
 #define TRABALHO_FINAL_FCG_COLLISIONS_H
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
 struct Sphere {
@@ -26,5 +31,100 @@ struct AABB {
 bool checkSpherePlaneCollision(const Sphere& sphere, const Plane& plane);
 bool checkSphereSphereCollision(const Sphere& s1, const Sphere& s2);
 bool checkRayAABBCollision(const Ray& ray, const AABB& box);
+// Como acima, retornando em "distance" o parâmetro t >= 0 do ponto de entrada
+// do raio na caixa (origin + t*direction).
+bool checkRayAABBCollision(const Ray& ray, const AABB& box, float* distance);
+bool checkAABBAABBCollision(const AABB& box1, const AABB& box2);
+
+// Pirâmide de visão ("view frustum") da câmera: seis planos com as normais
+// apontando para dentro, de forma que um ponto é visível se a distância com
+// sinal a todos os planos é >= 0.
+struct Frustum {
+    Plane planes[6]; // Esquerda, direita, baixo, cima, near e far
+};
+
+// Extrai os planos de uma matriz "projection * view" (ou
+// "projection * view * model", com os planos no espaço do modelo). Veja
+// Gribb e Hartmann, "Fast Extraction of Viewing Frustum Planes from the
+// World-View-Projection Matrix" (2001).
+Frustum extractFrustum(const glm::mat4& clip_matrix);
+// Retornam false somente se o objeto está com certeza fora do frustum.
+bool checkFrustumAABBCollision(const Frustum& frustum, const AABB& box);
+bool checkFrustumSphereCollision(const Frustum& frustum, const Sphere& sphere);
+
+// AABB que contém "box" transformada pela matriz (afim) "model".
+AABB transformAABB(const AABB& box, const glm::mat4& model);
+
+// Testes contínuos ("swept"): cada esfera se move em linha reta de
+// "center" até "center + displacement" durante o passo de tempo. Se há
+// contato, "time" recebe a fração t em [0,1] do passo em que ele começa
+// (time of impact). Esferas que já se tocam no início e estão se afastando
+// não colidem, para que um objeto possa sair de um contato.
+//
+// "normal" recebe a normal do plano do lado em que está a esfera.
+bool sweepSpherePlane(const Sphere& sphere, const glm::vec3& displacement, const Plane& plane,
+                      float* time, glm::vec3* normal);
+bool sweepSphereSphere(const Sphere& sphere1, const glm::vec3& displacement1,
+                       const Sphere& sphere2, const glm::vec3& displacement2, float* time);
+
+// Move a esfera por "displacement", parando no primeiro plano atingido e
+// deslizando ao longo dele pelo restante do deslocamento (a componente na
+// direção da normal é descartada). Retorna a posição final do centro.
+glm::vec3 moveSphereWithSliding(const Sphere& sphere, glm::vec3 displacement, const Plane* planes, size_t num_planes);
+
+// Testes de um objeto contra N objetos de uma vez. Os objetos ficam em
+// "Structure of Arrays" (um vetor para cada coordenada), de forma que as
+// funções abaixo testam 4 (SSE) ou 8 (AVX2) objetos por instrução.
+//
+// O resultado é uma máscara com um bit por objeto: o objeto i colidiu se
+// o bit (i % 32) de hit_mask[i / 32] está ligado. "hit_mask" deve ter
+// COLLISION_MASK_WORDS(N) elementos. As funções retornam o número de
+// colisões.
+#define COLLISION_MASK_WORDS(count) (((count) + 31) / 32)
+
+struct SphereBatch {
+    std::vector<float> center_x, center_y, center_z;
+    std::vector<float> radius;
+};
+
+struct PlaneBatch {
+    std::vector<float> normal_x, normal_y, normal_z;
+    std::vector<float> distance;
+};
+
+struct AABBBatch {
+    std::vector<float> min_x, min_y, min_z;
+    std::vector<float> max_x, max_y, max_z;
+};
+
+void clearBatch(SphereBatch* batch);
+void clearBatch(PlaneBatch* batch);
+void clearBatch(AABBBatch* batch);
+void addToBatch(SphereBatch* batch, const Sphere& sphere);
+void addToBatch(PlaneBatch* batch, const Plane& plane);
+void addToBatch(AABBBatch* batch, const AABB& box);
+
+size_t checkSphereSphereCollisionBatch(const Sphere& sphere, const SphereBatch& spheres, uint32_t* hit_mask);
+// "signed_distances", se não for NULL, recebe a distância com sinal do
+// centro da esfera a cada plano.
+size_t checkSpherePlaneCollisionBatch(const Sphere& sphere, const PlaneBatch& planes, uint32_t* hit_mask,
+                                      float* signed_distances);
+// "distances", se não for NULL, recebe para cada caixa o mesmo valor de
+// checkRayAABBCollision(ray, box, &distance), ou FLT_MAX se não há colisão.
+size_t checkRayAABBCollisionBatch(const Ray& ray, const AABBBatch& boxes, uint32_t* hit_mask, float* distances);
+
+// Conjunto de instruções utilizado pelas funções "Batch" acima. Por padrão
+// é o melhor suportado pelo processador, detectado na inicialização.
+enum CollisionSimdLevel {
+    COLLISION_SIMD_SCALAR,
+    COLLISION_SIMD_SSE,
+    COLLISION_SIMD_AVX2,
+};
+
+CollisionSimdLevel getSupportedCollisionSimdLevel();
+CollisionSimdLevel getCollisionSimdLevel();
+// Níveis acima do suportado pelo processador são reduzidos ao suportado.
+void setCollisionSimdLevel(CollisionSimdLevel level);
+const char* collisionSimdLevelName(CollisionSimdLevel level);
 
-#endif //TRABALHO_FINAL_FCG_COLLISIONS_H
\ No newline at end of file
+#endif //TRABALHO_FINAL_FCG_COLLISIONS_H
@@ -0,0 +1,60 @@
+#ifndef TRABALHO_FINAL_FCG_MATERIAL_H
+#define TRABALHO_FINAL_FCG_MATERIAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+
+// Materiais dos objetos da cena.
+//
+// Cada material declara o conjunto de recursos ("features") que usa para
+// calcular a cor difusa. Cada conjunto diferente é uma permutação de
+// "shader_fragment.glsl": os recursos são injetados como "#define"s
+// (veja Material_ShaderDefines()) e cada permutação é compilada como um
+// programa de GPU separado, que contém somente o código e os samplers de
+// que precisa. Os parâmetros numéricos (cores, expoente de Phong, unidade de
+// textura) são "uniforms", enviados pela fila de renderização quando o
+// material muda (veja renderqueue.h).
+
+enum MaterialFeature
+{
+    MATERIAL_VERTEX_COLOR = 1 << 0, // Cor do vértice, sem iluminação (arestas pretas com "render_as_black")
+    MATERIAL_FLAT_COLOR   = 1 << 1, // Kd constante, com iluminação de Phong
+    MATERIAL_TEXTURED     = 1 << 2, // Kd de uma textura, nas coordenadas de textura do vértice
+    MATERIAL_TRIPLANAR    = 1 << 3, // Kd de uma textura, projetada nos três planos do mundo
+};
+
+// Valores possíveis de uma máscara de MaterialFeature. Tamanho das tabelas
+// indexadas por permutação.
+#define MATERIAL_NUM_PERMUTATIONS 16
+
+struct Material
+{
+    const char* name;
+    uint32_t    features;      // Máscara de MaterialFeature
+    glm::vec3   diffuse;       // Kd, utilizado somente com MATERIAL_FLAT_COLOR
+    glm::vec3   specular;      // Ks
+    float       shininess;     // Expoente q de Phong
+    GLint       texture_unit;  // TextureImageN amostrada com MATERIAL_TEXTURED ou MATERIAL_TRIPLANAR
+    float       texture_scale; // Coordenadas de textura por unidade do mundo (MATERIAL_TRIPLANAR)
+};
+
+// Material de um "object_id" (veja as chamadas de DrawVirtualObject() em
+// main.cpp). Identificadores desconhecidos recebem um material preto.
+const Material* Material_ForObjectId(GLint object_id);
+
+// Permutações utilizadas por algum material, sem repetições.
+size_t Material_NumPermutations();
+uint32_t Material_Permutation(size_t index);
+
+// "#define"s que selecionam uma permutação de "shader_fragment.glsl".
+std::string Material_ShaderDefines(uint32_t features);
+
+// Nome curto de uma permutação (por exemplo "textured"), para mensagens e
+// nomes de arquivos de cache.
+std::string Material_PermutationName(uint32_t features);
+
+#endif //TRABALHO_FINAL_FCG_MATERIAL_H
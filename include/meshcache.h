@@ -0,0 +1,78 @@
+#ifndef TRABALHO_FINAL_FCG_MESHCACHE_H
+#define TRABALHO_FINAL_FCG_MESHCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vertexformat.h"
+
+// Número máximo de caracteres (incluindo o '\0') do nome de um objeto
+// armazenado no cache.
+#define MESHCACHE_MAX_NAME 64
+
+// Descreve um objeto (shape) de um arquivo ".obj" dentro dos buffers de uma
+// malha. Esta estrutura é gravada diretamente no arquivo de cache, por isso
+// utiliza somente tipos de tamanho fixo.
+//
+// Cada objeto tem seu próprio conjunto de vértices únicos, começando em
+// "base_vertex", e seus índices são relativos a este primeiro vértice. Isso
+// permite utilizar índices de 16 bits sempre que o objeto tem no máximo
+// 65536 vértices, mesmo que a malha inteira tenha mais que isso.
+struct MeshShape
+{
+    char     name[MESHCACHE_MAX_NAME]; // Nome do objeto
+    uint32_t first_index;              // Posição do primeiro índice, em unidades de "index_size"
+    uint32_t num_indices;              // Número de índices do objeto
+    uint32_t index_size;               // 2 (uint16_t) ou 4 (uint32_t) bytes por índice
+    uint32_t base_vertex;              // Primeiro vértice do objeto dentro dos vetores de atributos
+    uint32_t num_vertices;             // Número de vértices únicos do objeto
+    float    bbox_min[3];              // Axis-Aligned Bounding Box do objeto
+    float    bbox_max[3];
+};
+
+// Geometria de um arquivo ".obj" já processada (normais computadas e
+// vértices repetidos unificados), pronta para ser enviada para a GPU. Os
+// vértices estão no formato VERTEX_FORMAT_PACKED (veja vertexformat.h).
+struct MeshGeometry
+{
+    std::vector<MeshShape>    shapes;
+    std::vector<PackedVertex> vertices;
+    std::vector<uint8_t>      indices; // Índices de todos os objetos, cada um com seu "index_size"
+};
+
+// Visão somente-leitura dos dados de uma malha. Os ponteiros podem apontar
+// tanto para os vetores de uma MeshGeometry quanto diretamente para um
+// arquivo de cache mapeado em memória.
+struct MeshView
+{
+    const MeshShape* shapes;
+    uint32_t         num_shapes;
+    const PackedVertex* vertices;
+    uint32_t         num_vertices;
+    const uint8_t*   indices;
+    uint32_t         indices_size; // Tamanho do buffer de índices em bytes
+};
+
+// Arquivo de cache aberto e mapeado em memória. Veja MeshCache_Open().
+struct MeshCache
+{
+    void*    data;   // Início do mapeamento
+    size_t   size;   // Tamanho do mapeamento em bytes
+    void*    file;   // Handles específicos do sistema operacional
+    void*    mapping;
+    MeshView view;   // Aponta para dentro de "data"
+};
+
+MeshView MeshGeometry_View(const MeshGeometry& geometry);
+
+// Abre o cache binário correspondente ao arquivo ".obj" indicado. Retorna
+// false se o cache não existe, é de uma versão diferente, está corrompido,
+// ou se o arquivo ".obj" foi modificado desde que o cache foi escrito.
+bool MeshCache_Open(MeshCache* cache, const char* obj_filename);
+void MeshCache_Close(MeshCache* cache);
+
+// Escreve o cache binário da geometria extraída do arquivo ".obj" indicado.
+bool MeshCache_Write(const char* obj_filename, const MeshGeometry& geometry);
+
+#endif //TRABALHO_FINAL_FCG_MESHCACHE_H
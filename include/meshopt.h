@@ -0,0 +1,47 @@
+#ifndef TRABALHO_FINAL_FCG_MESHOPT_H
+#define TRABALHO_FINAL_FCG_MESHOPT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Funções de otimização de malhas de triângulos indexadas (GL_TRIANGLES),
+// executadas uma única vez quando um modelo é processado (o resultado fica
+// salvo no cache de malhas, veja meshcache.h).
+
+// Estatísticas de um buffer de índices em relação a um cache de vértices
+// pós-transformação do tipo FIFO, como o das GPUs.
+struct VertexCacheStatistics
+{
+    uint32_t vertices_transformed; // Número de execuções do Vertex Shader (cache misses)
+    float    acmr; // Average Cache Miss Ratio: vertices_transformed / número de triângulos (ideal ~0.5)
+    float    atvr; // Average Transformed Vertex Ratio: vertices_transformed / número de vértices (ideal 1.0)
+};
+
+// Tamanho do cache FIFO simulado por AnalyzeVertexCache().
+#define MESHOPT_FIFO_CACHE_SIZE 16
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t num_indices, size_t num_vertices,
+                                         unsigned int cache_size = MESHOPT_FIFO_CACHE_SIZE);
+
+// Reordena os triângulos para maximizar o reaproveitamento do cache de
+// vértices, utilizando o algoritmo de Tom Forsyth ("Linear-Speed Vertex Cache
+// Optimisation"). Veja https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+void OptimizeVertexCache(uint32_t* indices, size_t num_indices, size_t num_vertices);
+
+// Reordena grupos de triângulos (delimitados onde o cache de vértices já
+// estaria vazio, de forma que a eficiência do cache não muda) para que os
+// grupos voltados para fora do modelo sejam desenhados primeiro, reduzindo
+// "overdraw". "positions" aponta para o X Y Z do primeiro vértice e
+// "stride" é a distância em bytes entre dois vértices.
+void OptimizeOverdraw(uint32_t* indices, size_t num_indices, const float* positions, size_t stride,
+                      size_t num_vertices);
+
+// Renumera os vértices na ordem em que são utilizados pelo buffer de índices,
+// tornando a leitura dos atributos pela GPU sequencial. Os índices são
+// reescritos e remap[antigo] = novo (ou ~0u para vértices não utilizados).
+// Retorna o número de vértices utilizados.
+size_t OptimizeVertexFetchRemap(uint32_t* indices, size_t num_indices, size_t num_vertices,
+                                std::vector<uint32_t>* remap);
+
+#endif //TRABALHO_FINAL_FCG_MESHOPT_H
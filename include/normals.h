@@ -0,0 +1,27 @@
+#ifndef TRABALHO_FINAL_FCG_NORMALS_H
+#define TRABALHO_FINAL_FCG_NORMALS_H
+
+#include <cstddef>
+#include <vector>
+
+// Computa normais de vértices pelo método de Gouraud: a normal de um vértice
+// é a média das normais de todos os triângulos que o compartilham e que
+// pertencem ao mesmo "smoothing group". Uma normal é criada para cada par
+// (vértice, smoothing group) utilizado.
+//
+// Entradas:
+//  - positions: X Y Z de cada um dos "num_positions" vértices;
+//  - corner_vertices: para cada um dos 3*num_triangles cantos de triângulo, o
+//    índice do vértice em "positions";
+//  - triangle_sgroups: o smoothing group de cada triângulo.
+// Saídas:
+//  - normals: recebe X Y Z de cada normal criada (é sobrescrito);
+//  - corner_normals: para cada canto de triângulo, o índice da sua normal.
+//
+// Todos os grupos são processados em uma única passada sobre os triângulos,
+// dividida entre várias threads (veja parallel.h).
+void ComputeSmoothNormals(const float* positions, size_t num_positions,
+                          const int* corner_vertices, const unsigned int* triangle_sgroups, size_t num_triangles,
+                          std::vector<float>* normals, int* corner_normals);
+
+#endif //TRABALHO_FINAL_FCG_NORMALS_H
@@ -0,0 +1,17 @@
+#ifndef TRABALHO_FINAL_FCG_PARALLEL_H
+#define TRABALHO_FINAL_FCG_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// Número de threads utilizadas por ParallelFor() (pelo menos 1).
+unsigned int Parallel_NumThreads();
+
+// Divide o intervalo [0, count) em blocos contíguos e chama
+// "function(begin, end)" para cada bloco, em paralelo, utilizando até
+// Parallel_NumThreads() threads. Cada bloco tem pelo menos "min_chunk"
+// elementos; se houver apenas um bloco, ele é processado na própria thread
+// que chamou a função. Retorna somente quando todos os blocos terminaram.
+void ParallelFor(size_t count, size_t min_chunk, const std::function<void(size_t begin, size_t end)>& function);
+
+#endif //TRABALHO_FINAL_FCG_PARALLEL_H
@@ -0,0 +1,69 @@
+#ifndef TRABALHO_FINAL_FCG_PROFILER_H
+#define TRABALHO_FINAL_FCG_PROFILER_H
+
+#include <cstdint>
+
+// Medição do tempo gasto em cada parte de um quadro.
+//
+// O código de main.cpp marca as seções abaixo com PROFILE_SCOPE(). Para cada
+// quadro guardamos, em um buffer circular com os últimos
+// PROFILER_HISTORY_FRAMES quadros, o tempo de CPU de cada seção e cada
+// ocorrência individual (para o arquivo de "trace"). As seções marcadas como
+// "GPU" também são medidas com queries GL_TIME_ELAPSED, cujos resultados são
+// lidos alguns quadros depois, sem esperar pela GPU.
+enum ProfileSection
+{
+    PROFILE_SIMULATION, // Passos da simulação (inclui PROFILE_COLLISION)
+    PROFILE_COLLISION,  // Testes de colisão dentro da simulação
+    PROFILE_SCENE_DRAW, // Montagem e envio da fila de renderização (CPU e GPU)
+    PROFILE_HUD_TEXT,   // Texto na tela (CPU e GPU)
+    PROFILE_SWAP,       // glfwSwapBuffers()
+    PROFILE_NUM_SECTIONS
+};
+
+#define PROFILER_HISTORY_FRAMES 240
+
+// Devem ser chamadas com o contexto OpenGL atual.
+void Profiler_Init();
+void Profiler_Shutdown();
+
+// Delimitam um quadro. Profiler_BeginFrame() também recolhe os resultados
+// das queries da GPU de quadros anteriores que já estão prontos.
+void Profiler_BeginFrame();
+void Profiler_EndFrame();
+
+// Delimitam uma ocorrência de uma seção. Seções podem ser aninhadas, mas uma
+// seção não pode conter a si mesma.
+void Profiler_Begin(ProfileSection section);
+void Profiler_End(ProfileSection section);
+
+struct ProfileScope
+{
+    explicit ProfileScope(ProfileSection section) : section(section) { Profiler_Begin(section); }
+    ~ProfileScope() { Profiler_End(section); }
+    ProfileSection section;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(section) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(section)
+
+const char* Profiler_SectionName(ProfileSection section);
+
+// Médias, em milissegundos, sobre os quadros do buffer circular. Seções sem
+// medida na GPU (ou cujos resultados ainda não chegaram) retornam gpu_ms < 0.
+struct ProfileSummary
+{
+    uint32_t num_frames;
+    double   frame_ms;
+    double   cpu_ms[PROFILE_NUM_SECTIONS];
+    double   gpu_ms[PROFILE_NUM_SECTIONS];
+};
+ProfileSummary Profiler_Summary();
+
+// Escreve os quadros do buffer circular no formato "Trace Event" do Chrome
+// (abra em chrome://tracing ou https://ui.perfetto.dev). Os tempos de GPU
+// aparecem em uma linha própria, alinhados com o início da seção na CPU.
+bool Profiler_WriteChromeTrace(const char* path);
+
+#endif //TRABALHO_FINAL_FCG_PROFILER_H
@@ -0,0 +1,140 @@
+#ifndef TRABALHO_FINAL_FCG_RENDERQUEUE_H
+#define TRABALHO_FINAL_FCG_RENDERQUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "material.h"
+
+// Fila de renderização: em vez de chamar OpenGL diretamente, o código de
+// desenho acrescenta "DrawItem"s na fila durante o quadro. Em
+// RenderQueue_Flush() os itens são ordenados por programa de GPU (uma
+// permutação por conjunto de recursos de material, veja material.h),
+// textura, VAO e material, e enviados para a GPU com um cache do estado
+// atual, de forma que binds e escritas de "uniforms" que não mudam nada são
+// omitidos. As texturas ficam ligadas cada uma em sua unidade (veja
+// LoadTextureImage()); trocar de textura é trocar a unidade amostrada pelo
+// sampler "TextureImage", escolhida pelo material.
+//
+// Vários objetos com a mesma malha podem ser desenhados com uma única chamada
+// através de RenderQueue_PushInstanced(): as matrizes "model" e de normais de
+// cada cópia vão para um VBO de instâncias (atributos ATTRIB_INSTANCE_*, veja
+// vertexformat.h) e o desenho usa glDrawElementsInstancedBaseVertex().
+//
+// As matrizes que não mudam durante o desenho de um objeto são calculadas
+// uma vez na CPU, e não em cada vértice ou fragmento: a matriz
+// "projection * view" e a posição da câmera ficam em um Uniform Buffer
+// Object compartilhado por todos os programas (veja FrameUniforms), e cada
+// objeto recebe a sua matriz "model_view_projection" e a sua matriz de
+// normais (inversa da transposta de "model").
+
+// Programa de GPU e os locais das variáveis "uniform" que mudam por objeto.
+struct RenderProgram
+{
+    GLuint program_id;
+    GLint  model_uniform;           // mat4 "model"
+    GLint  model_view_projection_uniform; // mat4 "model_view_projection"
+    GLint  normal_matrix_uniform;   // mat3 "normal_matrix"
+    GLint  render_as_black_uniform; // bool "render_as_black"
+    GLint  instanced_uniform;       // bool "instanced": usar os atributos por instância?
+
+    // Parâmetros do material. Uniforms que a permutação não usa têm local -1.
+    GLint  diffuse_uniform;         // vec3 "material_diffuse"
+    GLint  specular_uniform;        // vec3 "material_specular"
+    GLint  shininess_uniform;       // float "material_shininess"
+    GLint  texture_scale_uniform;   // float "material_texture_scale"
+    GLint  texture_uniform;         // sampler2D "TextureImage"
+};
+
+// Dados de uma instância, na ordem em que ficam no VBO de instâncias. O
+// "object_id" não vai para a GPU; todas as cópias de um desenho instanciado
+// usam o material do DrawItem.
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normal_matrix; // Calculada por RenderQueue_PushInstanced()
+    GLint     object_id;
+};
+
+// Dados constantes durante um quadro, no layout std140 do bloco
+// "FrameUniforms" de "shader_vertex.glsl" e "shader_fragment.glsl" (somente
+// vec4 e mat4, de forma que não há preenchimento entre os campos).
+struct FrameUniforms
+{
+    glm::mat4 view_projection;   // projection * view
+    glm::vec4 camera_position;   // Coordenadas do mundo; a luz fica na câmera
+    glm::vec4 light_intensity;   // Espectro da fonte de iluminação (rgb)
+    glm::vec4 ambient_intensity; // Espectro da luz ambiente (rgb)
+};
+
+// Ponto de ligação (glBindBufferBase) do Uniform Buffer com FrameUniforms.
+#define FRAME_UNIFORMS_BINDING 0
+
+struct DrawItem
+{
+    const RenderProgram* program;
+    GLuint    vertex_array_object_id;
+    GLenum    rendering_mode; // GL_TRIANGLES, GL_LINES, ...
+    GLsizei   num_indices;
+    GLenum    index_type;     // GL_UNSIGNED_SHORT ou GL_UNSIGNED_INT
+    size_t    index_offset;   // Deslocamento em bytes no buffer de índices
+    GLint     base_vertex;
+    const Material* material;
+    GLboolean render_as_black;
+    float     line_width;     // Utilizado somente por primitivas de linha
+    glm::mat4 model;          // Ignorado em desenhos instanciados
+    GLsizei   instance_count; // 0: desenho normal, com "model"
+    uint32_t  first_instance; // Preenchido por RenderQueue_PushInstanced()
+};
+
+// Contadores do último RenderQueue_Flush(). Os campos "*_skipped" contam as
+// chamadas OpenGL evitadas pelo cache de estado.
+struct RenderQueueStats
+{
+    uint32_t draw_calls;
+    uint32_t instanced_draw_calls;
+    uint32_t instances;
+    uint32_t program_binds;
+    uint32_t program_binds_skipped;
+    uint32_t vao_binds;
+    uint32_t vao_binds_skipped;
+    uint32_t texture_binds;         // Escritas do sampler "TextureImage"
+    uint32_t texture_binds_skipped;
+    uint32_t uniform_writes;
+    uint32_t uniform_writes_skipped;
+    uint32_t line_width_changes;
+    uint32_t line_width_changes_skipped;
+};
+
+// Esvazia a fila. Chamada no início de cada quadro.
+void RenderQueue_Begin();
+
+// Envia os dados do quadro para o Uniform Buffer. Deve ser chamada a cada
+// quadro antes de RenderQueue_Flush(), que usa "view_projection" para
+// calcular a matriz "model_view_projection" de cada objeto.
+void RenderQueue_SetFrameUniforms(const FrameUniforms& frame);
+
+// Liga o bloco "FrameUniforms" de um programa recém linkado ao ponto
+// FRAME_UNIFORMS_BINDING.
+void RenderQueue_BindFrameUniforms(GLuint program_id);
+
+void RenderQueue_Push(const DrawItem& item);
+
+// Acrescenta um desenho de "num_instances" cópias do objeto descrito por
+// "item" (cujos campos "model" e "instance_*" são ignorados). O campo
+// "normal_matrix" das instâncias não precisa ser preenchido.
+void RenderQueue_PushInstanced(const DrawItem& item, const InstanceData* instances, size_t num_instances);
+
+// Ordena e desenha todos os itens da fila. O estado OpenGL anterior é
+// considerado desconhecido (outros códigos, como o de renderização de texto,
+// alteram programa e VAO); ao final, o VAO é desligado.
+void RenderQueue_Flush();
+
+const RenderQueueStats& RenderQueue_Stats();
+
+#endif //TRABALHO_FINAL_FCG_RENDERQUEUE_H
@@ -0,0 +1,51 @@
+#ifndef TRABALHO_FINAL_FCG_SHADERCACHE_H
+#define TRABALHO_FINAL_FCG_SHADERCACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+
+// Criação de programas de GPU sem esperar pelo driver.
+//
+// ShaderCache_BeginProgram() somente inicia o trabalho: se existe um arquivo
+// "<nome>.progcache" (no diretório atual) gerado a partir do mesmo código
+// fonte e pelo mesmo driver, o programa já compilado é carregado com
+// glProgramBinary(); senão, os shaders são compilados e o programa é linkado,
+// sem consultar o resultado. Com a extensão KHR_parallel_shader_compile o
+// driver compila em suas próprias threads, e vários programas podem ser
+// compilados ao mesmo tempo enquanto a CPU faz outras coisas.
+//
+// O resultado só é consultado em ShaderCache_FinishProgram(), que deve ser
+// chamada quando o programa for necessário pela primeira vez. Ela imprime os
+// erros de compilação e grava o cache dos programas compilados com sucesso.
+
+struct PendingProgram
+{
+    std::string name;               // Nome do arquivo de cache e das mensagens
+    GLuint      program_id;
+    GLuint      vertex_shader_id;   // 0 se o programa veio do cache
+    GLuint      fragment_shader_id;
+    uint64_t    key;                // Hash do código fonte e do driver
+    bool        from_cache;
+    bool        finished;
+    bool        linked;             // Válido depois de ShaderCache_FinishProgram()
+};
+
+// Deve ser chamada uma vez, com o contexto OpenGL atual. "load" busca as
+// funções que não estão em glad.h (glProgramBinary() e afins).
+void ShaderCache_Init(GLADloadproc load);
+
+void ShaderCache_BeginProgram(PendingProgram* program, const char* name,
+                              const std::string& vertex_source, const std::string& fragment_source);
+
+// O driver já terminou o programa, de forma que ShaderCache_FinishProgram()
+// não vai esperar? Sem KHR_parallel_shader_compile não há como saber sem
+// esperar, e somente os programas carregados do cache estão prontos.
+bool ShaderCache_IsProgramReady(const PendingProgram& program);
+
+// Espera o fim da compilação (se necessário) e retorna se o programa foi
+// linkado com sucesso. Pode ser chamada mais de uma vez.
+bool ShaderCache_FinishProgram(PendingProgram* program);
+
+#endif //TRABALHO_FINAL_FCG_SHADERCACHE_H
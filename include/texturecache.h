@@ -0,0 +1,71 @@
+#ifndef TRABALHO_FINAL_FCG_TEXTURECACHE_H
+#define TRABALHO_FINAL_FCG_TEXTURECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Cache de texturas comprimidas. Na primeira execução, a imagem decodificada
+// pelo stb_image é reduzida para todos os níveis de mipmap e cada nível é
+// comprimido no formato BC1 (também chamado DXT1 ou S3TC), que utiliza 8
+// bytes para cada bloco de 4x4 pixels: 0.5 byte por pixel, contra 3 bytes
+// de GL_SRGB8. O resultado é salvo em "<imagem>.texcache", ao lado da
+// imagem original, e nas próximas execuções é enviado diretamente para a
+// GPU com glCompressedTexImage2D(), sem decodificar a imagem nem chamar
+// glGenerateMipmap().
+//
+// As funções deste arquivo não utilizam OpenGL e podem ser chamadas pelas
+// threads de trabalho (veja assetloader.h).
+
+// Formatos de compressão suportados pelo cache.
+enum TextureCacheFormat
+{
+    TEXTURE_FORMAT_BC1_SRGB = 1, // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+};
+
+// Bytes de um bloco de 4x4 pixels em BC1.
+#define TEXTURECACHE_BC1_BLOCK_SIZE 8
+
+// Número máximo de níveis de mipmap (suficiente para 32768x32768 pixels).
+#define TEXTURECACHE_MAX_LEVELS 16
+
+// Um nível de mipmap dentro de CompressedTexture::data.
+struct CompressedMipLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t offset; // Posição do primeiro bloco, em bytes
+    uint32_t size;   // Tamanho do nível, em bytes
+};
+
+// Textura comprimida com a cadeia completa de mipmaps: o nível 0 tem o
+// tamanho da imagem original e o último nível tem 1x1 pixel.
+struct CompressedTexture
+{
+    uint32_t             format; // Um dos valores de TextureCacheFormat
+    uint32_t             width;
+    uint32_t             height;
+    uint32_t             num_levels;
+    CompressedMipLevel   levels[TEXTURECACHE_MAX_LEVELS];
+    std::vector<uint8_t> data;
+};
+
+// Gera todos os níveis de mipmap de uma imagem RGB (8 bits por canal, em
+// sRGB) e comprime cada um em BC1. A redução é feita em espaço linear, para
+// que os níveis menores não fiquem mais escuros que o original. Os níveis e
+// os blocos são processados em paralelo (veja parallel.h).
+void CompressTexture(const unsigned char* rgb, int width, int height, CompressedTexture* texture);
+
+// Lê o cache da imagem "image_filename". Retorna false se o cache não existe,
+// está corrompido ou foi gerado a partir de outra versão da imagem.
+bool TextureCache_Read(const char* image_filename, CompressedTexture* texture);
+
+// Grava o cache da imagem "image_filename". Falhas não são fatais: a textura
+// somente será comprimida novamente na próxima execução.
+bool TextureCache_Write(const char* image_filename, const CompressedTexture& texture);
+
+// Compressão e descompressão de um único bloco de 4x4 pixels RGB.
+void EncodeBC1Block(const unsigned char pixels[16][3], uint8_t block[TEXTURECACHE_BC1_BLOCK_SIZE]);
+void DecodeBC1Block(const uint8_t block[TEXTURECACHE_BC1_BLOCK_SIZE], unsigned char pixels[16][3]);
+
+#endif //TRABALHO_FINAL_FCG_TEXTURECACHE_H
@@ -0,0 +1,82 @@
+#ifndef TRABALHO_FINAL_FCG_TEXTURESTREAMING_H
+#define TRABALHO_FINAL_FCG_TEXTURESTREAMING_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "texturecache.h"
+
+// Formato BC1 em sRGB (extensões GL_EXT_texture_compression_s3tc e
+// GL_EXT_texture_sRGB), que não faz parte do OpenGL 3.3 e por isso não está
+// definido em glad.h.
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+
+// Streaming de texturas por nível de mipmap.
+//
+// Cada textura comprimida (veja texturecache.h) começa na GPU somente com os
+// níveis de até TEXTURESTREAMING_INITIAL_SIZE pixels; os demais ficam na
+// memória da CPU. A cada quadro, o código de desenho informa com
+// TextureStreaming_Request() quantas unidades de coordenada de textura (UV)
+// cabem em um pixel na tela para cada textura, e TextureStreaming_Update()
+// envia os níveis que faltam, do menor para o maior, através de um anel de
+// Pixel Buffer Objects: a cópia para a GPU é feita pelo driver em segundo
+// plano, e no máximo "upload_bytes_per_frame" bytes são enviados por quadro.
+// Um nível só passa a ser amostrado (GL_TEXTURE_BASE_LEVEL) quando foi
+// enviado por completo.
+//
+// A memória de vídeo ocupada por todas as texturas é limitada por um
+// orçamento: quando um novo nível não cabe, são descartados primeiro os
+// níveis que estão além do necessário, das texturas utilizadas há mais tempo.
+
+typedef uint32_t StreamedTextureHandle;
+#define INVALID_STREAMED_TEXTURE ((StreamedTextureHandle)~0u)
+
+// Os níveis com até este número de pixels na maior dimensão são enviados na
+// criação da textura e nunca são descartados.
+#define TEXTURESTREAMING_INITIAL_SIZE 64
+
+// Número de PBOs do anel. Cada quadro escreve em um deles, enquanto a GPU
+// ainda pode estar lendo os dos quadros anteriores.
+#define TEXTURESTREAMING_PBO_COUNT 3
+
+struct TextureStreamingStats
+{
+    uint32_t num_textures;
+    uint32_t levels_resident;  // Níveis de mipmap na GPU, de todas as texturas
+    uint32_t levels_total;
+    size_t   resident_bytes;   // Memória de vídeo ocupada (inclui níveis sendo enviados)
+    size_t   budget_bytes;
+    size_t   full_bytes;       // Memória necessária para todos os níveis de todas as texturas
+    size_t   pending_bytes;    // Quanto falta enviar para atender os pedidos do último quadro
+    size_t   uploaded_bytes;   // Enviados no último quadro
+    uint32_t evictions;        // Níveis descartados desde TextureStreaming_Init()
+};
+
+// Devem ser chamadas com o contexto OpenGL atual. "upload_bytes_per_frame" é
+// também o tamanho de cada PBO do anel.
+void TextureStreaming_Init(size_t budget_bytes, size_t upload_bytes_per_frame);
+void TextureStreaming_Shutdown();
+
+void TextureStreaming_SetBudget(size_t budget_bytes);
+
+// Cria uma textura na GPU com os níveis iniciais de "texture", que passa a
+// pertencer ao sistema de streaming (os dados são movidos). A textura fica
+// ligada na unidade de textura ativa; "texture_id" recebe o seu ID OpenGL.
+StreamedTextureHandle TextureStreaming_Add(CompressedTexture* texture, GLuint* texture_id);
+
+// Pede detalhe suficiente para um objeto em que um pixel na tela cobre
+// "uv_per_pixel" unidades de coordenada de textura (o maior detalhe pedido
+// no quadro prevalece). Texturas sem nenhum pedido em um quadro podem voltar
+// para os níveis iniciais.
+void TextureStreaming_Request(StreamedTextureHandle texture, float uv_per_pixel);
+
+// Uma vez por quadro, depois de todos os pedidos: descarta e envia níveis.
+void TextureStreaming_Update();
+
+const TextureStreamingStats& TextureStreaming_Stats();
+
+#endif //TRABALHO_FINAL_FCG_TEXTURESTREAMING_H
@@ -0,0 +1,35 @@
+#ifndef TRABALHO_FINAL_FCG_TIMESTEP_H
+#define TRABALHO_FINAL_FCG_TIMESTEP_H
+
+#include <cstdint>
+
+// Passo de tempo fixo para a simulação, desacoplado da taxa de quadros.
+// Veja https://gafferongames.com/post/fix_your_timestep/
+//
+// A cada quadro, FixedTimestep_Advance() acumula o tempo real decorrido e
+// retorna quantos passos de duração "step" devem ser simulados. O tempo que
+// sobra (menor que um passo) fica para o próximo quadro, e
+// FixedTimestep_Alpha() diz quanto do próximo passo já passou, para que a
+// renderização interpole entre o estado anterior e o atual da simulação.
+struct FixedTimestep
+{
+    double   step;        // Duração de um passo, em segundos
+    int      max_steps;   // Máximo de passos executados em um único quadro
+    double   accumulator; // Tempo real ainda não simulado, em segundos
+    double   last_time;   // Instante do último quadro; negativo: nenhum ainda
+    uint64_t num_steps;   // Total de passos executados
+    uint64_t num_dropped_steps; // Passos descartados por excederem "max_steps"
+};
+
+void FixedTimestep_Init(FixedTimestep* timestep, double steps_per_second, int max_steps_per_frame);
+
+// "now" é o instante atual em segundos (por exemplo, glfwGetTime()). Se mais
+// de "max_steps" passos estão pendentes (o quadro demorou demais, ou a janela
+// ficou parada), o excesso é descartado: a simulação fica mais lenta que o
+// tempo real em vez de gastar cada vez mais tempo para recuperar o atraso.
+int FixedTimestep_Advance(FixedTimestep* timestep, double now);
+
+// Fração em [0,1) do próximo passo que já decorreu.
+float FixedTimestep_Alpha(const FixedTimestep& timestep);
+
+#endif //TRABALHO_FINAL_FCG_TIMESTEP_H
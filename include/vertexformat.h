@@ -0,0 +1,75 @@
+#ifndef TRABALHO_FINAL_FCG_VERTEXFORMAT_H
+#define TRABALHO_FINAL_FCG_VERTEXFORMAT_H
+
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+
+// Locais ("layout (location = N)") dos atributos de vértice. Os shaders não
+// usam números fixos: os nomes abaixo são injetados como "#define" no código
+// GLSL por VertexFormat_ShaderDefines(), de forma que a CPU e a GPU sempre
+// concordam sobre onde está cada atributo.
+enum VertexAttribLocation
+{
+    ATTRIB_POSITION = 0,
+    ATTRIB_COLOR    = 1,
+    ATTRIB_TEXCOORD = 2,
+    ATTRIB_NORMAL   = 3,
+
+    // Atributos por instância (glVertexAttribDivisor = 1), utilizados somente
+    // por desenhos instanciados. Veja renderqueue.h.
+    ATTRIB_INSTANCE_MODEL         = 4, // mat4: ocupa os locais 4, 5, 6 e 7
+    ATTRIB_INSTANCE_NORMAL_MATRIX = 8, // mat3: ocupa os locais 8, 9 e 10
+};
+
+// Descreve um atributo de vértice como é passado para glVertexAttribPointer().
+struct VertexAttribute
+{
+    GLuint    location;   // Um dos valores de VertexAttribLocation
+    GLint     size;       // Número de componentes
+    GLenum    type;       // Tipo de cada componente na memória
+    GLboolean normalized; // Inteiros são convertidos para [-1,1] ou [0,1]?
+    GLuint    offset;     // Deslocamento em bytes dentro do vértice
+};
+
+#define VERTEXFORMAT_MAX_ATTRIBUTES 4
+
+// Descritor do formato dos vértices de um objeto: os atributos estão
+// intercalados em um único VBO, com "stride" bytes por vértice.
+struct VertexFormat
+{
+    const char*     name;
+    GLsizei         stride;
+    int             num_attributes;
+    VertexAttribute attributes[VERTEXFORMAT_MAX_ATTRIBUTES];
+};
+
+// Vértice compacto utilizado pelas malhas carregadas de arquivos ".obj"
+// (20 bytes, contra 40 bytes de posição vec4 + normal vec4 + UV vec2):
+//  - posição com três floats (W=1 é implícito);
+//  - normal em GL_INT_2_10_10_10_REV, normalizada;
+//  - coordenadas de textura em half-float.
+struct PackedVertex
+{
+    float    position[3];
+    uint32_t normal;
+    uint16_t texcoord[2];
+};
+
+// Formato de PackedVertex, intercalado em um único VBO.
+extern const VertexFormat VERTEX_FORMAT_PACKED;
+
+// Configura os atributos do VAO atualmente ligado a partir do VBO atualmente
+// ligado em GL_ARRAY_BUFFER.
+void VertexFormat_Apply(const VertexFormat& format);
+
+// Linhas "#define ATTRIB_... N" que devem ser inseridas nos shaders.
+std::string VertexFormat_ShaderDefines();
+
+// Funções de compactação dos atributos de PackedVertex.
+uint32_t PackNormal_Int2_10_10_10(float x, float y, float z);
+uint16_t PackHalfFloat(float value);
+float    UnpackHalfFloat(uint16_t value);
+
+#endif //TRABALHO_FINAL_FCG_VERTEXFORMAT_H
@@ -0,0 +1,155 @@
+#include "../include/assetloader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../include/parallel.h"
+
+struct AssetJob
+{
+    std::string      name;
+    AssetJobFunction work;
+    AssetJobFunction finish;
+    std::string      error; // Não vazio se "work" lançou uma exceção
+};
+
+// Estado compartilhado entre a thread principal e as threads de trabalho,
+// protegido por g_Mutex.
+static std::mutex               g_Mutex;
+static std::condition_variable  g_WorkAvailable;
+static std::deque<AssetJob>     g_PendingJobs;   // Esperando uma thread de trabalho
+static std::deque<AssetJob>     g_CompletedJobs; // Esperando a thread principal
+static bool                     g_Stop = false;
+
+static std::vector<std::thread> g_Workers;
+
+// Acessados somente pela thread principal.
+static AssetLoaderProgress      g_Progress;
+
+static void WorkerThread()
+{
+    for (;;)
+    {
+        AssetJob job;
+        {
+            std::unique_lock<std::mutex> lock(g_Mutex);
+            g_WorkAvailable.wait(lock, [] { return g_Stop || !g_PendingJobs.empty(); });
+            if (g_Stop)
+                return;
+
+            job = std::move(g_PendingJobs.front());
+            g_PendingJobs.pop_front();
+        }
+
+        try
+        {
+            job.work();
+        }
+        catch (const std::exception& e)
+        {
+            job.error = e.what();
+            if (job.error.empty())
+                job.error = "unknown error";
+        }
+
+        std::lock_guard<std::mutex> lock(g_Mutex);
+        g_CompletedJobs.push_back(std::move(job));
+    }
+}
+
+void AssetLoader_Init(unsigned int num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, Parallel_NumThreads() - 1);
+
+    g_Stop = false;
+    g_Progress = AssetLoaderProgress();
+
+    for (unsigned int i = 0; i < num_threads; ++i)
+        g_Workers.emplace_back(WorkerThread);
+}
+
+void AssetLoader_Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(g_Mutex);
+        g_Stop = true;
+        g_PendingJobs.clear();
+    }
+    g_WorkAvailable.notify_all();
+
+    for (std::thread& worker : g_Workers)
+        worker.join();
+    g_Workers.clear();
+
+    std::lock_guard<std::mutex> lock(g_Mutex);
+    g_CompletedJobs.clear();
+}
+
+void AssetLoader_Submit(const std::string& name, AssetJobFunction work, AssetJobFunction finish)
+{
+    AssetJob job;
+    job.name   = name;
+    job.work   = std::move(work);
+    job.finish = std::move(finish);
+
+    {
+        std::lock_guard<std::mutex> lock(g_Mutex);
+        g_PendingJobs.push_back(std::move(job));
+    }
+    g_WorkAvailable.notify_one();
+
+    g_Progress.num_submitted += 1;
+}
+
+bool AssetLoader_ProcessCompleted(double max_seconds, std::string* error)
+{
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+
+    for (;;)
+    {
+        AssetJob job;
+        {
+            std::lock_guard<std::mutex> lock(g_Mutex);
+            if (g_CompletedJobs.empty())
+                return true;
+
+            job = std::move(g_CompletedJobs.front());
+            g_CompletedJobs.pop_front();
+        }
+
+        if (!job.error.empty())
+        {
+            *error = "\"" + job.name + "\": " + job.error;
+            return false;
+        }
+
+        if (job.finish)
+            job.finish();
+
+        g_Progress.num_finished += 1;
+        g_Progress.last_finished = job.name;
+
+        // Uploads grandes (texturas 4k) podem demorar; deixamos o restante
+        // para o próximo quadro para manter a janela respondendo.
+        if (std::chrono::duration<double>(clock::now() - start).count() >= max_seconds)
+            return true;
+    }
+}
+
+AssetLoaderProgress AssetLoader_Progress()
+{
+    return g_Progress;
+}
+
+bool AssetLoader_Idle()
+{
+    return g_Progress.num_finished == g_Progress.num_submitted;
+}
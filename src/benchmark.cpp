@@ -0,0 +1,334 @@
+#include "../include/benchmark.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "../include/collisions.h"
+
+static std::vector<double>           g_FrameSeconds;
+static std::vector<RenderQueueStats> g_FrameStats;
+
+void Benchmark_Begin(size_t num_frames)
+{
+    g_FrameSeconds.clear();
+    g_FrameStats.clear();
+    g_FrameSeconds.reserve(num_frames);
+    g_FrameStats.reserve(num_frames);
+}
+
+void Benchmark_RecordFrame(double cpu_seconds, const RenderQueueStats& stats)
+{
+    g_FrameSeconds.push_back(cpu_seconds);
+    g_FrameStats.push_back(stats);
+}
+
+// Percentil pelo método "nearest rank", sobre um vetor já ordenado.
+static double Percentile(const std::vector<double>& sorted, double percent)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    size_t rank = (size_t)(percent / 100.0 * sorted.size() + 0.999999);
+    rank = std::min(std::max(rank, (size_t)1), sorted.size());
+    return sorted[rank - 1];
+}
+
+static std::string JsonString(const char* text)
+{
+    std::string result = "\"";
+    for (const char* c = text; *c != '\0'; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            result += '\\';
+            result += *c;
+        }
+        else if ((unsigned char)*c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)*c);
+            result += escaped;
+        }
+        else
+        {
+            result += *c;
+        }
+    }
+    return result + "\"";
+}
+
+// Lista dos contadores de RenderQueueStats escritos no JSON.
+struct StatsField
+{
+    const char* name;
+    uint32_t RenderQueueStats::* member;
+};
+
+static const StatsField STATS_FIELDS[] = {
+    { "draw_calls",                 &RenderQueueStats::draw_calls },
+    { "instanced_draw_calls",       &RenderQueueStats::instanced_draw_calls },
+    { "instances",                  &RenderQueueStats::instances },
+    { "program_binds",              &RenderQueueStats::program_binds },
+    { "program_binds_skipped",      &RenderQueueStats::program_binds_skipped },
+    { "vao_binds",                  &RenderQueueStats::vao_binds },
+    { "vao_binds_skipped",          &RenderQueueStats::vao_binds_skipped },
+    { "texture_binds",              &RenderQueueStats::texture_binds },
+    { "texture_binds_skipped",      &RenderQueueStats::texture_binds_skipped },
+    { "uniform_writes",             &RenderQueueStats::uniform_writes },
+    { "uniform_writes_skipped",     &RenderQueueStats::uniform_writes_skipped },
+    { "line_width_changes",         &RenderQueueStats::line_width_changes },
+    { "line_width_changes_skipped", &RenderQueueStats::line_width_changes_skipped },
+};
+
+bool Benchmark_WriteJson(const char* path, const char* renderer, double load_seconds, double steps_per_second)
+{
+    FILE* f = fopen(path, "w");
+    if (f == NULL)
+        return false;
+
+    size_t num_frames = g_FrameSeconds.size();
+
+    std::vector<double> sorted_ms(num_frames);
+    double total_ms = 0.0;
+    for (size_t i = 0; i < num_frames; ++i)
+    {
+        sorted_ms[i] = g_FrameSeconds[i] * 1000.0;
+        total_ms += sorted_ms[i];
+    }
+    std::sort(sorted_ms.begin(), sorted_ms.end());
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"renderer\": %s,\n", JsonString(renderer).c_str());
+    fprintf(f, "  \"frames\": %zu,\n", num_frames);
+    fprintf(f, "  \"simulation_steps_per_second\": %.3f,\n", steps_per_second);
+    fprintf(f, "  \"load_seconds\": %.6f,\n", load_seconds);
+    fprintf(f, "  \"frame_cpu_ms\": {\n");
+    fprintf(f, "    \"mean\": %.6f,\n", num_frames > 0 ? total_ms / num_frames : 0.0);
+    fprintf(f, "    \"min\": %.6f,\n", num_frames > 0 ? sorted_ms.front() : 0.0);
+    fprintf(f, "    \"p50\": %.6f,\n", Percentile(sorted_ms, 50.0));
+    fprintf(f, "    \"p90\": %.6f,\n", Percentile(sorted_ms, 90.0));
+    fprintf(f, "    \"p95\": %.6f,\n", Percentile(sorted_ms, 95.0));
+    fprintf(f, "    \"p99\": %.6f,\n", Percentile(sorted_ms, 99.0));
+    fprintf(f, "    \"max\": %.6f\n", num_frames > 0 ? sorted_ms.back() : 0.0);
+    fprintf(f, "  },\n");
+
+    const size_t num_fields = sizeof(STATS_FIELDS) / sizeof(STATS_FIELDS[0]);
+
+    std::vector<uint64_t> totals(num_fields, 0);
+    for (size_t frame = 0; frame < num_frames; ++frame)
+        for (size_t field = 0; field < num_fields; ++field)
+            totals[field] += g_FrameStats[frame].*(STATS_FIELDS[field].member);
+
+    fprintf(f, "  \"per_frame\": {\n");
+    for (size_t field = 0; field < num_fields; ++field)
+    {
+        double mean = num_frames > 0 ? (double)totals[field] / num_frames : 0.0;
+        fprintf(f, "    \"%s\": %.3f%s\n", STATS_FIELDS[field].name, mean, field + 1 < num_fields ? "," : "");
+    }
+    fprintf(f, "  },\n");
+
+    fprintf(f, "  \"totals\": {\n");
+    for (size_t field = 0; field < num_fields; ++field)
+    {
+        fprintf(f, "    \"%s\": %llu%s\n", STATS_FIELDS[field].name, (unsigned long long)totals[field],
+                field + 1 < num_fields ? "," : "");
+    }
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+
+    return fclose(f) == 0;
+}
+
+// Objetos do microbenchmark de colisões, espalhados pela arena, e objetos
+// de consulta (a esfera ou o raio testado contra todos os outros).
+struct CollisionBenchmarkData
+{
+    std::vector<Sphere> spheres;
+    std::vector<Plane>  planes;
+    std::vector<AABB>   boxes;
+    SphereBatch sphere_batch;
+    PlaneBatch  plane_batch;
+    AABBBatch   box_batch;
+
+    std::vector<Sphere> query_spheres;
+    std::vector<Ray>    query_rays;
+};
+
+static void GenerateCollisionData(CollisionBenchmarkData* data, size_t num_objects)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> size(0.5f, 5.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    for (size_t i = 0; i < num_objects; ++i)
+    {
+        Sphere sphere;
+        sphere.center = glm::vec3(position(rng), position(rng), position(rng));
+        sphere.radius = size(rng);
+        data->spheres.push_back(sphere);
+        addToBatch(&data->sphere_batch, sphere);
+
+        Plane plane;
+        plane.normal = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+        plane.distance = position(rng);
+        data->planes.push_back(plane);
+        addToBatch(&data->plane_batch, plane);
+
+        AABB box;
+        box.min = glm::vec3(position(rng), position(rng), position(rng));
+        box.max = box.min + glm::vec3(size(rng), size(rng), size(rng));
+        data->boxes.push_back(box);
+        addToBatch(&data->box_batch, box);
+    }
+
+    for (int i = 0; i < 64; ++i)
+    {
+        Sphere sphere;
+        sphere.center = glm::vec3(position(rng), position(rng), position(rng));
+        sphere.radius = 10.0f * size(rng);
+        data->query_spheres.push_back(sphere);
+
+        Ray ray;
+        ray.origin = glm::vec3(position(rng), position(rng), position(rng));
+        ray.direction = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+        data->query_rays.push_back(ray);
+    }
+}
+
+// Executa "test" para cada uma das consultas, "repetitions" vezes, e retorna
+// o menor tempo por objeto em nanossegundos.
+static double TimeCollisionTest(const std::function<void(size_t query)>& test, size_t num_queries,
+                                size_t num_objects, int repetitions)
+{
+    double best = 1e30;
+    for (int repetition = 0; repetition < repetitions; ++repetition)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t query = 0; query < num_queries; ++query)
+            test(query);
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / ((double)num_queries * num_objects));
+    }
+    return best;
+}
+
+bool Benchmark_Collisions(size_t num_objects, int repetitions)
+{
+    CollisionBenchmarkData data;
+    GenerateCollisionData(&data, num_objects);
+
+    size_t num_queries = data.query_spheres.size();
+    size_t mask_words = COLLISION_MASK_WORDS(num_objects);
+
+    // Resultados de referência do laço escalar, para todas as consultas.
+    std::vector<uint32_t> reference_masks[3];
+    std::vector<float> reference_values[2];
+    std::vector<uint32_t> masks[3];
+    std::vector<float> values[2];
+    for (int kernel = 0; kernel < 3; ++kernel)
+    {
+        reference_masks[kernel].assign(num_queries * mask_words, 0);
+        masks[kernel].assign(num_queries * mask_words, 0);
+    }
+    for (int kernel = 0; kernel < 2; ++kernel)
+    {
+        reference_values[kernel].assign(num_queries * num_objects, 0.0f);
+        values[kernel].assign(num_queries * num_objects, 0.0f);
+    }
+
+    std::function<void(size_t)> loops[3] = {
+        [&](size_t query) {
+            uint32_t* mask = &reference_masks[0][query * mask_words];
+            for (size_t i = 0; i < num_objects; ++i)
+                if (checkSphereSphereCollision(data.query_spheres[query], data.spheres[i]))
+                    mask[i / 32] |= 1u << (i % 32);
+        },
+        [&](size_t query) {
+            uint32_t* mask = &reference_masks[1][query * mask_words];
+            float* signed_distances = &reference_values[0][query * num_objects];
+            const Sphere& sphere = data.query_spheres[query];
+            for (size_t i = 0; i < num_objects; ++i)
+            {
+                signed_distances[i] = glm::dot(data.planes[i].normal, sphere.center) + data.planes[i].distance;
+                if (checkSpherePlaneCollision(sphere, data.planes[i]))
+                    mask[i / 32] |= 1u << (i % 32);
+            }
+        },
+        [&](size_t query) {
+            uint32_t* mask = &reference_masks[2][query * mask_words];
+            float* distances = &reference_values[1][query * num_objects];
+            for (size_t i = 0; i < num_objects; ++i)
+            {
+                distances[i] = FLT_MAX;
+                if (checkRayAABBCollision(data.query_rays[query], data.boxes[i], &distances[i]))
+                    mask[i / 32] |= 1u << (i % 32);
+            }
+        },
+    };
+
+    std::function<void(size_t)> batches[3] = {
+        [&](size_t query) {
+            checkSphereSphereCollisionBatch(data.query_spheres[query], data.sphere_batch,
+                                            &masks[0][query * mask_words]);
+        },
+        [&](size_t query) {
+            checkSpherePlaneCollisionBatch(data.query_spheres[query], data.plane_batch,
+                                           &masks[1][query * mask_words], &values[0][query * num_objects]);
+        },
+        [&](size_t query) {
+            checkRayAABBCollisionBatch(data.query_rays[query], data.box_batch,
+                                       &masks[2][query * mask_words], &values[1][query * num_objects]);
+        },
+    };
+
+    static const char* KERNEL_NAMES[3] = { "sphere-sphere", "sphere-plane", "ray-aabb" };
+    static const int KERNEL_VALUES[3] = { -1, 0, 1 }; // Índice em values[], ou -1
+
+    printf("Collision kernels: %zu objects, %zu queries, best of %d runs (ns per object)\n",
+           num_objects, num_queries, repetitions);
+    printf("%-14s %10s", "", "loop");
+    CollisionSimdLevel supported = getSupportedCollisionSimdLevel();
+    for (int level = COLLISION_SIMD_SCALAR; level <= supported; ++level)
+        printf(" %10s", collisionSimdLevelName((CollisionSimdLevel)level));
+    printf("\n");
+
+    CollisionSimdLevel previous_level = getCollisionSimdLevel();
+    bool all_match = true;
+
+    for (int kernel = 0; kernel < 3; ++kernel)
+    {
+        double loop_ns = TimeCollisionTest(loops[kernel], num_queries, num_objects, repetitions);
+        printf("%-14s %10.3f", KERNEL_NAMES[kernel], loop_ns);
+
+        for (int level = COLLISION_SIMD_SCALAR; level <= supported; ++level)
+        {
+            setCollisionSimdLevel((CollisionSimdLevel)level);
+            double batch_ns = TimeCollisionTest(batches[kernel], num_queries, num_objects, repetitions);
+
+            bool match = masks[kernel] == reference_masks[kernel];
+            int value = KERNEL_VALUES[kernel];
+            if (value >= 0)
+                match = match && memcmp(values[value].data(), reference_values[value].data(),
+                                        values[value].size() * sizeof(float)) == 0;
+            all_match = all_match && match;
+
+            printf(" %10.3f", batch_ns);
+            if (!match)
+                printf(" (MISMATCH)");
+        }
+        printf("\n");
+    }
+
+    setCollisionSimdLevel(previous_level);
+    return all_match;
+}
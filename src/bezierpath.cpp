@@ -0,0 +1,235 @@
+#include "../include/bezierpath.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <glm/glm.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #define BEZIERPATH_HAVE_SSE
+  #include <emmintrin.h>
+#endif
+
+void BezierPath_Init(BezierPath* path, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3)
+{
+    path->control_points[0] = p0;
+    path->control_points[1] = p1;
+    path->control_points[2] = p2;
+    path->control_points[3] = p3;
+
+    // Aproximamos a curva por uma poligonal com BEZIERPATH_ARC_LENGTH_SAMPLES
+    // segmentos. As curvas dos alvos são suaves e com poucas dezenas de
+    // unidades de comprimento, e o erro fica bem abaixo do que se percebe.
+    glm::vec3 previous = p0;
+    path->arc_lengths[0] = 0.0f;
+    for (int i = 1; i <= BEZIERPATH_ARC_LENGTH_SAMPLES; ++i)
+    {
+        glm::vec3 point = BezierPath_Point(*path, (float)i / BEZIERPATH_ARC_LENGTH_SAMPLES);
+        path->arc_lengths[i] = path->arc_lengths[i - 1] + glm::distance(previous, point);
+        previous = point;
+    }
+    path->length = path->arc_lengths[BEZIERPATH_ARC_LENGTH_SAMPLES];
+}
+
+glm::vec3 BezierPath_Point(const BezierPath& path, float t)
+{
+    float u = 1.0f - t;
+    float tt = t * t;
+    float uu = u * u;
+    float uuu = uu * u;
+    float ttt = tt * t;
+
+    const glm::vec3* p = path.control_points;
+    glm::vec3 point = uuu * p[0]; // (1-t)^3 * P0
+    point += 3.0f * uu * t * p[1]; // 3 * (1-t)^2 * t * P1
+    point += 3.0f * u * tt * p[2]; // 3 * (1-t) * t^2 * P2
+    point += ttt * p[3]; // t^3 * P3
+
+    return point;
+}
+
+float BezierPath_ParameterAtDistance(const BezierPath& path, float distance)
+{
+    if (!(distance > 0.0f))
+        return 0.0f;
+    if (distance >= path.length)
+        return 1.0f;
+
+    // Primeira amostra com comprimento maior que "distance"; o ponto está
+    // entre ela e a anterior.
+    const float* begin = path.arc_lengths;
+    const float* end = path.arc_lengths + BEZIERPATH_ARC_LENGTH_SAMPLES + 1;
+    int i = (int)(std::upper_bound(begin, end, distance) - begin);
+    i = std::min(std::max(i, 1), BEZIERPATH_ARC_LENGTH_SAMPLES);
+
+    float s0 = path.arc_lengths[i - 1];
+    float s1 = path.arc_lengths[i];
+    float fraction = (s1 > s0) ? (distance - s0) / (s1 - s0) : 0.0f;
+    return ((float)(i - 1) + fraction) / BEZIERPATH_ARC_LENGTH_SAMPLES;
+}
+
+glm::vec3 BezierPath_PointAtDistance(const BezierPath& path, float distance)
+{
+    return BezierPath_Point(path, BezierPath_ParameterAtDistance(path, distance));
+}
+
+void BezierPath_PointsAtDistances(const BezierPath* const* paths, const float* distances, size_t count,
+                                  glm::vec3* points)
+{
+    size_t i = 0;
+
+#ifdef BEZIERPATH_HAVE_SSE
+    // De 4 em 4 curvas: os pesos de Bernstein das 4 curvas são calculados em
+    // um único vetor, e cada coordenada dos pontos de controle é combinada
+    // com eles também em um único vetor.
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 three = _mm_set1_ps(3.0f);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const BezierPath* p[4] = { paths[i], paths[i + 1], paths[i + 2], paths[i + 3] };
+
+        __m128 t = _mm_setr_ps(BezierPath_ParameterAtDistance(*p[0], distances[i]),
+                               BezierPath_ParameterAtDistance(*p[1], distances[i + 1]),
+                               BezierPath_ParameterAtDistance(*p[2], distances[i + 2]),
+                               BezierPath_ParameterAtDistance(*p[3], distances[i + 3]));
+        __m128 u = _mm_sub_ps(one, t);
+        __m128 tt = _mm_mul_ps(t, t);
+        __m128 uu = _mm_mul_ps(u, u);
+
+        __m128 weights[4];
+        weights[0] = _mm_mul_ps(uu, u);
+        weights[1] = _mm_mul_ps(_mm_mul_ps(three, uu), t);
+        weights[2] = _mm_mul_ps(_mm_mul_ps(three, u), tt);
+        weights[3] = _mm_mul_ps(tt, t);
+
+        float result[3][4];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < 4; ++k)
+            {
+                __m128 coordinate = _mm_setr_ps(p[0]->control_points[k][axis], p[1]->control_points[k][axis],
+                                                p[2]->control_points[k][axis], p[3]->control_points[k][axis]);
+                sum = _mm_add_ps(sum, _mm_mul_ps(weights[k], coordinate));
+            }
+            _mm_storeu_ps(result[axis], sum);
+        }
+
+        for (int j = 0; j < 4; ++j)
+            points[i + j] = glm::vec3(result[0][j], result[1][j], result[2][j]);
+    }
+#endif
+
+    for (; i < count; ++i)
+        points[i] = BezierPath_PointAtDistance(*paths[i], distances[i]);
+}
+
+static float RandomFloat(float min, float max)
+{
+    float scale = rand() / (float) RAND_MAX;
+    return min + scale * (max - min);
+}
+
+static glm::vec3 RandomPoint(const BezierPathBounds& bounds, float margin)
+{
+    return glm::vec3(RandomFloat(bounds.min_x + margin, bounds.max_x - margin), bounds.y,
+                     RandomFloat(bounds.min_z + margin, bounds.max_z - margin));
+}
+
+// Limita a tangente T de um ponto de passagem W para que os pontos de
+// controle W - T/3 e W + T/3, dos dois lados da emenda, fiquem dentro da
+// região. A direção de T não muda, então a emenda continua suave.
+static glm::vec3 LimitTangent(const BezierPathBounds& bounds, const glm::vec3& waypoint, glm::vec3 tangent)
+{
+    float scale = 1.0f;
+    for (int axis = 0; axis < 3; axis += 2)
+    {
+        float min = (axis == 0) ? bounds.min_x : bounds.min_z;
+        float max = (axis == 0) ? bounds.max_x : bounds.max_z;
+        float reach = glm::abs(tangent[axis]) / 3.0f;
+        float room = std::min(waypoint[axis] - min, max - waypoint[axis]);
+        if (reach > room)
+            scale = std::min(scale, std::max(room, 0.0f) / reach);
+    }
+    return tangent * scale;
+}
+
+// Sorteia o ponto de passagem seguinte a "from" -> "to". Pontos que fazem o
+// caminho voltar quase pelo mesmo lado (e a curva fazer uma "ponta"), ou
+// que estão muito perto de "to", são sorteados novamente algumas vezes.
+static glm::vec3 NextWaypoint(const BezierPathBounds& bounds, const glm::vec3& from, const glm::vec3& to)
+{
+    const int max_attempts = 8;
+    const float min_distance = 10.0f;
+    const float min_cos_turn = -0.5f; // Curvas de no máximo 120 graus
+
+    glm::vec3 direction = to - from;
+    float direction_length = glm::length(direction);
+
+    glm::vec3 candidate = RandomPoint(bounds, bounds.margin);
+    for (int attempt = 1; attempt < max_attempts; ++attempt)
+    {
+        glm::vec3 next = candidate - to;
+        float next_length = glm::length(next);
+        if (next_length >= min_distance
+            && (direction_length == 0.0f || glm::dot(next, direction) >= min_cos_turn * next_length * direction_length))
+            break;
+        candidate = RandomPoint(bounds, bounds.margin);
+    }
+    return candidate;
+}
+
+// Gera a curva que sai do ponto de passagem "from" (com tangente
+// "from_tangent") e chega em stream->next_waypoint, sorteando o ponto de
+// passagem seguinte. A tangente na chegada é a de Catmull-Rom,
+// (W[i+2] - W[i]) / 2, e será a tangente de saída da próxima curva.
+static void GenerateSegment(BezierPathStream* stream, const glm::vec3& from, const glm::vec3& from_tangent,
+                            BezierPath* segment)
+{
+    const BezierPathBounds& bounds = stream->bounds;
+
+    glm::vec3 to = stream->next_waypoint;
+    glm::vec3 after = NextWaypoint(bounds, from, to);
+    glm::vec3 to_tangent = LimitTangent(bounds, to, 0.5f * (after - from));
+
+    BezierPath_Init(segment, from, from + from_tangent / 3.0f, to - to_tangent / 3.0f, to);
+    stream->next_waypoint = after;
+}
+
+// Curva seguinte a "previous", com a mesma tangente no ponto de emenda.
+static void GenerateNextSegment(BezierPathStream* stream, const BezierPath& previous, BezierPath* segment)
+{
+    glm::vec3 from = previous.control_points[3];
+    glm::vec3 from_tangent = 3.0f * (previous.control_points[3] - previous.control_points[2]);
+    GenerateSegment(stream, from, from_tangent, segment);
+}
+
+void BezierPathStream_Init(BezierPathStream* stream, const BezierPathBounds& bounds, const glm::vec3& start)
+{
+    stream->bounds = bounds;
+    stream->current = 0;
+    stream->distance = 0.0f;
+    stream->next_waypoint = RandomPoint(bounds, bounds.margin);
+
+    glm::vec3 start_tangent = LimitTangent(bounds, start, 0.5f * (stream->next_waypoint - start));
+    GenerateSegment(stream, start, start_tangent, &stream->segments[0]);
+    for (int i = 1; i < BEZIERPATH_STREAM_SEGMENTS; ++i)
+        GenerateNextSegment(stream, stream->segments[i - 1], &stream->segments[i]);
+}
+
+void BezierPathStream_Advance(BezierPathStream* stream, float distance)
+{
+    stream->distance += distance;
+
+    while (stream->distance >= stream->segments[stream->current].length)
+    {
+        stream->distance -= stream->segments[stream->current].length;
+
+        // A última curva do caminho é a que está imediatamente antes da
+        // atual no buffer circular; a nova curva ocupa o lugar da atual.
+        int last = (stream->current + BEZIERPATH_STREAM_SEGMENTS - 1) % BEZIERPATH_STREAM_SEGMENTS;
+        GenerateNextSegment(stream, stream->segments[last], &stream->segments[stream->current]);
+        stream->current = (stream->current + 1) % BEZIERPATH_STREAM_SEGMENTS;
+    }
+}
@@ -0,0 +1,306 @@
+#include "../include/broadphase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void Broadphase_Init(BroadphaseGrid* grid, float min_x, float min_z, float max_x, float max_z, float cell_size)
+{
+    grid->min_x = min_x;
+    grid->min_z = min_z;
+    grid->cell_size = cell_size;
+    grid->num_cells_x = std::max(1, (int)std::ceil((max_x - min_x) / cell_size));
+    grid->num_cells_z = std::max(1, (int)std::ceil((max_z - min_z) / cell_size));
+    grid->cells.assign((size_t)grid->num_cells_x * grid->num_cells_z, std::vector<uint32_t>());
+    grid->entries.clear();
+    grid->outside.clear();
+    grid->query_stamp = 0;
+}
+
+static int CellX(const BroadphaseGrid& grid, float x)
+{
+    int cell = (int)std::floor((x - grid.min_x) / grid.cell_size);
+    return std::min(std::max(cell, 0), grid.num_cells_x - 1);
+}
+
+static int CellZ(const BroadphaseGrid& grid, float z)
+{
+    int cell = (int)std::floor((z - grid.min_z) / grid.cell_size);
+    return std::min(std::max(cell, 0), grid.num_cells_z - 1);
+}
+
+static std::vector<uint32_t>& Cell(BroadphaseGrid* grid, int x, int z)
+{
+    return grid->cells[(size_t)z * grid->num_cells_x + x];
+}
+
+static void RemoveFromList(std::vector<uint32_t>* list, uint32_t id)
+{
+    std::vector<uint32_t>::iterator it = std::find(list->begin(), list->end(), id);
+    if (it != list->end())
+    {
+        *it = list->back();
+        list->pop_back();
+    }
+}
+
+static bool IsOutside(const BroadphaseGrid& grid, const AABB& box)
+{
+    return box.min.x < grid.min_x || box.max.x > grid.min_x + grid.num_cells_x * grid.cell_size
+        || box.min.z < grid.min_z || box.max.z > grid.min_z + grid.num_cells_z * grid.cell_size;
+}
+
+static void RemoveFromCells(BroadphaseGrid* grid, uint32_t id, const BroadphaseEntry& entry)
+{
+    for (int z = entry.cell_min_z; z <= entry.cell_max_z; ++z)
+    {
+        for (int x = entry.cell_min_x; x <= entry.cell_max_x; ++x)
+            RemoveFromList(&Cell(grid, x, z), id);
+    }
+}
+
+void Broadphase_Update(BroadphaseGrid* grid, uint32_t id, const AABB& box)
+{
+    if (id >= grid->entries.size())
+    {
+        BroadphaseEntry inactive;
+        inactive.active = false;
+        inactive.outside = false;
+        inactive.query_stamp = 0;
+        grid->entries.resize(id + 1, inactive);
+    }
+
+    BroadphaseEntry& entry = grid->entries[id];
+
+    int min_x = CellX(*grid, box.min.x);
+    int min_z = CellZ(*grid, box.min.z);
+    int max_x = CellX(*grid, box.max.x);
+    int max_z = CellZ(*grid, box.max.z);
+
+    entry.box = box;
+
+    bool outside = IsOutside(*grid, box);
+    if (outside != (entry.active && entry.outside))
+    {
+        if (outside)
+            grid->outside.push_back(id);
+        else
+            RemoveFromList(&grid->outside, id);
+    }
+    entry.outside = outside;
+
+    if (entry.active && min_x == entry.cell_min_x && min_z == entry.cell_min_z
+                     && max_x == entry.cell_max_x && max_z == entry.cell_max_z)
+        return;
+
+    if (entry.active)
+        RemoveFromCells(grid, id, entry);
+
+    entry.cell_min_x = min_x;
+    entry.cell_min_z = min_z;
+    entry.cell_max_x = max_x;
+    entry.cell_max_z = max_z;
+    entry.active = true;
+
+    for (int z = min_z; z <= max_z; ++z)
+        for (int x = min_x; x <= max_x; ++x)
+            Cell(grid, x, z).push_back(id);
+}
+
+void Broadphase_Remove(BroadphaseGrid* grid, uint32_t id)
+{
+    if (id >= grid->entries.size() || !grid->entries[id].active)
+        return;
+
+    RemoveFromCells(grid, id, grid->entries[id]);
+    if (grid->entries[id].outside)
+        RemoveFromList(&grid->outside, id);
+    grid->entries[id].active = false;
+}
+
+// Novo valor de "query_stamp"; no (improvável) retorno a zero, limpamos as marcas.
+static uint32_t NextQueryStamp(BroadphaseGrid* grid)
+{
+    grid->query_stamp += 1;
+    if (grid->query_stamp == 0)
+    {
+        for (size_t i = 0; i < grid->entries.size(); ++i)
+            grid->entries[i].query_stamp = 0;
+        grid->query_stamp = 1;
+    }
+    return grid->query_stamp;
+}
+
+void Broadphase_QueryAABB(BroadphaseGrid* grid, const AABB& box, std::vector<uint32_t>* result)
+{
+    uint32_t stamp = NextQueryStamp(grid);
+
+    int min_x = CellX(*grid, box.min.x);
+    int min_z = CellZ(*grid, box.min.z);
+    int max_x = CellX(*grid, box.max.x);
+    int max_z = CellZ(*grid, box.max.z);
+
+    for (int z = min_z; z <= max_z; ++z)
+    {
+        for (int x = min_x; x <= max_x; ++x)
+        {
+            const std::vector<uint32_t>& cell = Cell(grid, x, z);
+            for (size_t i = 0; i < cell.size(); ++i)
+            {
+                BroadphaseEntry& entry = grid->entries[cell[i]];
+                if (entry.query_stamp == stamp)
+                    continue;
+                entry.query_stamp = stamp;
+
+                if (checkAABBAABBCollision(entry.box, box))
+                    result->push_back(cell[i]);
+            }
+        }
+    }
+}
+
+// Estado de uma chamada a Broadphase_Raycast().
+struct RayQuery
+{
+    BroadphaseGrid*          grid;
+    const Ray*               ray;
+    const BroadphaseRayTest* hit_test;
+    uint32_t                 stamp;
+    float                    best_distance;
+    uint32_t                 hit_id;
+    bool                     hit;
+};
+
+static void TestObjects(RayQuery* query, const std::vector<uint32_t>& objects)
+{
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        uint32_t id = objects[i];
+        BroadphaseEntry& entry = query->grid->entries[id];
+        if (entry.query_stamp == query->stamp)
+            continue;
+        entry.query_stamp = query->stamp;
+
+        float box_distance;
+        if (!checkRayAABBCollision(*query->ray, entry.box, &box_distance) || box_distance > query->best_distance)
+            continue;
+
+        float distance;
+        if ((*query->hit_test)(id, &distance) && distance >= 0.0f && distance <= query->best_distance)
+        {
+            query->best_distance = distance;
+            query->hit_id = id;
+            query->hit = true;
+        }
+    }
+}
+
+bool Broadphase_Raycast(BroadphaseGrid* grid, const Ray& ray, float max_distance, const BroadphaseRayTest& hit_test,
+                        uint32_t* hit_id, float* hit_distance)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    // Trecho [t_enter, t_exit] do raio dentro do retângulo da grade, no plano
+    // XZ. Se o raio não passa pela grade, só objetos da lista "outside"
+    // podem ser atingidos; percorremos então as células a partir da mais
+    // próxima da origem, o que é inofensivo.
+    float max_x = grid->min_x + grid->num_cells_x * grid->cell_size;
+    float max_z = grid->min_z + grid->num_cells_z * grid->cell_size;
+
+    float t_enter = 0.0f;
+    float t_exit = max_distance;
+
+    const float origin[2]    = { ray.origin.x, ray.origin.z };
+    const float direction[2] = { ray.direction.x, ray.direction.z };
+    const float lower[2]     = { grid->min_x, grid->min_z };
+    const float upper[2]     = { max_x, max_z };
+
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (direction[axis] == 0.0f)
+            continue;
+
+        float t0 = (lower[axis] - origin[axis]) / direction[axis];
+        float t1 = (upper[axis] - origin[axis]) / direction[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        t_enter = std::max(t_enter, t0);
+        t_exit = std::min(t_exit, t1);
+    }
+
+    if (t_enter > t_exit)
+    {
+        t_enter = 0.0f;
+        t_exit = max_distance;
+    }
+
+    // Célula inicial e passos de Amanatides e Woo.
+    float start_x = ray.origin.x + t_enter * ray.direction.x;
+    float start_z = ray.origin.z + t_enter * ray.direction.z;
+    int cell[2] = { CellX(*grid, start_x), CellZ(*grid, start_z) };
+    const int num_cells[2] = { grid->num_cells_x, grid->num_cells_z };
+
+    int   step[2];
+    float t_max[2];   // Valor de t na próxima fronteira de célula em cada eixo
+    float t_delta[2]; // Variação de t para atravessar uma célula em cada eixo
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (direction[axis] > 0.0f)
+        {
+            step[axis] = 1;
+            float boundary = lower[axis] + (cell[axis] + 1) * grid->cell_size;
+            t_max[axis] = (boundary - origin[axis]) / direction[axis];
+            t_delta[axis] = grid->cell_size / direction[axis];
+        }
+        else if (direction[axis] < 0.0f)
+        {
+            step[axis] = -1;
+            float boundary = lower[axis] + cell[axis] * grid->cell_size;
+            t_max[axis] = (boundary - origin[axis]) / direction[axis];
+            t_delta[axis] = -grid->cell_size / direction[axis];
+        }
+        else
+        {
+            step[axis] = 0;
+            t_max[axis] = infinity;
+            t_delta[axis] = infinity;
+        }
+    }
+
+    RayQuery query;
+    query.grid = grid;
+    query.ray = &ray;
+    query.hit_test = &hit_test;
+    query.stamp = NextQueryStamp(grid);
+    query.best_distance = max_distance;
+    query.hit = false;
+
+    // Objetos que saem da grade podem ser atingidos fora das células
+    // percorridas abaixo, então sempre são testados.
+    TestObjects(&query, grid->outside);
+
+    for (;;)
+    {
+        TestObjects(&query, Cell(grid, cell[0], cell[1]));
+        float best_distance = query.best_distance;
+
+        // Qualquer objeto ainda não testado só pode ser atingido depois do
+        // final desta célula.
+        float t_cell_exit = std::min(t_max[0], t_max[1]);
+        if (best_distance <= t_cell_exit || t_cell_exit > t_exit)
+            break;
+
+        int axis = (t_max[0] < t_max[1]) ? 0 : 1;
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= num_cells[axis])
+            break;
+        t_max[axis] += t_delta[axis];
+    }
+
+    if (query.hit)
+    {
+        *hit_id = query.hit_id;
+        *hit_distance = query.best_distance;
+    }
+    return query.hit;
+}
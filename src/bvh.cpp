@@ -0,0 +1,357 @@
+#include "../include/bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+// Número de intervalos ("bins") em que os centróides são distribuídos ao
+// procurar o melhor plano de divisão em cada eixo.
+#define BVH_NUM_BINS 16
+
+// Folhas com até este número de triângulos são aceitas sem avaliar divisões.
+#define BVH_MIN_LEAF_SIZE 2
+
+// Custos relativos da SAH: atravessar um nó interno e testar um triângulo.
+#define BVH_TRAVERSAL_COST 1.0f
+#define BVH_INTERSECTION_COST 1.0f
+
+// Profundidade máxima da pilha de MeshBvh_Raycast(). Com a SAH a árvore fica
+// bem mais rasa que isso; se não, MeshBvh_Build() cria folhas maiores.
+#define BVH_MAX_DEPTH 64
+
+struct Bounds
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+static Bounds EmptyBounds()
+{
+    Bounds bounds;
+    bounds.min = glm::vec3(FLT_MAX);
+    bounds.max = glm::vec3(-FLT_MAX);
+    return bounds;
+}
+
+static void Grow(Bounds* bounds, const glm::vec3& point)
+{
+    bounds->min = glm::min(bounds->min, point);
+    bounds->max = glm::max(bounds->max, point);
+}
+
+static void Grow(Bounds* bounds, const Bounds& other)
+{
+    bounds->min = glm::min(bounds->min, other.min);
+    bounds->max = glm::max(bounds->max, other.max);
+}
+
+static float HalfArea(const Bounds& bounds)
+{
+    glm::vec3 e = bounds.max - bounds.min;
+    if (e.x < 0.0f)
+        return 0.0f;
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+// Dados de construção de um triângulo.
+struct BuildTriangle
+{
+    Bounds    bounds;
+    glm::vec3 centroid;
+};
+
+struct Builder
+{
+    const BuildTriangle*  triangles;
+    std::vector<uint32_t> order; // Permutação dos triângulos; cada folha é um intervalo contíguo
+    std::vector<BvhNode>* nodes;
+};
+
+static void SetNodeBounds(BvhNode* node, const Bounds& bounds)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        node->bbox_min[axis] = bounds.min[axis];
+        node->bbox_max[axis] = bounds.max[axis];
+    }
+}
+
+static void BuildNode(Builder* builder, uint32_t node_index, uint32_t first, uint32_t count, int depth)
+{
+    Bounds bounds = EmptyBounds();
+    Bounds centroid_bounds = EmptyBounds();
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        const BuildTriangle& triangle = builder->triangles[builder->order[i]];
+        Grow(&bounds, triangle.bounds);
+        Grow(&centroid_bounds, triangle.centroid);
+    }
+
+    SetNodeBounds(&(*builder->nodes)[node_index], bounds);
+    (*builder->nodes)[node_index].first = first;
+    (*builder->nodes)[node_index].count = count;
+
+    if (count <= BVH_MIN_LEAF_SIZE || depth >= BVH_MAX_DEPTH - 1)
+        return;
+
+    // Procuramos, nos três eixos, o plano entre dois bins com menor custo SAH.
+    float best_cost = FLT_MAX;
+    int   best_axis = -1;
+    int   best_split = 0;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float axis_min = centroid_bounds.min[axis];
+        float axis_extent = centroid_bounds.max[axis] - axis_min;
+        if (axis_extent <= 0.0f)
+            continue;
+
+        Bounds   bin_bounds[BVH_NUM_BINS];
+        uint32_t bin_count[BVH_NUM_BINS];
+        for (int bin = 0; bin < BVH_NUM_BINS; ++bin)
+        {
+            bin_bounds[bin] = EmptyBounds();
+            bin_count[bin] = 0;
+        }
+
+        float scale = BVH_NUM_BINS / axis_extent;
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            const BuildTriangle& triangle = builder->triangles[builder->order[i]];
+            int bin = std::min((int)((triangle.centroid[axis] - axis_min) * scale), BVH_NUM_BINS - 1);
+            bin_count[bin] += 1;
+            Grow(&bin_bounds[bin], triangle.bounds);
+        }
+
+        // Varredura da direita para a esquerda com as áreas dos sufixos, e
+        // depois da esquerda para a direita avaliando cada plano.
+        float    right_area[BVH_NUM_BINS];
+        uint32_t right_count[BVH_NUM_BINS];
+        Bounds   right = EmptyBounds();
+        uint32_t right_total = 0;
+        for (int bin = BVH_NUM_BINS - 1; bin > 0; --bin)
+        {
+            Grow(&right, bin_bounds[bin]);
+            right_total += bin_count[bin];
+            right_area[bin] = HalfArea(right);
+            right_count[bin] = right_total;
+        }
+
+        Bounds   left = EmptyBounds();
+        uint32_t left_total = 0;
+        for (int split = 1; split < BVH_NUM_BINS; ++split)
+        {
+            Grow(&left, bin_bounds[split - 1]);
+            left_total += bin_count[split - 1];
+            if (left_total == 0 || right_count[split] == 0)
+                continue;
+
+            float cost = HalfArea(left) * left_total + right_area[split] * right_count[split];
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = split;
+            }
+        }
+    }
+
+    // Custo de não dividir: testar todos os triângulos do nó.
+    float parent_area = HalfArea(bounds);
+    float leaf_cost = BVH_INTERSECTION_COST * count;
+    float split_cost = BVH_TRAVERSAL_COST + BVH_INTERSECTION_COST * best_cost / std::max(parent_area, FLT_MIN);
+    if (best_axis < 0 || split_cost >= leaf_cost)
+        return;
+
+    float axis_min = centroid_bounds.min[best_axis];
+    float scale = BVH_NUM_BINS / (centroid_bounds.max[best_axis] - axis_min);
+    uint32_t* begin = builder->order.data() + first;
+    uint32_t* middle = std::partition(begin, begin + count, [&](uint32_t id) {
+        int bin = std::min((int)((builder->triangles[id].centroid[best_axis] - axis_min) * scale), BVH_NUM_BINS - 1);
+        return bin < best_split;
+    });
+    uint32_t left_count = (uint32_t)(middle - begin);
+    if (left_count == 0 || left_count == count)
+        return;
+
+    uint32_t left_index = (uint32_t)builder->nodes->size();
+    builder->nodes->resize(left_index + 2);
+    (*builder->nodes)[node_index].first = left_index;
+    (*builder->nodes)[node_index].count = 0;
+
+    BuildNode(builder, left_index, first, left_count, depth + 1);
+    BuildNode(builder, left_index + 1, first + left_count, count - left_count, depth + 1);
+}
+
+void MeshBvh_Build(MeshBvh* bvh, const glm::vec3* vertices, size_t num_triangles)
+{
+    bvh->nodes.clear();
+    bvh->triangles.clear();
+    bvh->triangle_ids.clear();
+
+    if (num_triangles == 0)
+        return;
+
+    std::vector<BuildTriangle> triangles(num_triangles);
+    for (size_t i = 0; i < num_triangles; ++i)
+    {
+        Bounds bounds = EmptyBounds();
+        Grow(&bounds, vertices[3*i + 0]);
+        Grow(&bounds, vertices[3*i + 1]);
+        Grow(&bounds, vertices[3*i + 2]);
+        triangles[i].bounds = bounds;
+        triangles[i].centroid = (vertices[3*i + 0] + vertices[3*i + 1] + vertices[3*i + 2]) / 3.0f;
+    }
+
+    Builder builder;
+    builder.triangles = triangles.data();
+    builder.order.resize(num_triangles);
+    for (size_t i = 0; i < num_triangles; ++i)
+        builder.order[i] = (uint32_t)i;
+    builder.nodes = &bvh->nodes;
+
+    bvh->nodes.reserve(2 * num_triangles);
+    bvh->nodes.resize(1);
+    BuildNode(&builder, 0, 0, (uint32_t)num_triangles, 0);
+    bvh->nodes.shrink_to_fit();
+
+    // Copiamos os triângulos na ordem das folhas, para que a leitura durante
+    // a travessia seja sequencial.
+    bvh->triangles.resize(3 * num_triangles);
+    bvh->triangle_ids.resize(num_triangles);
+    for (size_t i = 0; i < num_triangles; ++i)
+    {
+        uint32_t id = builder.order[i];
+        bvh->triangles[3*i + 0] = vertices[3*id + 0];
+        bvh->triangles[3*i + 1] = vertices[3*id + 1];
+        bvh->triangles[3*i + 2] = vertices[3*id + 2];
+        bvh->triangle_ids[i] = id;
+    }
+}
+
+// Distância de entrada do raio na caixa do nó, ou FLT_MAX se não atinge
+// (ou se atinge depois de "max_distance").
+static float IntersectNode(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inv_direction, float max_distance)
+{
+    float t_near = 0.0f;
+    float t_far = max_distance;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float t0 = (node.bbox_min[axis] - origin[axis]) * inv_direction[axis];
+        float t1 = (node.bbox_max[axis] - origin[axis]) * inv_direction[axis];
+        t_near = std::max(t_near, std::min(t0, t1));
+        t_far = std::min(t_far, std::max(t0, t1));
+    }
+    return (t_near <= t_far) ? t_near : FLT_MAX;
+}
+
+// Interseção raio-triângulo de Möller e Trumbore.
+static bool IntersectTriangle(const glm::vec3* triangle, const glm::vec3& origin, const glm::vec3& direction, float* t)
+{
+    const float epsilon = 1e-9f;
+
+    glm::vec3 edge1 = triangle[1] - triangle[0];
+    glm::vec3 edge2 = triangle[2] - triangle[0];
+    glm::vec3 p = glm::cross(direction, edge2);
+    float det = glm::dot(edge1, p);
+    if (std::abs(det) < epsilon)
+        return false;
+
+    float inv_det = 1.0f / det;
+    glm::vec3 s = origin - triangle[0];
+    float u = glm::dot(s, p) * inv_det;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(direction, q) * inv_det;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+
+    *t = glm::dot(edge2, q) * inv_det;
+    return true;
+}
+
+bool MeshBvh_Raycast(const MeshBvh& bvh, const Ray& ray, float max_distance, BvhHit* hit)
+{
+    if (bvh.nodes.empty())
+        return false;
+
+    glm::vec3 inv_direction = 1.0f / ray.direction;
+
+    float best_distance = max_distance;
+    uint32_t best_triangle = 0;
+    bool found = false;
+
+    if (IntersectNode(bvh.nodes[0], ray.origin, inv_direction, best_distance) == FLT_MAX)
+        return false;
+
+    uint32_t stack[BVH_MAX_DEPTH];
+    int stack_size = 0;
+    uint32_t node_index = 0;
+
+    for (;;)
+    {
+        const BvhNode& node = bvh.nodes[node_index];
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                float t;
+                if (IntersectTriangle(&bvh.triangles[3*i], ray.origin, ray.direction, &t)
+                    && t >= 0.0f && t <= best_distance)
+                {
+                    best_distance = t;
+                    best_triangle = bvh.triangle_ids[i];
+                    found = true;
+                }
+            }
+        }
+        else
+        {
+            // Visitamos primeiro o filho mais próximo; o outro vai para a
+            // pilha e é descartado se, ao sair dela, já está mais longe que
+            // o melhor triângulo encontrado.
+            uint32_t child_near = node.first;
+            uint32_t child_far = node.first + 1;
+            float t_near = IntersectNode(bvh.nodes[child_near], ray.origin, inv_direction, best_distance);
+            float t_far = IntersectNode(bvh.nodes[child_far], ray.origin, inv_direction, best_distance);
+            if (t_far < t_near)
+            {
+                std::swap(child_near, child_far);
+                std::swap(t_near, t_far);
+            }
+
+            if (t_near != FLT_MAX)
+            {
+                if (t_far != FLT_MAX)
+                    stack[stack_size++] = child_far;
+                node_index = child_near;
+                continue;
+            }
+        }
+
+        // Próximo nó da pilha que ainda pode conter um triângulo mais próximo.
+        bool next = false;
+        while (stack_size > 0)
+        {
+            node_index = stack[--stack_size];
+            if (IntersectNode(bvh.nodes[node_index], ray.origin, inv_direction, best_distance) != FLT_MAX)
+            {
+                next = true;
+                break;
+            }
+        }
+        if (!next)
+            break;
+    }
+
+    if (found)
+    {
+        hit->distance = best_distance;
+        hit->triangle = best_triangle;
+    }
+    return found;
+}
@@ -1,10 +1,24 @@
 #include "../include/collisions.h"
+#include <cfloat>
 #include <glm/glm.hpp>
-#include "../include/matrices.h"
+
+// As versões SIMD existem somente para x86-64, onde SSE2 está sempre
+// disponível. AVX2 é verificado em tempo de execução, e as funções que o
+// utilizam são compiladas com o atributo "target", sem exigir -mavx2 para o
+// programa inteiro.
+#if defined(__x86_64__) || defined(_M_X64)
+  #define COLLISIONS_HAVE_SIMD
+  #include <immintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+    #define COLLISIONS_TARGET_AVX2
+  #else
+    #define COLLISIONS_TARGET_AVX2 __attribute__((target("avx2")))
+  #endif
+#endif
 
 bool checkSpherePlaneCollision(const Sphere& sphere, const Plane& plane) {
-    float signedDistance = dotproduct(glm::vec4(plane.normal, 0.0f),
-                                         glm::vec4(sphere.center, 0.0f)) + plane.distance;
+    float signedDistance = glm::dot(plane.normal, sphere.center) + plane.distance;
     return glm::abs(signedDistance) <= sphere.radius;
 }
 
@@ -19,8 +33,573 @@ bool checkRayAABBCollision(const Ray& ray, const AABB& box) {
     return tNear <= tFar && tFar >= 0.0f;
 }
 
+bool checkRayAABBCollision(const Ray& ray, const AABB& box, float* distance) {
+    glm::vec3 invDir = 1.0f / ray.direction;
+    glm::vec3 tMin = (box.min - ray.origin) * invDir;
+    glm::vec3 tMax = (box.max - ray.origin) * invDir;
+    glm::vec3 t1 = glm::min(tMin, tMax);
+    glm::vec3 t2 = glm::max(tMin, tMax);
+    float tNear = glm::max(glm::max(t1.x, t1.y), t1.z);
+    float tFar = glm::min(glm::min(t2.x, t2.y), t2.z);
+    if (tNear > tFar || tFar < 0.0f)
+        return false;
+    *distance = glm::max(tNear, 0.0f);
+    return true;
+}
+
+bool checkAABBAABBCollision(const AABB& box1, const AABB& box2) {
+    return box1.min.x <= box2.max.x && box1.max.x >= box2.min.x
+        && box1.min.y <= box2.max.y && box1.max.y >= box2.min.y
+        && box1.min.z <= box2.max.z && box1.max.z >= box2.min.z;
+}
+
+// Comparamos os quadrados, evitando a raiz quadrada de glm::distance().
 bool checkSphereSphereCollision(const Sphere& sphere1, const Sphere& sphere2) {
-    float distance = glm::distance(sphere1.center, sphere2.center);
+    glm::vec3 delta = sphere1.center - sphere2.center;
     float sum_radii = sphere1.radius + sphere2.radius;
-    return distance <= sum_radii;
+    return glm::dot(delta, delta) <= sum_radii * sum_radii;
+}
+
+Frustum extractFrustum(const glm::mat4& clip_matrix) {
+    // Um ponto está dentro do volume de recorte se -w <= x,y,z <= w, onde
+    // (x,y,z,w) = M*p. Cada desigualdade é um plano: por exemplo, x >= -w
+    // equivale a dot(linha 4 + linha 1 de M, p) >= 0. glm guarda as matrizes
+    // por colunas, então a linha i é (M[0][i], M[1][i], M[2][i], M[3][i]).
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+        rows[i] = glm::vec4(clip_matrix[0][i], clip_matrix[1][i], clip_matrix[2][i], clip_matrix[3][i]);
+
+    glm::vec4 coefficients[6] = {
+        rows[3] + rows[0],
+        rows[3] - rows[0],
+        rows[3] + rows[1],
+        rows[3] - rows[1],
+        rows[3] + rows[2],
+        rows[3] - rows[2],
+    };
+
+    Frustum frustum;
+    for (int i = 0; i < 6; ++i) {
+        glm::vec3 normal = glm::vec3(coefficients[i]);
+        float length = glm::length(normal);
+        frustum.planes[i].normal = normal / length;
+        frustum.planes[i].distance = coefficients[i].w / length;
+    }
+    return frustum;
+}
+
+// Para cada plano basta testar o vértice da caixa mais à frente na direção
+// da normal: se ele está atrás do plano, a caixa inteira está.
+bool checkFrustumAABBCollision(const Frustum& frustum, const AABB& box) {
+    for (int i = 0; i < 6; ++i) {
+        const Plane& plane = frustum.planes[i];
+        glm::vec3 farthest(plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+                           plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+                           plane.normal.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(plane.normal, farthest) + plane.distance < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+bool checkFrustumSphereCollision(const Frustum& frustum, const Sphere& sphere) {
+    for (int i = 0; i < 6; ++i) {
+        const Plane& plane = frustum.planes[i];
+        if (glm::dot(plane.normal, sphere.center) + plane.distance < -sphere.radius)
+            return false;
+    }
+    return true;
+}
+
+// Centro transformado normalmente; cada meia-extensão da nova caixa é a soma
+// das contribuições das três meias-extensões originais (em valor absoluto).
+AABB transformAABB(const AABB& box, const glm::mat4& model) {
+    glm::vec3 center = 0.5f * (box.min + box.max);
+    glm::vec3 extents = 0.5f * (box.max - box.min);
+
+    glm::vec3 new_center = glm::vec3(model * glm::vec4(center, 1.0f));
+    glm::vec3 new_extents(0.0f);
+    for (int column = 0; column < 3; ++column)
+        new_extents += glm::abs(glm::vec3(model[column])) * extents[column];
+
+    AABB result;
+    result.min = new_center - new_extents;
+    result.max = new_center + new_extents;
+    return result;
+}
+
+bool sweepSpherePlane(const Sphere& sphere, const glm::vec3& displacement, const Plane& plane,
+                      float* time, glm::vec3* normal) {
+    float signedDistance = glm::dot(plane.normal, sphere.center) + plane.distance;
+    glm::vec3 sideNormal = (signedDistance >= 0.0f) ? plane.normal : -plane.normal;
+    float distance = glm::abs(signedDistance);
+
+    // Velocidade de aproximação do plano (negativa se está se aproximando)
+    float approach = glm::dot(sideNormal, displacement);
+    if (approach >= 0.0f)
+        return false;
+
+    if (distance <= sphere.radius) {
+        *time = 0.0f;
+    } else {
+        float t = (distance - sphere.radius) / -approach;
+        if (t > 1.0f)
+            return false;
+        *time = t;
+    }
+
+    *normal = sideNormal;
+    return true;
+}
+
+// Com o movimento relativo p(t) = p + t*v, o contato acontece na menor raiz
+// de |p + t*v|^2 = R^2, onde R é a soma dos raios.
+bool sweepSphereSphere(const Sphere& sphere1, const glm::vec3& displacement1,
+                       const Sphere& sphere2, const glm::vec3& displacement2, float* time) {
+    glm::vec3 p = sphere1.center - sphere2.center;
+    glm::vec3 v = displacement1 - displacement2;
+    float sumRadii = sphere1.radius + sphere2.radius;
+
+    float b = glm::dot(p, v);
+    float c = glm::dot(p, p) - sumRadii * sumRadii;
+    if (c <= 0.0f) {
+        if (b >= 0.0f)
+            return false;
+        *time = 0.0f;
+        return true;
+    }
+
+    float a = glm::dot(v, v);
+    if (b >= 0.0f || a <= 0.0f)
+        return false;
+
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0f)
+        return false;
+
+    float t = (-b - glm::sqrt(discriminant)) / a;
+    if (t > 1.0f)
+        return false;
+    *time = t;
+    return true;
+}
+
+glm::vec3 moveSphereWithSliding(const Sphere& sphere, glm::vec3 displacement, const Plane* planes, size_t num_planes) {
+    // A esfera para um pouco antes do plano, para que no próximo passo não
+    // comece já encostada nele por erro de arredondamento.
+    const float skin = 1e-3f;
+    // Em um canto, cada iteração desliza ao longo de mais um plano.
+    const int maxIterations = 4;
+
+    Sphere moving = sphere;
+    for (int iteration = 0; iteration < maxIterations; ++iteration) {
+        float firstTime = FLT_MAX;
+        glm::vec3 firstNormal(0.0f);
+        for (size_t i = 0; i < num_planes; ++i) {
+            float time;
+            glm::vec3 normal;
+            if (sweepSpherePlane(moving, displacement, planes[i], &time, &normal) && time < firstTime) {
+                firstTime = time;
+                firstNormal = normal;
+            }
+        }
+
+        if (firstTime == FLT_MAX) {
+            moving.center += displacement;
+            break;
+        }
+
+        moving.center += displacement * firstTime + firstNormal * skin;
+        displacement *= 1.0f - firstTime;
+        displacement -= firstNormal * glm::dot(displacement, firstNormal);
+    }
+    return moving.center;
+}
+
+void clearBatch(SphereBatch* batch) {
+    batch->center_x.clear();
+    batch->center_y.clear();
+    batch->center_z.clear();
+    batch->radius.clear();
+}
+
+void clearBatch(PlaneBatch* batch) {
+    batch->normal_x.clear();
+    batch->normal_y.clear();
+    batch->normal_z.clear();
+    batch->distance.clear();
+}
+
+void clearBatch(AABBBatch* batch) {
+    batch->min_x.clear();
+    batch->min_y.clear();
+    batch->min_z.clear();
+    batch->max_x.clear();
+    batch->max_y.clear();
+    batch->max_z.clear();
+}
+
+void addToBatch(SphereBatch* batch, const Sphere& sphere) {
+    batch->center_x.push_back(sphere.center.x);
+    batch->center_y.push_back(sphere.center.y);
+    batch->center_z.push_back(sphere.center.z);
+    batch->radius.push_back(sphere.radius);
+}
+
+void addToBatch(PlaneBatch* batch, const Plane& plane) {
+    batch->normal_x.push_back(plane.normal.x);
+    batch->normal_y.push_back(plane.normal.y);
+    batch->normal_z.push_back(plane.normal.z);
+    batch->distance.push_back(plane.distance);
+}
+
+void addToBatch(AABBBatch* batch, const AABB& box) {
+    batch->min_x.push_back(box.min.x);
+    batch->min_y.push_back(box.min.y);
+    batch->min_z.push_back(box.min.z);
+    batch->max_x.push_back(box.max.x);
+    batch->max_y.push_back(box.max.y);
+    batch->max_z.push_back(box.max.z);
+}
+
+// Detecção do conjunto de instruções
+
+static CollisionSimdLevel DetectSimdLevel() {
+#ifdef COLLISIONS_HAVE_SIMD
+  #ifdef _MSC_VER
+    // AVX2 precisa do suporte do processador (CPUID 7, EBX bit 5) e do
+    // sistema operacional, que deve salvar os registradores YMM (XGETBV).
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    if (osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6)
+        return COLLISION_SIMD_AVX2;
+  #else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return COLLISION_SIMD_AVX2;
+  #endif
+    return COLLISION_SIMD_SSE;
+#else
+    return COLLISION_SIMD_SCALAR;
+#endif
+}
+
+static const CollisionSimdLevel g_SupportedSimdLevel = DetectSimdLevel();
+static CollisionSimdLevel g_SimdLevel = g_SupportedSimdLevel;
+
+CollisionSimdLevel getSupportedCollisionSimdLevel() {
+    return g_SupportedSimdLevel;
+}
+
+CollisionSimdLevel getCollisionSimdLevel() {
+    return g_SimdLevel;
+}
+
+void setCollisionSimdLevel(CollisionSimdLevel level) {
+    g_SimdLevel = (level < g_SupportedSimdLevel) ? level : g_SupportedSimdLevel;
+}
+
+const char* collisionSimdLevelName(CollisionSimdLevel level) {
+    switch (level) {
+        case COLLISION_SIMD_SCALAR: return "scalar";
+        case COLLISION_SIMD_SSE:    return "sse";
+        case COLLISION_SIMD_AVX2:   return "avx2";
+    }
+    return "unknown";
+}
+
+// Funções "Batch". Cada uma tem um laço escalar, que também trata os
+// últimos objetos quando N não é múltiplo da largura do vetor, e versões
+// SSE e AVX2 que processam os objetos de 4 em 4 ou de 8 em 8. Os bits de
+// cada grupo são escritos na máscara com um "or": como 32 é múltiplo de 4 e
+// de 8, um grupo nunca fica dividido entre duas palavras.
+
+static size_t CountBits(uint32_t bits) {
+    size_t count = 0;
+    for (; bits != 0; bits &= bits - 1)
+        ++count;
+    return count;
+}
+
+static void ClearMask(uint32_t* hit_mask, size_t count) {
+    for (size_t i = 0; i < COLLISION_MASK_WORDS(count); ++i)
+        hit_mask[i] = 0;
+}
+
+static size_t SphereSphereScalar(const Sphere& sphere, const SphereBatch& spheres, size_t first, size_t count,
+                                 uint32_t* hit_mask) {
+    size_t hits = 0;
+    for (size_t i = first; i < count; ++i) {
+        Sphere other;
+        other.center = glm::vec3(spheres.center_x[i], spheres.center_y[i], spheres.center_z[i]);
+        other.radius = spheres.radius[i];
+        if (checkSphereSphereCollision(sphere, other)) {
+            hit_mask[i / 32] |= 1u << (i % 32);
+            ++hits;
+        }
+    }
+    return hits;
+}
+
+static size_t SpherePlaneScalar(const Sphere& sphere, const PlaneBatch& planes, size_t first, size_t count,
+                                uint32_t* hit_mask, float* signed_distances) {
+    size_t hits = 0;
+    for (size_t i = first; i < count; ++i) {
+        glm::vec3 normal(planes.normal_x[i], planes.normal_y[i], planes.normal_z[i]);
+        float signed_distance = glm::dot(normal, sphere.center) + planes.distance[i];
+        if (signed_distances != NULL)
+            signed_distances[i] = signed_distance;
+        if (glm::abs(signed_distance) <= sphere.radius) {
+            hit_mask[i / 32] |= 1u << (i % 32);
+            ++hits;
+        }
+    }
+    return hits;
+}
+
+static size_t RayAABBScalar(const Ray& ray, const AABBBatch& boxes, size_t first, size_t count,
+                            uint32_t* hit_mask, float* distances) {
+    size_t hits = 0;
+    for (size_t i = first; i < count; ++i) {
+        AABB box;
+        box.min = glm::vec3(boxes.min_x[i], boxes.min_y[i], boxes.min_z[i]);
+        box.max = glm::vec3(boxes.max_x[i], boxes.max_y[i], boxes.max_z[i]);
+        float distance;
+        bool hit = checkRayAABBCollision(ray, box, &distance);
+        if (distances != NULL)
+            distances[i] = hit ? distance : FLT_MAX;
+        if (hit) {
+            hit_mask[i / 32] |= 1u << (i % 32);
+            ++hits;
+        }
+    }
+    return hits;
+}
+
+#ifdef COLLISIONS_HAVE_SIMD
+
+static size_t SphereSphereSSE(const Sphere& sphere, const SphereBatch& spheres, size_t count, uint32_t* hit_mask) {
+    const __m128 cx = _mm_set1_ps(sphere.center.x);
+    const __m128 cy = _mm_set1_ps(sphere.center.y);
+    const __m128 cz = _mm_set1_ps(sphere.center.z);
+    const __m128 r = _mm_set1_ps(sphere.radius);
+
+    size_t hits = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&spheres.center_x[i]), cx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&spheres.center_y[i]), cy);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(&spheres.center_z[i]), cz);
+        __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 sum_radii = _mm_add_ps(_mm_loadu_ps(&spheres.radius[i]), r);
+        __m128 hit = _mm_cmple_ps(distance2, _mm_mul_ps(sum_radii, sum_radii));
+
+        uint32_t bits = (uint32_t)_mm_movemask_ps(hit);
+        hit_mask[i / 32] |= bits << (i % 32);
+        hits += CountBits(bits);
+    }
+    return hits + SphereSphereScalar(sphere, spheres, i, count, hit_mask);
+}
+
+COLLISIONS_TARGET_AVX2
+static size_t SphereSphereAVX2(const Sphere& sphere, const SphereBatch& spheres, size_t count, uint32_t* hit_mask) {
+    const __m256 cx = _mm256_set1_ps(sphere.center.x);
+    const __m256 cy = _mm256_set1_ps(sphere.center.y);
+    const __m256 cz = _mm256_set1_ps(sphere.center.z);
+    const __m256 r = _mm256_set1_ps(sphere.radius);
+
+    size_t hits = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&spheres.center_x[i]), cx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&spheres.center_y[i]), cy);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(&spheres.center_z[i]), cz);
+        __m256 distance2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                         _mm256_mul_ps(dz, dz));
+        __m256 sum_radii = _mm256_add_ps(_mm256_loadu_ps(&spheres.radius[i]), r);
+        __m256 hit = _mm256_cmp_ps(distance2, _mm256_mul_ps(sum_radii, sum_radii), _CMP_LE_OQ);
+
+        uint32_t bits = (uint32_t)_mm256_movemask_ps(hit);
+        hit_mask[i / 32] |= bits << (i % 32);
+        hits += CountBits(bits);
+    }
+    return hits + SphereSphereScalar(sphere, spheres, i, count, hit_mask);
+}
+
+static size_t SpherePlaneSSE(const Sphere& sphere, const PlaneBatch& planes, size_t count, uint32_t* hit_mask,
+                             float* signed_distances) {
+    const __m128 cx = _mm_set1_ps(sphere.center.x);
+    const __m128 cy = _mm_set1_ps(sphere.center.y);
+    const __m128 cz = _mm_set1_ps(sphere.center.z);
+    const __m128 r = _mm_set1_ps(sphere.radius);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+
+    size_t hits = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&planes.normal_x[i]), cx),
+                                         _mm_mul_ps(_mm_loadu_ps(&planes.normal_y[i]), cy)),
+                              _mm_mul_ps(_mm_loadu_ps(&planes.normal_z[i]), cz));
+        d = _mm_add_ps(d, _mm_loadu_ps(&planes.distance[i]));
+        if (signed_distances != NULL)
+            _mm_storeu_ps(&signed_distances[i], d);
+        __m128 hit = _mm_cmple_ps(_mm_andnot_ps(sign, d), r);
+
+        uint32_t bits = (uint32_t)_mm_movemask_ps(hit);
+        hit_mask[i / 32] |= bits << (i % 32);
+        hits += CountBits(bits);
+    }
+    return hits + SpherePlaneScalar(sphere, planes, i, count, hit_mask, signed_distances);
+}
+
+COLLISIONS_TARGET_AVX2
+static size_t SpherePlaneAVX2(const Sphere& sphere, const PlaneBatch& planes, size_t count, uint32_t* hit_mask,
+                              float* signed_distances) {
+    const __m256 cx = _mm256_set1_ps(sphere.center.x);
+    const __m256 cy = _mm256_set1_ps(sphere.center.y);
+    const __m256 cz = _mm256_set1_ps(sphere.center.z);
+    const __m256 r = _mm256_set1_ps(sphere.radius);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+
+    size_t hits = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&planes.normal_x[i]), cx),
+                                               _mm256_mul_ps(_mm256_loadu_ps(&planes.normal_y[i]), cy)),
+                                 _mm256_mul_ps(_mm256_loadu_ps(&planes.normal_z[i]), cz));
+        d = _mm256_add_ps(d, _mm256_loadu_ps(&planes.distance[i]));
+        if (signed_distances != NULL)
+            _mm256_storeu_ps(&signed_distances[i], d);
+        __m256 hit = _mm256_cmp_ps(_mm256_andnot_ps(sign, d), r, _CMP_LE_OQ);
+
+        uint32_t bits = (uint32_t)_mm256_movemask_ps(hit);
+        hit_mask[i / 32] |= bits << (i % 32);
+        hits += CountBits(bits);
+    }
+    return hits + SpherePlaneScalar(sphere, planes, i, count, hit_mask, signed_distances);
+}
+
+// O método das "slabs" de checkRayAABBCollision(), com as mesmas operações
+// na mesma ordem. _mm_min_ps(a, b) e _mm_max_ps(a, b) retornam "b" quando há
+// NaN (raio paralelo a uma face, com a origem sobre ela), enquanto
+// glm::min(a, b) e glm::max(a, b) retornam "a": por isso os operandos estão
+// invertidos, e os resultados são idênticos aos da versão escalar.
+static size_t RayAABBSSE(const Ray& ray, const AABBBatch& boxes, size_t count, uint32_t* hit_mask,
+                         float* distances) {
+    glm::vec3 inv_direction = 1.0f / ray.direction;
+    const __m128 ox = _mm_set1_ps(ray.origin.x);
+    const __m128 oy = _mm_set1_ps(ray.origin.y);
+    const __m128 oz = _mm_set1_ps(ray.origin.z);
+    const __m128 ix = _mm_set1_ps(inv_direction.x);
+    const __m128 iy = _mm_set1_ps(inv_direction.y);
+    const __m128 iz = _mm_set1_ps(inv_direction.z);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 no_hit = _mm_set1_ps(FLT_MAX);
+
+    size_t hits = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.min_x[i]), ox), ix);
+        __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.max_x[i]), ox), ix);
+        __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.min_y[i]), oy), iy);
+        __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.max_y[i]), oy), iy);
+        __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.min_z[i]), oz), iz);
+        __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.max_z[i]), oz), iz);
+
+        __m128 t_near = _mm_max_ps(_mm_min_ps(t1z, t0z), _mm_max_ps(_mm_min_ps(t1y, t0y), _mm_min_ps(t1x, t0x)));
+        __m128 t_far = _mm_min_ps(_mm_max_ps(t1z, t0z), _mm_min_ps(_mm_max_ps(t1y, t0y), _mm_max_ps(t1x, t0x)));
+        __m128 hit = _mm_and_ps(_mm_cmpngt_ps(t_near, t_far), _mm_cmpnlt_ps(t_far, zero));
+
+        if (distances != NULL) {
+            __m128 distance = _mm_max_ps(zero, t_near);
+            _mm_storeu_ps(&distances[i], _mm_or_ps(_mm_and_ps(hit, distance), _mm_andnot_ps(hit, no_hit)));
+        }
+
+        uint32_t bits = (uint32_t)_mm_movemask_ps(hit);
+        hit_mask[i / 32] |= bits << (i % 32);
+        hits += CountBits(bits);
+    }
+    return hits + RayAABBScalar(ray, boxes, i, count, hit_mask, distances);
+}
+
+COLLISIONS_TARGET_AVX2
+static size_t RayAABBAVX2(const Ray& ray, const AABBBatch& boxes, size_t count, uint32_t* hit_mask,
+                          float* distances) {
+    glm::vec3 inv_direction = 1.0f / ray.direction;
+    const __m256 ox = _mm256_set1_ps(ray.origin.x);
+    const __m256 oy = _mm256_set1_ps(ray.origin.y);
+    const __m256 oz = _mm256_set1_ps(ray.origin.z);
+    const __m256 ix = _mm256_set1_ps(inv_direction.x);
+    const __m256 iy = _mm256_set1_ps(inv_direction.y);
+    const __m256 iz = _mm256_set1_ps(inv_direction.z);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 no_hit = _mm256_set1_ps(FLT_MAX);
+
+    size_t hits = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 t0x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.min_x[i]), ox), ix);
+        __m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.max_x[i]), ox), ix);
+        __m256 t0y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.min_y[i]), oy), iy);
+        __m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.max_y[i]), oy), iy);
+        __m256 t0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.min_z[i]), oz), iz);
+        __m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.max_z[i]), oz), iz);
+
+        __m256 t_near = _mm256_max_ps(_mm256_min_ps(t1z, t0z),
+                                      _mm256_max_ps(_mm256_min_ps(t1y, t0y), _mm256_min_ps(t1x, t0x)));
+        __m256 t_far = _mm256_min_ps(_mm256_max_ps(t1z, t0z),
+                                     _mm256_min_ps(_mm256_max_ps(t1y, t0y), _mm256_max_ps(t1x, t0x)));
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(t_near, t_far, _CMP_NGT_UQ), _mm256_cmp_ps(t_far, zero, _CMP_NLT_UQ));
+
+        if (distances != NULL)
+            _mm256_storeu_ps(&distances[i], _mm256_blendv_ps(no_hit, _mm256_max_ps(zero, t_near), hit));
+
+        uint32_t bits = (uint32_t)_mm256_movemask_ps(hit);
+        hit_mask[i / 32] |= bits << (i % 32);
+        hits += CountBits(bits);
+    }
+    return hits + RayAABBScalar(ray, boxes, i, count, hit_mask, distances);
+}
+
+#endif // COLLISIONS_HAVE_SIMD
+
+size_t checkSphereSphereCollisionBatch(const Sphere& sphere, const SphereBatch& spheres, uint32_t* hit_mask) {
+    size_t count = spheres.radius.size();
+    ClearMask(hit_mask, count);
+#ifdef COLLISIONS_HAVE_SIMD
+    if (g_SimdLevel == COLLISION_SIMD_AVX2)
+        return SphereSphereAVX2(sphere, spheres, count, hit_mask);
+    if (g_SimdLevel == COLLISION_SIMD_SSE)
+        return SphereSphereSSE(sphere, spheres, count, hit_mask);
+#endif
+    return SphereSphereScalar(sphere, spheres, 0, count, hit_mask);
+}
+
+size_t checkSpherePlaneCollisionBatch(const Sphere& sphere, const PlaneBatch& planes, uint32_t* hit_mask,
+                                      float* signed_distances) {
+    size_t count = planes.distance.size();
+    ClearMask(hit_mask, count);
+#ifdef COLLISIONS_HAVE_SIMD
+    if (g_SimdLevel == COLLISION_SIMD_AVX2)
+        return SpherePlaneAVX2(sphere, planes, count, hit_mask, signed_distances);
+    if (g_SimdLevel == COLLISION_SIMD_SSE)
+        return SpherePlaneSSE(sphere, planes, count, hit_mask, signed_distances);
+#endif
+    return SpherePlaneScalar(sphere, planes, 0, count, hit_mask, signed_distances);
+}
+
+size_t checkRayAABBCollisionBatch(const Ray& ray, const AABBBatch& boxes, uint32_t* hit_mask, float* distances) {
+    size_t count = boxes.min_x.size();
+    ClearMask(hit_mask, count);
+#ifdef COLLISIONS_HAVE_SIMD
+    if (g_SimdLevel == COLLISION_SIMD_AVX2)
+        return RayAABBAVX2(ray, boxes, count, hit_mask, distances);
+    if (g_SimdLevel == COLLISION_SIMD_SSE)
+        return RayAABBSSE(ray, boxes, count, hit_mask, distances);
+#endif
+    return RayAABBScalar(ray, boxes, 0, count, hit_mask, distances);
 }
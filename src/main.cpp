@@ -10,9 +10,11 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 // Headers abaixo são específicos de C++
 #include <map>
+#include <unordered_map>
 #include <stack>
 #include <string>
 #include <vector>
@@ -22,6 +24,7 @@
 #include <stdexcept>
 #include <algorithm>
 #include <ctime>
+#include <memory>
 
 // Adicionamos a implementação da biblioteca de leitura de imagens
 #define STB_IMAGE_IMPLEMENTATION
@@ -42,27 +45,27 @@
 // Headers locais, definidos na pasta "include/"
 #include "utils.h"
 #include "matrices.h"
+#include "assetloader.h"
+#include "benchmark.h"
+#include "bezierpath.h"
+#include "broadphase.h"
+#include "bvh.h"
 #include "collisions.h"
+#include "material.h"
+#include "meshcache.h"
+#include "meshopt.h"
+#include "normals.h"
+#include "profiler.h"
+#include "renderqueue.h"
+#include "shadercache.h"
+#include "texturecache.h"
+#include "texturestreaming.h"
+#include "timestep.h"
+#include "vertexformat.h"
 #include <set>
 
 bool g_UseLookAtCamera = false;
 
-// Function to calculate a point on a cubic Bezier curve
-glm::vec3 CalculateBezierPoint(float t, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) {
-    float u = 1.0f - t;
-    float tt = t * t;
-    float uu = u * u;
-    float uuu = uu * u;
-    float ttt = tt * t;
-
-    glm::vec3 p = uuu * p0; // (1-t)^3 * P0
-    p += 3.0f * uu * t * p1; // 3 * (1-t)^2 * t * P1
-    p += 3.0f * u * tt * p2; // 3 * (1-t) * t^2 * P2
-    p += ttt * p3; // t^3 * P3
-
-    return p;
-}
-
 // Estrutura que representa um modelo geométrico carregado a partir de um
 // arquivo ".obj". Veja https://en.wikipedia.org/wiki/Wavefront_.obj_file .
 struct ObjModel
@@ -125,22 +128,36 @@ struct ObjModel
 void PushMatrix(glm::mat4 M);
 void PopMatrix(glm::mat4& M);
 
+// Identificador de um objeto da cena virtual: sua posição no vetor
+// g_VirtualScene. Veja AddSceneObject() e FindSceneObject().
+typedef uint32_t SceneObjectHandle;
+#define INVALID_SCENE_OBJECT ((SceneObjectHandle)~0u)
+
 // Declaração de várias funções utilizadas em main().  Essas estão definidas
 // logo após a definição de main() neste arquivo.
-void DrawCube(GLint render_as_black_uniform); // Desenha um cubo
-void DrawLine(GLint render_as_black_uniform);
+void DrawCube(const glm::mat4& model, GLint object_id); // Desenha um cubo
+void DrawLine(const glm::mat4& model, GLint object_id);
+void DrawCubeInstanced(const InstanceData* instances, size_t num_instances); // Desenha várias cópias de um cubo
 GLuint BuildLine();
 GLuint BuildPlane();
 void BuildTrianglesAndAddToVirtualScene(ObjModel*); // Constrói representação de um ObjModel como malha de triângulos
+void BuildMeshGeometry(ObjModel* model, MeshGeometry* geometry); // Monta os vetores de atributos de um ObjModel na CPU
+void AddMeshToVirtualScene(const MeshView& mesh); // Envia uma malha para a GPU e a adiciona em g_VirtualScene
+void LoadObjModelToVirtualScene(const char* filename); // Carrega um ".obj" (ou seu cache binário) para g_VirtualScene
 void ComputeNormals(ObjModel* model); // Computa normais de um ObjModel, caso não existam.
-void DrawVirtualObject(const char* object_name); // Desenha um objeto armazenado em g_VirtualScene
+void DrawVirtualObject(SceneObjectHandle object, const glm::mat4& model, GLint object_id,
+                       bool render_as_black = false, float line_width = 1.0f); // Desenha um objeto armazenado em g_VirtualScene
+void DrawVirtualObjectInstanced(SceneObjectHandle object, const InstanceData* instances, size_t num_instances,
+                                bool render_as_black = false, float line_width = 1.0f); // Desenha várias cópias de um objeto
 GLuint BuildTriangles(); // Constrói triângulos para renderização
-void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU
-void LoadTextureImage(const char* filename); // Função que carrega imagens de textura
-GLuint LoadShader_Vertex(const char* filename);   // Carrega um vertex shader
-GLuint LoadShader_Fragment(const char* filename); // Carrega um fragment shader
-void LoadShader(const char* filename, GLuint shader_id); // Função utilizada pelas duas acima
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Cria um programa de GPU
+void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento e inicia a criação dos programas de GPU
+bool FinishShadersFromFiles(bool wait); // Termina os programas de GPU criados acima e busca seus "uniforms"
+void LoadTextureImage(const char* filename); // Função que carrega imagens de textura (de forma assíncrona)
+void UploadTextureImage(const unsigned char* data, int width, int height, GLuint textureunit); // Envia uma imagem para a GPU
+void UploadCompressedTextureImage(CompressedTexture* texture, GLuint textureunit); // Envia uma textura comprimida para a GPU
+bool HasOpenGLExtension(const char* name); // Verifica se o driver suporta uma extensão OpenGL
+std::string ReadShaderSource(const char* filename); // Lê o código de um shader GLSL
+std::string InjectShaderDefines(const std::string& source, const std::string& defines); // Insere "#define"s após "#version"
 
 // Declaração de funções auxiliares para renderizar texto dentro da janela
 // OpenGL. Estas funções estão definidas no arquivo "textrendering.cpp".
@@ -148,12 +165,22 @@ void TextRendering_Init();
 float TextRendering_LineHeight(GLFWwindow* window);
 float TextRendering_CharWidth(GLFWwindow* window);
 void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f);
+void TextRendering_Flush();
 void TextRendering_PrintMatrix(GLFWwindow* window, glm::mat4 M, float x, float y, float scale = 1.0f);
 void TextRendering_PrintVector(GLFWwindow* window, glm::vec4 v, float x, float y, float scale = 1.0f);
 void TextRendering_PrintMatrixVectorProduct(GLFWwindow* window, glm::mat4 M, glm::vec4 v, float x, float y, float scale = 1.0f);
 void TextRendering_PrintMatrixVectorProductMoreDigits(GLFWwindow* window, glm::mat4 M, glm::vec4 v, float x, float y, float scale = 1.0f);
 void TextRendering_PrintMatrixVectorProductDivW(GLFWwindow* window, glm::mat4 M, glm::vec4 v, float x, float y, float scale = 1.0f);
-void GenerateNewBezierPath(bool teleport);
+struct Target;
+void TeleportTarget(Target* target); // Leva o alvo para um novo ponto e caminho sorteados
+void SimulationStep(float dt); // Avança a simulação do jogo em um passo de tempo fixo
+void ResetInterpolation(); // Descarta a interpolação após um teletransporte
+void ResetTargetInterpolation(Target* target);
+glm::mat4 TargetModelMatrix(const Target& target); // Matriz "model" do alvo desenhado
+float TargetCollisionRadius(); // Raio da esfera de colisão dos alvos
+AABB TargetBounds(const Target& target); // AABB do alvo em g_TargetGrid
+bool RaycastTargets(const Ray& ray, uint32_t* hit_id, float* hit_distance); // Alvo mais próximo atingido por um raio
+void ApplyBenchmarkInput(int frame); // Entrada simulada do modo "--headless"
 
 // Funções abaixo renderizam como texto na janela OpenGL algumas matrizes e
 // outras informações do programa. Definidas após main().
@@ -161,6 +188,9 @@ void TextRendering_ShowModelViewProjection(GLFWwindow* window, glm::mat4 project
 void TextRendering_ShowEulerAngles(GLFWwindow* window);
 void TextRendering_ShowProjection(GLFWwindow* window);
 void TextRendering_ShowFramesPerSecond(GLFWwindow* window);
+void TextRendering_ShowLoadingProgress(GLFWwindow* window);
+void TextRendering_ShowRenderQueueStats(GLFWwindow* window);
+void TextRendering_ShowProfiler(GLFWwindow* window);
 
 // Funções callback para comunicação com o sistema operacional e interação do
 // usuário. Veja mais comentários nas definições das mesmas, abaixo.
@@ -179,24 +209,43 @@ struct SceneObject
     size_t       first_index; // Índice do primeiro vértice dentro do vetor indices[]
     size_t       num_indices; // Número de índices do objeto dentro do vetor indices[]
     GLenum       rendering_mode; // Modo de rasterização (GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.)
+    GLenum       index_type = GL_UNSIGNED_INT; // Tipo dos índices (GL_UNSIGNED_SHORT ou GL_UNSIGNED_INT)
+    GLint        base_vertex = 0; // Valor somado a cada índice antes de buscar os atributos do vértice
     GLuint       vertex_array_object_id; // ID do VAO onde estão armazenados os atributos do modelo
     glm::vec3    bbox_min; // Axis-Aligned Bounding Box do objeto
     glm::vec3    bbox_max;
+    std::shared_ptr<const MeshBvh> bvh; // Triângulos do objeto, para testes exatos de raios (somente modelos ".obj")
+    float        uv_density = 0.0f; // Unidades de coordenada de textura por unidade do espaço do modelo (0: desconhecida)
 };
 
+SceneObjectHandle AddSceneObject(const SceneObject& object); // Adiciona (ou substitui) um objeto em g_VirtualScene
+SceneObjectHandle FindSceneObject(const char* name); // Busca o handle de um objeto pelo nome
+
 // Abaixo definimos variáveis globais utilizadas em várias funções do código.
 
-// A cena virtual é uma lista de objetos nomeados, guardados em um dicionário
-// (map).  Veja dentro da função BuildTrianglesAndAddToVirtualScene() como que são incluídos
-// objetos dentro da variável g_VirtualScene, e veja na função main() como
-// estes são acessados.
-std::map<std::string, SceneObject> g_VirtualScene;
+// A cena virtual é uma lista contígua de objetos, acessados por índice
+// (SceneObjectHandle). Veja dentro da função AddMeshToVirtualScene() como que
+// são incluídos objetos dentro da variável g_VirtualScene. Os nomes dos
+// objetos são utilizados somente durante a inicialização, através de
+// FindSceneObject(); a cada quadro, os objetos são acessados pelos handles
+// abaixo, resolvidos uma única vez em main().
+std::vector<SceneObject> g_VirtualScene;
+std::unordered_map<std::string, SceneObjectHandle> g_VirtualSceneHandles; // Nome -> handle
+
+SceneObjectHandle g_CubeFacesObject = INVALID_SCENE_OBJECT;
+SceneObjectHandle g_CubeEdgesObject = INVALID_SCENE_OBJECT;
+SceneObjectHandle g_AxesObject      = INVALID_SCENE_OBJECT;
+SceneObjectHandle g_LineObject      = INVALID_SCENE_OBJECT;
+SceneObjectHandle g_PlaneObject     = INVALID_SCENE_OBJECT;
+SceneObjectHandle g_TargetObject    = INVALID_SCENE_OBJECT;
+SceneObjectHandle g_UspObjects[4]   = { INVALID_SCENE_OBJECT, INVALID_SCENE_OBJECT, INVALID_SCENE_OBJECT, INVALID_SCENE_OBJECT };
 
 // Pilha que guardará as matrizes de modelagem.
 std::stack<glm::mat4>  g_MatrixStack;
 
 // Razão de proporção da janela (largura/altura). Veja função FramebufferSizeCallback().
 float g_ScreenRatio = 1.0f;
+int g_ScreenHeight = 800; // Altura do framebuffer, em pixels
 
 // Ângulos de Euler que controlam a rotação de um dos cubos da cena virtual
 float g_AngleX = 0.0f;
@@ -216,6 +265,23 @@ glm::vec4 g_CameraViewVector;
 bool g_ShotHit = false;
 float g_ShotHitTimer = 0.0f;
 
+// Alvo sob a mira da câmera livre, atualizado a cada quadro por
+// RaycastTargets() (veja o laço principal em main()).
+bool g_AimOnTarget = false;
+uint32_t g_AimTarget = 0;
+float g_AimDistance = 0.0f;
+
+// Frustum da câmera no quadro atual, extraído de "projection * view". As
+// funções Draw*() descartam os objetos cuja AABB está fora dele, e contam em
+// g_CullingStats quantos foram desenhados e quantos foram descartados.
+Frustum g_ViewFrustum;
+struct CullingStats
+{
+    uint32_t drawn;
+    uint32_t culled;
+};
+CullingStats g_CullingStats = { 0, 0 };
+
 // Teclas que definem a movimentação de camera livre
 bool tecla_W_pressionada = false;
 bool tecla_A_pressionada = false;
@@ -244,30 +310,159 @@ bool g_UsePerspectiveProjection = true;
 // Variável que controla se o texto informativo será mostrado na tela.
 bool g_ShowInfoText = true;
 
-glm::vec3 g_TargetPosition = glm::vec3(5.0f, -0.6f, 20.0f);
+// Variável que controla se o tempo gasto em cada parte do quadro será
+// mostrado na tela (tecla F3). Veja profiler.h.
+bool g_ShowProfiler = false;
+
+// Arquivo onde o histórico do profiler é escrito ao final do programa, no
+// formato "Trace Event" do Chrome. Definido com "--trace arquivo"; NULL: o
+// histórico não é escrito.
+const char* g_ProfilerTracePath = NULL;
+
 bool g_TargetShow = true;
-float g_TargetAngle = 0.0f;
 const float INITIAL_TARGET_SCALE = 50.0f;
 float g_TargetScale = INITIAL_TARGET_SCALE;
 int g_TargetPhase = 1;
 const int MAX_TARGET_PHASES = 10;
+// Velocidade dos alvos ao longo dos seus caminhos, em unidades por segundo
+// (a arena tem 100 x 100 unidades).
+const float TARGET_PATH_SPEED = 17.0f;
+
+// Cada alvo percorre seu próprio caminho de curvas de Bézier cúbicas pela
+// arena. A escala (e a fase do jogo) é a mesma para todos os alvos.
+struct Target
+{
+    BezierPathStream path; // Caminho percorrido pelo alvo (veja bezierpath.h)
+    float     path_speed; // Velocidade ao longo do caminho, em unidades por segundo
+    glm::vec3 position;
+    float     angle;
+
+    // Estado no passo anterior da simulação. A renderização interpola entre
+    // este e o estado atual, de acordo com o tempo decorrido desde o último passo.
+    glm::vec3 previous_position;
+    float     previous_angle;
+
+    // Estado interpolado que foi desenhado no quadro atual. Utilizado pela
+    // seleção com o mouse, para que o jogador acerte o alvo que está vendo.
+    glm::vec3 render_position;
+    float     render_angle;
+};
+
+// Todos os alvos do jogo. O primeiro é o seguido pela câmera look-at. O
+// número de alvos pode ser alterado com "--targets N" na linha de comando.
+std::vector<Target> g_Targets;
+int g_NumTargets = 1;
+
+// Grade sobre a arena (X em [-50,50], Z em [0,100]) com a AABB de cada alvo,
+// indexada pela posição do alvo em g_Targets. Veja broadphase.h.
+BroadphaseGrid g_TargetGrid;
+const float TARGET_GRID_CELL_SIZE = 10.0f;
+
+// Matrizes de modelagem dos alvos do quadro atual, desenhados com um único
+// desenho instanciado.
+std::vector<InstanceData> g_TargetInstances;
+
+// A simulação (alvo, câmera livre e colisões) avança em passos de tempo
+// fixos, independentes da taxa de quadros; veja SimulationStep() e
+// timestep.h. Pode ser alterado com "--tick-rate N" na linha de comando.
+float g_SimulationStepsPerSecond = 60.0f;
+const int MAX_SIMULATION_STEPS_PER_FRAME = 5;
+
+// Posição da câmera livre, atualizada pela simulação.
+glm::vec4 g_FreeCameraPosition = glm::vec4(0.0f, 1.7f, 5.0f, 1.0f);
+
+// Posição da câmera livre no passo anterior da simulação, para interpolação.
+glm::vec4 g_PreviousFreeCameraPosition = g_FreeCameraPosition;
+
+// Modo de medida de desempenho ("--headless --frames N"): a janela fica
+// invisível, a entrada do usuário é substituída por um roteiro fixo (veja
+// ApplyBenchmarkInput()), cada quadro executa exatamente um passo da
+// simulação e, após N quadros, os resultados são escritos em JSON (veja
+// benchmark.h). Pode ser executado sem GPU com Mesa (llvmpipe) e um
+// servidor X virtual, por exemplo "xvfb-run ./main --headless --frames 1000".
+bool g_Headless = false;
+int g_HeadlessFrames = 1000;
+const char* g_BenchmarkOutputPath = "benchmark.json";
+
+// "--bench-collisions N": em vez do jogo, executa o microbenchmark dos testes
+// de colisão com N objetos (veja Benchmark_Collisions() em benchmark.h).
+int g_CollisionBenchmarkObjects = 0;
+
+// Paredes da arena, utilizadas para colisão com a câmera livre.
+const Plane g_ArenaWalls[4] = {
+  { glm::vec3( 0.0f, 0.0f,  1.0f),    0.0f },
+  { glm::vec3( 0.0f, 0.0f, -1.0f), -100.0f },
+  { glm::vec3( 1.0f, 0.0f,  0.0f),   50.0f },
+  { glm::vec3(-1.0f, 0.0f,  0.0f),  -50.0f },
+};
+
+// A GPU aceita texturas BC1 em sRGB? Se sim, as imagens são comprimidas uma
+// única vez e lidas do cache de texturas nas próximas execuções (veja
+// texturecache.h); se não, são decodificadas e enviadas sem compressão.
+bool g_UseCompressedTextures = false;
 
-std::vector<glm::vec3> g_ControlPoints;
-int g_CurrentSegment = 0;
-float g_BezierT = 0.0f;
-float g_BezierSpeed = 0.2f;
+// Texturas comprimidas são enviadas aos poucos, conforme o detalhe necessário
+// na tela (veja texturestreaming.h). Índice: unidade de textura; texturas sem
+// compressão ficam inteiras na GPU e não aparecem aqui.
+std::vector<StreamedTextureHandle> g_StreamedTextures;
+
+// "--texture-budget N": memória de vídeo para texturas comprimidas, em MB.
+int g_TextureBudgetMegabytes = 64;
+#define TEXTURE_UPLOAD_BYTES_PER_FRAME (4*1024*1024)
+
+// Tamanho, no mundo, da região coberta por um pixel a uma distância "d" da
+// câmera: g_PixelFootprintPerDistance * d + g_PixelFootprintConstant.
+// Atualizados junto com a matriz de projeção, a cada quadro.
+float g_PixelFootprintPerDistance = 0.0f;
+float g_PixelFootprintConstant = 0.0f;
 
-// Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
-GLuint g_GpuProgramID = 0;
 GLuint g_NumLoadedTextures = 0; // Adicionada para contar texturas carregadas
-GLint g_model_uniform;
-GLint g_view_uniform;
-GLint g_projection_uniform;
-GLint g_object_id_uniform; // [COPIADO DO main.cpp, LINHA 273]
 
-int main()
+// Programas de GPU (shaders): uma permutação de "shader_fragment.glsl" para
+// cada conjunto de recursos de material (veja material.h). Veja função
+// LoadShadersFromFiles().
+struct ShaderPermutation
 {
-  srand(time(NULL));
+    uint32_t       features;           // Máscara de MaterialFeature
+    PendingProgram pending;            // Programa sendo compilado pelo driver (veja shadercache.h)
+    RenderProgram  program;            // Programa e "uniforms" no formato da fila de renderização
+};
+std::vector<ShaderPermutation> g_ShaderPermutations;
+
+// Permutação de cada máscara de MaterialFeature. Preenchido em FinishShadersFromFiles().
+const ShaderPermutation* g_ShaderPermutationByFeatures[MATERIAL_NUM_PERMUTATIONS];
+
+int main(int argc, char* argv[])
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+      g_SimulationStepsPerSecond = (float)atof(argv[++i]);
+    else if (strcmp(argv[i], "--headless") == 0)
+      g_Headless = true;
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      g_HeadlessFrames = std::max(atoi(argv[++i]), 1);
+    else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+      g_BenchmarkOutputPath = argv[++i];
+    else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+      g_ProfilerTracePath = argv[++i];
+    else if (strcmp(argv[i], "--targets") == 0 && i + 1 < argc)
+      g_NumTargets = std::max(atoi(argv[++i]), 1);
+    else if (strcmp(argv[i], "--bench-collisions") == 0 && i + 1 < argc)
+      g_CollisionBenchmarkObjects = std::max(atoi(argv[++i]), 1);
+    else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc)
+      g_TextureBudgetMegabytes = std::max(atoi(argv[++i]), 1);
+    else
+      fprintf(stderr, "WARNING: Ignoring unknown argument \"%s\".\n", argv[i]);
+  }
+
+  // O microbenchmark de colisões não precisa de janela nem de OpenGL.
+  if (g_CollisionBenchmarkObjects > 0)
+    return Benchmark_Collisions((size_t)g_CollisionBenchmarkObjects, 20) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  // Medidas de desempenho devem ser reprodutíveis: usamos sempre a mesma
+  // semente, de forma que os alvos seguem os mesmos caminhos.
+  srand(g_Headless ? 1 : time(NULL));
   // Inicializamos a biblioteca GLFW, utilizada para criar uma janela do
   // sistema operacional, onde poderemos renderizar com OpenGL.
   int success = glfwInit();
@@ -292,6 +487,10 @@ int main()
   // funções modernas de OpenGL.
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+  // No modo "--headless" a janela (e seu framebuffer) existe, mas nunca é mostrada.
+  if (g_Headless)
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
   // Criamos uma janela do sistema operacional, com 800 colunas e 800 linhas
   // de pixels, e com título "INF01047 ...".
   GLFWwindow* window;
@@ -322,6 +521,10 @@ int main()
   // Indicamos que as chamadas OpenGL deverão renderizar nesta janela
   glfwMakeContextCurrent(window);
 
+  // Medimos o custo de cada quadro, e não o tempo de espera pelo monitor.
+  if (g_Headless)
+    glfwSwapInterval(0);
+
   // Capturamos o cursor do mouse
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
@@ -337,19 +540,34 @@ int main()
 
   printf("GPU: %s, %s, OpenGL %s, GLSL %s\n", vendor, renderer, glversion, glslversion);
 
+  ShaderCache_Init((GLADloadproc) glfwGetProcAddress);
+
+  g_UseCompressedTextures = HasOpenGLExtension("GL_EXT_texture_compression_s3tc")
+                         && (HasOpenGLExtension("GL_EXT_texture_sRGB") || HasOpenGLExtension("GL_EXT_texture_compression_s3tc_srgb"));
+  if (g_UseCompressedTextures)
+    TextureStreaming_Init((size_t)g_TextureBudgetMegabytes*1024*1024, TEXTURE_UPLOAD_BYTES_PER_FRAME);
+  else
+    fprintf(stderr, "WARNING: S3TC sRGB textures not supported, using uncompressed textures.\n");
+
   // Carregamos os shaders de vértices e de fragmentos que serão utilizados
   // para renderização. Veja slides 180-200 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
   //
+  // Os programas de GPU são compilados pelo driver enquanto os arquivos são
+  // carregados abaixo; só esperamos por eles depois da tela de carregamento.
   LoadShadersFromFiles();
 
-  glUseProgram(g_GpuProgramID);
-  glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage0"), 0);
-  glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage1"), 1);
-  glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage2"), 2);
-  glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage3"), 3);
-  glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage4"), 4);
-  glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage5"), 5);
-  glUseProgram(0);
+  // Inicializamos o código para renderização de texto, utilizado também pela
+  // tela de carregamento abaixo.
+  TextRendering_Init();
+
+  // Texturas e modelos são carregados por threads de trabalho (veja
+  // assetloader.h), enquanto a thread principal mantém a janela respondendo
+  // e envia para a GPU os recursos que ficam prontos. A configuração abaixo
+  // do stb_image é global, então a definimos antes de iniciar as threads.
+  stbi_set_flip_vertically_on_load(true);
+  double load_start_time = glfwGetTime();
+  AssetLoader_Init();
+
   LoadTextureImage("../../data/tc-earth_daymap_surface.jpg");      // TextureImage0
   LoadTextureImage("../../data/tc-earth_nightmap_citylights.gif"); // TextureImage1
   LoadTextureImage("../../data/red_brick_pavers_diff_4k.jpg");          // TextureImage2
@@ -357,12 +575,13 @@ int main()
   LoadTextureImage("../../data/target.jpg");
   LoadTextureImage("../../data/patterned_cobblestone_diff_4k.jpg"); // TextureImage5
 
-  // Construímos a representação de um triângulo (cubo original)
-  GLuint vertex_array_object_id = BuildTriangles();
-  GLuint line_vao_id = BuildLine();
-  GLuint plane_vao_id = BuildPlane();
+  // Construímos a representação de um triângulo (cubo original), da linha
+  // de tiro e do chão. Os VAOs ficam guardados nos objetos de g_VirtualScene.
+  BuildTriangles();
+  BuildLine();
+  BuildPlane();
 
-  // Carregamos modelos OBJ da pasta data/
+  // Carregamos modelos OBJ da pasta data/ (também de forma assíncrona)
   // ObjModel spheremodel("../../data/sphere.obj");
   // ComputeNormals(&spheremodel);
   // BuildTrianglesAndAddToVirtualScene(&spheremodel);
@@ -371,23 +590,68 @@ int main()
   // ComputeNormals(&bunnymodel);
   // BuildTrianglesAndAddToVirtualScene(&bunnymodel);
 
-  ObjModel uspmodel("../../data/USP.obj");
-  ComputeNormals(&uspmodel);
-  BuildTrianglesAndAddToVirtualScene(&uspmodel);
+  LoadObjModelToVirtualScene("../../data/USP.obj");
+  LoadObjModelToVirtualScene("../../data/target.obj");
 
-  ObjModel targetmodel("../../data/target.obj");
-  ComputeNormals(&targetmodel);
-  BuildTrianglesAndAddToVirtualScene(&targetmodel);
+  // Tela de carregamento: enquanto as threads de trabalho leem os arquivos,
+  // processamos eventos da janela e enviamos para a GPU os recursos prontos,
+  // gastando no máximo um quadro (~16ms) com isso a cada iteração.
+  while (!AssetLoader_Idle())
+  {
+    glfwPollEvents();
+    if (glfwWindowShouldClose(window))
+    {
+      AssetLoader_Shutdown();
+      glfwTerminate();
+      return 0;
+    }
 
-  GenerateNewBezierPath(true);
+    std::string error;
+    if (!AssetLoader_ProcessCompleted(1.0/60.0, &error))
+    {
+      fprintf(stderr, "ERROR: Cannot load %s\n", error.c_str());
+      AssetLoader_Shutdown();
+      glfwTerminate();
+      std::exit(EXIT_FAILURE);
+    }
 
-  // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
-  // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
-  // (GPU)! Veja arquivo "shader_vertex.glsl".
-  GLint g_model_uniform           = glGetUniformLocation(g_GpuProgramID, "model"); // Variável da matriz "model"
-  GLint g_view_uniform            = glGetUniformLocation(g_GpuProgramID, "view"); // Variável da matriz "view" em shader_vertex.glsl
-  GLint g_projection_uniform      = glGetUniformLocation(g_GpuProgramID, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
-  GLint render_as_black_uniform = glGetUniformLocation(g_GpuProgramID, "render_as_black"); // Variável booleana em shader_vertex.glsl
+    // Programas de GPU que o driver já terminou de compilar são
+    // preparados agora, sem esperar pelos demais.
+    FinishShadersFromFiles(false);
+
+    TextRendering_ShowLoadingProgress(window);
+    TextRendering_Flush();
+    glfwSwapBuffers(window);
+  }
+  AssetLoader_Shutdown();
+
+  FinishShadersFromFiles(true);
+
+  double load_seconds = glfwGetTime() - load_start_time;
+
+  // Resolvemos, uma única vez, os handles dos objetos desenhados a cada quadro.
+  g_CubeFacesObject = FindSceneObject("cube_faces");
+  g_CubeEdgesObject = FindSceneObject("cube_edges");
+  g_AxesObject      = FindSceneObject("axes");
+  g_LineObject      = FindSceneObject("line");
+  g_PlaneObject     = FindSceneObject("plane");
+  g_TargetObject    = FindSceneObject("10480_archery_target");
+  g_UspObjects[0]   = FindSceneObject("Cube.003");
+  g_UspObjects[1]   = FindSceneObject("Cube.002");
+  g_UspObjects[2]   = FindSceneObject("Cube.001");
+  g_UspObjects[3]   = FindSceneObject("Cube");
+
+  Broadphase_Init(&g_TargetGrid, -50.0f, 0.0f, 50.0f, 100.0f, TARGET_GRID_CELL_SIZE);
+
+  g_Targets.resize(g_NumTargets);
+  for (size_t i = 0; i < g_Targets.size(); ++i)
+  {
+    Target& target = g_Targets[i];
+    target.path_speed = TARGET_PATH_SPEED;
+    target.angle = 0.0f;
+    TeleportTarget(&target);
+    Broadphase_Update(&g_TargetGrid, (uint32_t)i, TargetBounds(target));
+  }
 
   // Habilitamos o Z-buffer. Veja slides 104-116 do documento Aula_09_Projecoes.pdf.
   glEnable(GL_DEPTH_TEST);
@@ -397,49 +661,66 @@ int main()
   glCullFace(GL_BACK);
   glFrontFace(GL_CCW);
 
-  Plane paredes[4];
-  paredes[0] = {glm::vec3(0.0f, 0.0f, 1.0f), 0.0f};
-  paredes[1] = {glm::vec3(0.0f, 0.0f, -1.0f), -100.0f};
-  paredes[2] = {glm::vec3(1.0f, 0.0f, 0.0f), 50.0f};
-  paredes[3] = {glm::vec3(-1.0f, 0.0f, 0.0f), -50.0f};
+  FixedTimestep timestep;
+  FixedTimestep_Init(&timestep, g_SimulationStepsPerSecond, MAX_SIMULATION_STEPS_PER_FRAME);
+  ResetInterpolation();
 
-  glm::vec4 camera_position_c  = glm::vec4(0.0f, 1.7f, 5.0f, 1.0f);
+  int frame = 0;
+  if (g_Headless)
+    Benchmark_Begin(g_HeadlessFrames);
 
-  Sphere cameraSphere;
-
-  float deltaTime = 0.0f;
-  float lastFrame = 0.0f;
+  Profiler_Init();
 
   // Ficamos em um loop infinito, renderizando, até que o usuário feche a janela
   while (!glfwWindowShouldClose(window))
   {
-    float currentFrame = (float)glfwGetTime();
-    deltaTime = currentFrame - lastFrame;
-    lastFrame = currentFrame;
-
-    g_TargetAngle += 0.5f * deltaTime;
-
-    g_BezierT += g_BezierSpeed * deltaTime;
-
-    if (g_BezierT >= 1.0f)
+    double frame_start_time = glfwGetTime();
+    Profiler_BeginFrame();
+
+    // Executamos quantos passos da simulação couberem no tempo real
+    // decorrido desde o último quadro. Cada passo guarda o estado anterior
+    // para a interpolação abaixo. No modo "--headless" o tempo real não
+    // importa: cada quadro é exatamente um passo, para que toda execução
+    // simule a mesma sequência de estados.
+    int num_steps;
+    if (g_Headless)
     {
-        GenerateNewBezierPath(false);
+      ApplyBenchmarkInput(frame);
+      num_steps = 1;
     }
-
-    glm::vec3 p0 = g_ControlPoints[0];
-    glm::vec3 p1 = g_ControlPoints[1];
-    glm::vec3 p2 = g_ControlPoints[2];
-    glm::vec3 p3 = g_ControlPoints[3];
-
-    g_TargetPosition = CalculateBezierPoint(g_BezierT, p0, p1, p2, p3);
-
-    if (g_ShotHitTimer > 0.0f) {
-        g_ShotHitTimer -= deltaTime;
-    } else {
-        g_ShotHit = false;
+    else
+    {
+      num_steps = FixedTimestep_Advance(&timestep, glfwGetTime());
+    }
+    Profiler_Begin(PROFILE_SIMULATION);
+    for (int step = 0; step < num_steps; ++step)
+    {
+      for (size_t i = 0; i < g_Targets.size(); ++i)
+      {
+        g_Targets[i].previous_position = g_Targets[i].position;
+        g_Targets[i].previous_angle = g_Targets[i].angle;
+      }
+      g_PreviousFreeCameraPosition = g_FreeCameraPosition;
+
+      SimulationStep((float)timestep.step);
+    }
+    Profiler_End(PROFILE_SIMULATION);
+
+    // O estado desenhado fica entre os dois últimos passos da simulação,
+    // de forma que o movimento é suave mesmo com taxas de quadros que não
+    // são múltiplas da taxa da simulação. No modo "--headless" um passo
+    // inteiro acabou de ser executado, e o estado desenhado é o último.
+    float alpha = g_Headless ? 1.0f : FixedTimestep_Alpha(timestep);
+    for (size_t i = 0; i < g_Targets.size(); ++i)
+    {
+      Target& target = g_Targets[i];
+      target.render_position = glm::mix(target.previous_position, target.position, alpha);
+      target.render_angle = glm::mix(target.previous_angle, target.angle, alpha);
     }
+    glm::vec4 camera_position_c = glm::mix(g_PreviousFreeCameraPosition, g_FreeCameraPosition, alpha);
 
     // Aqui executamos as operações de renderização
+    Profiler_Begin(PROFILE_SCENE_DRAW);
 
     // Definimos a cor do "fundo" do framebuffer como branco.  Tal cor é
     // definida como coeficientes RGBA: Red, Green, Blue, Alpha; isto é:
@@ -453,38 +734,20 @@ int main()
     // e também resetamos todos os pixels do Z-buffer (depth buffer).
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo
-    // os shaders de vértice e fragmentos).
-    glUseProgram(g_GpuProgramID);
+    // As funções Draw*() abaixo somente acrescentam itens na fila de
+    // renderização; os comandos OpenGL são enviados em RenderQueue_Flush(),
+    // depois que todos os objetos do quadro foram definidos.
+    RenderQueue_Begin();
+    g_CullingStats.drawn = 0;
+    g_CullingStats.culled = 0;
 
     glm::mat4 model = Matrix_Identity(); // Transformação inicial = identidade.
 
-    // Desenha o chão
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, 7);
-    glBindVertexArray(plane_vao_id);
-    glDrawElements(
-        g_VirtualScene["plane"].rendering_mode,
-        g_VirtualScene["plane"].num_indices,
-        GL_UNSIGNED_INT,
-        (void*)0
-    );
-    glBindVertexArray(0);
-
-    // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
-    // vértices apontados pelo VAO criado pela função BuildTriangles(). Veja
-    // comentários detalhados dentro da definição de BuildTriangles().
-    glBindVertexArray(vertex_array_object_id);
-
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
-
     glm::mat4 view;
     if (g_UseLookAtCamera)
     {
         // Câmera Look-at
-        glm::vec3 lookat_target = g_TargetPosition + glm::vec3(0.0f, 2.0f, 0.0f);
+        glm::vec3 lookat_target = g_Targets[0].render_position + glm::vec3(0.0f, 2.0f, 0.0f);
 
         float y = g_CameraDistance * sin(g_CameraPhi);
         float z = g_CameraDistance * cos(g_CameraPhi) * cos(g_CameraTheta);
@@ -509,96 +772,13 @@ int main()
         g_CameraPosition = camera_position_c;
         g_CameraViewVector = glm::normalize(camera_lookat_l - camera_position_c); // Vetor "view", sentido para onde a câmera está virada
         glm::vec4 camera_up_vector   = glm::vec4(0.0f,1.0f,0.0f,0.0f); // Vetor "up" fixado para apontar para o "céu" (eito Y global)
-        glm::vec4 u_vector = crossproduct(camera_up_vector, -g_CameraViewVector);
-        u_vector.y = 0;
-
-        glm::vec4 w_vector = g_CameraViewVector;
-        w_vector.y = 0;
-
-        float camera_speed = 3.0f;
-        glm::vec4 old_camera_position = camera_position_c;
-        if(tecla_W_pressionada)
-          camera_position_c += w_vector * camera_speed * deltaTime;
-        if(tecla_A_pressionada)
-          camera_position_c -= u_vector * camera_speed * deltaTime;
-        if(tecla_S_pressionada)
-          camera_position_c -= w_vector * camera_speed * deltaTime;
-        if(tecla_D_pressionada)
-          camera_position_c += u_vector * camera_speed * deltaTime;
-
-        cameraSphere.center = glm::vec3(camera_position_c.x, camera_position_c.y, camera_position_c.z);
-
-        for (int i = 0; i < 4; ++i) {
-            if (checkSpherePlaneCollision(cameraSphere, paredes[i])) {
-                camera_position_c = old_camera_position;
-                break;
-            }
-        }
-
-                cameraSphere.center = glm::vec3(camera_position_c.x, camera_position_c.y, camera_position_c.z);
-
-        float base_radius = 0.5f;
-        float bonus_radius = 0.0f;
-        if (g_TargetPhase > 3) {
-            bonus_radius = (g_TargetPhase - 3) * 0.5f;
-        }
-        cameraSphere.radius = base_radius + bonus_radius;
-
-        
-
-                // Define a esfera de colisão para o alvo
-
-                SceneObject target_model = g_VirtualScene["10480_archery_target"];
-
-                glm::vec3 bbox_size = target_model.bbox_max - target_model.bbox_min;
-
-                float target_radius = (glm::length(bbox_size) / 2.0f) * (0.015f * g_TargetScale);
-
-        
-
-                Sphere targetSphere;
-
-                targetSphere.center = g_TargetPosition;
-
-                        // Garante um raio de colisão mínimo para o alvo, aumentado para facilitar a colisão
-
-                        targetSphere.radius = glm::max(target_radius, 5.0f);
-
-        
-
-                // Verifica a colisão entre a esfera da câmera e a esfera do alvo
-
-                                if (checkSphereSphereCollision(cameraSphere, targetSphere))
-
-                                {
-
-                                    if (g_TargetPhase == MAX_TARGET_PHASES) {
-
-                                        // O jogo termina ou o alvo para de encolher
-
-                                    } else {
-
-                                        g_TargetPhase++;
-
-                                        if (g_TargetPhase == 9) {
-
-                                            g_TargetPhase = 1;
-
-                                        }
-
-                                        // Recalcula a escala do alvo (reduzindo pela metade)
-
-                                        g_TargetScale = INITIAL_TARGET_SCALE / pow(2.0f, g_TargetPhase - 1);
-
-                                        // Teletransporta o alvo para uma nova posição
-
-                                        GenerateNewBezierPath(true);
-
-                                    }
-
-                                }
-
         view = Matrix_Camera_View(camera_position_c, g_CameraViewVector, camera_up_vector);
+
+        // Mira: qual alvo está sob o centro da tela neste quadro.
+        Ray aim_ray;
+        aim_ray.origin = glm::vec3(g_CameraPosition);
+        aim_ray.direction = glm::vec3(g_CameraViewVector);
+        g_AimOnTarget = RaycastTargets(aim_ray, &g_AimTarget, &g_AimDistance);
     }
 
     // Agora computamos a matriz de Projeção.
@@ -615,6 +795,8 @@ int main()
       // Para definição do field of view (FOV), veja slides 205-215 do documento Aula_09_Projecoes.pdf.
       float field_of_view = 3.141592 / 3.0f;
       projection = Matrix_Perspective(field_of_view, g_ScreenRatio, nearplane, farplane);
+      g_PixelFootprintPerDistance = 2.0f * tanf(field_of_view / 2.0f) / g_ScreenHeight;
+      g_PixelFootprintConstant = 0.0f;
     }
     else
     {
@@ -628,24 +810,41 @@ int main()
       float r = t*g_ScreenRatio;
       float l = -r;
       projection = Matrix_Orthographic(l, r, b, t, nearplane, farplane);
+      g_PixelFootprintPerDistance = 0.0f;
+      g_PixelFootprintConstant = (t - b) / g_ScreenHeight;
     }
 
-    // Enviamos as matrizes "view" e "projection" para a placa de vídeo
-    // (GPU). Veja o arquivo "shader_vertex.glsl", onde estas são
+    // Enviamos a matriz "projection * view", a posição da câmera e a
+    // iluminação para a placa de vídeo (GPU), uma única vez para todos os
+    // programas. Veja o arquivo "shader_vertex.glsl", onde estas são
     // efetivamente aplicadas em todos os pontos.
-    glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-    glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+    FrameUniforms frame_uniforms;
+    frame_uniforms.view_projection   = projection * view;
+    frame_uniforms.camera_position   = Matrix_Inverse_View(view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    frame_uniforms.light_intensity   = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+    frame_uniforms.ambient_intensity = glm::vec4(0.2f, 0.2f, 0.2f, 0.0f);
+    RenderQueue_SetFrameUniforms(frame_uniforms);
+
+    // Planos do frustum em coordenadas globais, para o descarte dos objetos
+    // fora do campo de visão. Precisa ser feito antes de qualquer Draw*().
+    g_ViewFrustum = extractFrustum(frame_uniforms.view_projection);
+
+    // Desenha o chão
+    DrawVirtualObject(g_PlaneObject, model, 7);
 
     const float angulo_90_rad = 1.57079632679f;
 
+    // As quatro paredes da arena são cópias do mesmo cubo: guardamos a matriz
+    // de cada uma e desenhamos todas com um único desenho instanciado.
+    InstanceData walls[4];
+
     // PAREDE EXTERNA PRINCIPAL
     model = Matrix_Identity();
-    glUniform1i(g_object_id_uniform, 50);
     model = model * Matrix_Translate(g_TorsoPositionX, g_TorsoPositionY -0.5f, 0.0f);
     PushMatrix(model);
     model = model * Matrix_Scale(100.0f, -10.0f, 0.5f);
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    DrawCube(render_as_black_uniform);
+    walls[0].model = model;
+    walls[0].object_id = 50;
     PopMatrix(model);
 
     // PAREDE EXTERNA COPIADA
@@ -653,8 +852,8 @@ int main()
     model = model * Matrix_Translate(50.0f, 0.0f, 50.0f);
     model = model * Matrix_Rotate(angulo_90_rad, glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
     model = model * Matrix_Scale(100.0f, -10.0f, 0.5f);
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    DrawCube(render_as_black_uniform);
+    walls[1].model = model;
+    walls[1].object_id = 50;
     PopMatrix(model);
 
     // PAREDE EXTERNA COPIADA 2
@@ -662,42 +861,41 @@ int main()
     model = model * Matrix_Translate(-50.0f, 0.0f, 50.0f);
     model = model * Matrix_Rotate(angulo_90_rad, glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
     model = model * Matrix_Scale(100.0f, -10.0f, 0.5f);
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    DrawCube(render_as_black_uniform);
+    walls[2].model = model;
+    walls[2].object_id = 50;
     PopMatrix(model);
 
     PushMatrix(model);
     model = model * Matrix_Translate(0.0f, 0.0f, 100.0f);
     // model = model * Matrix_Rotate(angulo_90_rad, glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
     model = model * Matrix_Scale(100.0f, -10.0f, 0.5f);
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    DrawCube(render_as_black_uniform);
+    walls[3].model = model;
+    walls[3].object_id = 50;
     PopMatrix(model);
 
+    DrawCubeInstanced(walls, 4);
+
     // PushMatrix(model);
     // model = model * Matrix_Translate(-2.0f, 0.0f, 0.0f);
-    // glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    // DrawCube(render_as_black_uniform);
+    // DrawCube(model, 50);
     //
     // PushMatrix(model);
     // model = model * Matrix_Translate(-2.0f, 0.0f, 0.0f);
-    // glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    // DrawCube(render_as_black_uniform);
+    // DrawCube(model, 50);
     // PopMatrix(model);
 
 
     // Neste ponto a matriz model recuperada é a matriz inicial (translação do torso)
 
-    // Desenha o alvo
+    // Desenha os alvos, todos com um único desenho instanciado
     if (g_TargetShow) {
-        model = Matrix_Identity();
-        model = model * Matrix_Translate(g_TargetPosition.x, g_TargetPosition.y, g_TargetPosition.z);
-        model = model * Matrix_Rotate_Y(g_TargetAngle);
-        model = model * Matrix_Rotate_X(-1.57079632679f); // Rotaciona para ficar em pé
-        model = model * Matrix_Scale(0.015f * g_TargetScale, 0.015f * g_TargetScale, 0.015f * g_TargetScale);
-        glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, 6); // ID do alvo
-        DrawVirtualObject("10480_archery_target");
+        g_TargetInstances.resize(g_Targets.size());
+        for (size_t i = 0; i < g_Targets.size(); ++i)
+        {
+            g_TargetInstances[i].model = TargetModelMatrix(g_Targets[i]);
+            g_TargetInstances[i].object_id = 6; // ID do alvo
+        }
+        DrawVirtualObjectInstanced(g_TargetObject, g_TargetInstances.data(), g_TargetInstances.size());
     }
 
     // Agora queremos desenhar os eixos XYZ de coordenadas GLOBAIS.
@@ -724,57 +922,27 @@ int main()
     model = model * Matrix_Translate(0.4f, -0.4f, -0.6f); // Offset local
     model = model * Matrix_Scale(0.075f, 0.075f, 0.075f);
 
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, USP);
-
-    glUniform1i(g_object_id_uniform, 10); 
-    DrawVirtualObject("Cube.003");
+    DrawVirtualObject(g_UspObjects[0], model, 10);
+    DrawVirtualObject(g_UspObjects[1], model, 11);
+    DrawVirtualObject(g_UspObjects[2], model, 12);
+    DrawVirtualObject(g_UspObjects[3], model, 13);
 
-    glUniform1i(g_object_id_uniform, 11);
-    DrawVirtualObject("Cube.002");
-
-    glUniform1i(g_object_id_uniform, 12);
-    DrawVirtualObject("Cube.001");
-
-    glUniform1i(g_object_id_uniform, 13);
-    DrawVirtualObject("Cube");
-
-    // Desenha a linha de tiro
+    // Desenha a linha de tiro, com a mesma cor da última parte da USP
     PushMatrix(model);
     model = model * Matrix_Translate(0.0f, 2.0f, -0.5f); 
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    glBindVertexArray(line_vao_id);
-    DrawLine(render_as_black_uniform);
-    glBindVertexArray(0);
+    DrawLine(model, 13);
     PopMatrix(model);
 
-    // Enviamos a nova matriz "model" para a placa de vídeo (GPU). Veja o
-    // arquivo "shader_vertex.glsl".
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-
-    // Pedimos para OpenGL desenhar linhas com largura de 10 pixels.
-    glLineWidth(10.0f);
-
-    // Informamos para a placa de vídeo (GPU) que a variável booleana
-    // "render_as_black" deve ser colocada como "false". Veja o arquivo
-    // "shader_vertex.glsl".
-    glUniform1i(render_as_black_uniform, false);
-
-    // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
-    // apontados pelo VAO como linhas. Veja a definição de
-    // g_VirtualScene["axes"] dentro da função BuildTriangles(), e veja
-    // a documentação da função glDrawElements() em
-    // http://docs.gl/gl3/glDrawElements.
-    glDrawElements(
-        g_VirtualScene["axes"].rendering_mode,
-        g_VirtualScene["axes"].num_indices,
-        GL_UNSIGNED_INT,
-        (void*)(g_VirtualScene["axes"].first_index * sizeof(GLuint))
-        );
+    // Enviamos para a GPU os níveis de mipmap pedidos pelos objetos acima,
+    // antes de desenhá-los.
+    if (g_UseCompressedTextures)
+      TextureStreaming_Update();
 
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+    // Enviamos para a GPU, ordenados por estado, todos os objetos do quadro.
+    RenderQueue_Flush();
+    Profiler_End(PROFILE_SCENE_DRAW);
+
+    Profiler_Begin(PROFILE_HUD_TEXT);
 
     // Imprimimos na tela os ângulos de Euler que controlam a rotação do
     // terceiro cubo.
@@ -787,13 +955,34 @@ int main()
     // por segundo (frames per second).
     TextRendering_ShowFramesPerSecond(window);
 
+    // Imprimimos na tela os contadores da fila de renderização.
+    TextRendering_ShowRenderQueueStats(window);
+
+    // Imprimimos na tela o tempo gasto em cada parte do quadro.
+    TextRendering_ShowProfiler(window);
+
+    // Desenhamos, de uma só vez, todo o texto impresso acima.
+    TextRendering_Flush();
+    Profiler_End(PROFILE_HUD_TEXT);
+
     // O framebuffer onde OpenGL executa as operações de renderização não
     // é o mesmo que está sendo mostrado para o usuário, caso contrário
     // seria possível ver artefatos conhecidos como "screen tearing". A
     // chamada abaixo faz a troca dos buffers, mostrando para o usuário
     // tudo que foi renderizado pelas funções acima.
     // Veja o link: https://en.wikipedia.org/w/index.php?title=Multiple_buffering&oldid=793452829#Double_buffering_in_computer_graphics
+    Profiler_Begin(PROFILE_SWAP);
     glfwSwapBuffers(window);
+    Profiler_End(PROFILE_SWAP);
+
+    Profiler_EndFrame();
+
+    if (g_Headless)
+    {
+      Benchmark_RecordFrame(glfwGetTime() - frame_start_time, RenderQueue_Stats());
+      if (++frame >= g_HeadlessFrames)
+        break;
+    }
 
     // Verificamos com o sistema operacional se houve alguma interação do
     // usuário (teclado, mouse, ...). Caso positivo, as funções de callback
@@ -802,6 +991,27 @@ int main()
     glfwPollEvents();
   }
 
+  if (g_Headless)
+  {
+    if (Benchmark_WriteJson(g_BenchmarkOutputPath, (const char*)renderer, load_seconds, g_SimulationStepsPerSecond))
+    {
+      fprintf(stderr, "Benchmark: %d frames written to \"%s\".\n", frame, g_BenchmarkOutputPath);
+    }
+    else
+    {
+      fprintf(stderr, "ERROR: Cannot write benchmark results to \"%s\".\n", g_BenchmarkOutputPath);
+      glfwTerminate();
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if (g_ProfilerTracePath != NULL && !Profiler_WriteChromeTrace(g_ProfilerTracePath))
+    fprintf(stderr, "WARNING: Cannot write profiler trace \"%s\".\n", g_ProfilerTracePath);
+  Profiler_Shutdown();
+
+  if (g_UseCompressedTextures)
+    TextureStreaming_Shutdown();
+
   // Finalizamos o uso dos recursos do sistema operacional
   glfwTerminate();
 
@@ -809,34 +1019,298 @@ int main()
   return 0;
 }
 
-void GenerateNewBezierPath(bool teleport)
+// Move o alvo imediatamente para um ponto sorteado da arena, de onde ele
+// começa um novo caminho.
+void TeleportTarget(Target* target)
+{
+    BezierPathBounds bounds;
+    bounds.min_x = -49.0f;
+    bounds.max_x = 49.0f;
+    bounds.min_z = 1.0f;
+    bounds.max_z = 99.0f;
+    bounds.y = -0.6f;
+    bounds.margin = 4.0f;
+
+    float scale_x = rand() / (float) RAND_MAX;
+    float scale_z = rand() / (float) RAND_MAX;
+    glm::vec3 start(bounds.min_x + scale_x * (bounds.max_x - bounds.min_x), bounds.y,
+                    bounds.min_z + scale_z * (bounds.max_z - bounds.min_z));
+    BezierPathStream_Init(&target->path, bounds, start);
+
+    target->position = start;
+    ResetTargetInterpolation(target);
+}
+
+// Matriz de modelagem do alvo, no estado interpolado desenhado no quadro atual.
+glm::mat4 TargetModelMatrix(const Target& target)
+{
+    glm::mat4 model = Matrix_Identity();
+    model = model * Matrix_Translate(target.render_position.x, target.render_position.y, target.render_position.z);
+    model = model * Matrix_Rotate_Y(target.render_angle);
+    model = model * Matrix_Rotate_X(-1.57079632679f); // Rotaciona para ficar em pé
+    model = model * Matrix_Scale(0.015f * g_TargetScale, 0.015f * g_TargetScale, 0.015f * g_TargetScale);
+    return model;
+}
+
+// Raio da esfera de colisão dos alvos com a câmera.
+float TargetCollisionRadius()
+{
+    const SceneObject& target_model = g_VirtualScene[g_TargetObject];
+    glm::vec3 bbox_size = target_model.bbox_max - target_model.bbox_min;
+    float target_radius = (glm::length(bbox_size) / 2.0f) * (0.015f * g_TargetScale);
+    // Garante um raio de colisão mínimo para o alvo, aumentado para facilitar a colisão
+    return glm::max(target_radius, 5.0f);
+}
+
+// AABB do alvo na grade g_TargetGrid. Cobre, em qualquer rotação, a esfera
+// de colisão e o modelo (cuja origem não é o centro da sua bounding box),
+// com uma folga para a diferença entre o estado simulado e o desenhado.
+AABB TargetBounds(const Target& target)
+{
+    const SceneObject& target_model = g_VirtualScene[g_TargetObject];
+    glm::vec3 farthest = glm::max(glm::abs(target_model.bbox_min), glm::abs(target_model.bbox_max));
+    float model_radius = glm::length(farthest) * (0.015f * g_TargetScale);
+
+    float radius = glm::max(model_radius, TargetCollisionRadius()) + 1.0f;
+
+    AABB box;
+    box.min = target.position - glm::vec3(radius);
+    box.max = target.position + glm::vec3(radius);
+    return box;
+}
+
+// Alvo mais próximo atingido por um raio em coordenadas globais, testado
+// contra os triângulos do modelo (ou contra sua bounding box, se o modelo
+// não tem BVH). Barato o bastante para ser chamada a cada quadro.
+bool RaycastTargets(const Ray& ray, uint32_t* hit_id, float* hit_distance)
 {
-    float min_x = -49.0f, max_x = 49.0f;
-    float min_z = 1.0f, max_z = 99.0f;
-    float fixed_y = -0.6f;
-    auto rand_float = [](float min, float max) {
-        float scale = rand() / (float) RAND_MAX;
-        return min + scale * ( max - min );
+    const SceneObject& target_model = g_VirtualScene[g_TargetObject];
+    AABB target_bbox;
+    target_bbox.min = target_model.bbox_min;
+    target_bbox.max = target_model.bbox_max;
+
+    // Teste exato de um alvo: levamos o raio para o espaço local do alvo e o
+    // testamos contra o modelo original. O parâmetro t do ponto atingido é o
+    // mesmo nos dois espaços, pois a transformação é afim. A bounding box
+    // descarta rapidamente os raios que passam longe do modelo.
+    auto hit_test = [&](uint32_t id, float* distance) {
+        glm::mat4 invModel = glm::inverse(TargetModelMatrix(g_Targets[id]));
+        Ray local_ray;
+        local_ray.origin = glm::vec3(invModel * glm::vec4(ray.origin, 1.0f));
+        local_ray.direction = glm::vec3(invModel * glm::vec4(ray.direction, 0.0f));
+        if (!checkRayAABBCollision(local_ray, target_bbox, distance))
+            return false;
+        if (!target_model.bvh)
+            return true;
+
+        BvhHit hit;
+        if (!MeshBvh_Raycast(*target_model.bvh, local_ray, std::numeric_limits<float>::max(), &hit))
+            return false;
+        *distance = hit.distance;
+        return true;
     };
 
-    glm::vec3 p0;
-    if (teleport || g_ControlPoints.empty())
+    // A grade só testa os alvos das células atravessadas pelo raio, da mais
+    // próxima para a mais distante, e retorna o alvo atingido mais próximo.
+    return Broadphase_Raycast(&g_TargetGrid, ray, std::numeric_limits<float>::max(), hit_test, hit_id, hit_distance);
+}
+
+// Avança a simulação em "dt" segundos: movimento do alvo ao longo da curva
+// de Bézier, movimento da câmera livre e colisões. Chamada somente com o
+// passo fixo da simulação (veja main()), nunca com o tempo de um quadro.
+void SimulationStep(float dt)
+{
+    // Os alvos andam com velocidade constante ao longo dos seus caminhos.
+    static std::vector<const BezierPath*> paths;
+    static std::vector<float> distances;
+    static std::vector<glm::vec3> positions;
+    paths.resize(g_Targets.size());
+    distances.resize(g_Targets.size());
+    positions.resize(g_Targets.size());
+
+    for (size_t i = 0; i < g_Targets.size(); ++i)
     {
-        p0 = { rand_float(min_x, max_x), fixed_y, rand_float(min_z, max_z) };
+        Target& target = g_Targets[i];
+
+        target.angle += 0.5f * dt;
+
+        BezierPathStream_Advance(&target.path, target.path_speed * dt);
+
+        paths[i] = &BezierPathStream_Current(target.path);
+        distances[i] = target.path.distance;
     }
-    else
+
+    BezierPath_PointsAtDistances(paths.data(), distances.data(), g_Targets.size(), positions.data());
+
+    for (size_t i = 0; i < g_Targets.size(); ++i)
     {
-        p0 = g_ControlPoints.back();
+        g_Targets[i].position = positions[i];
+
+        // Só altera as células da grade quando o alvo passa para outra célula.
+        Broadphase_Update(&g_TargetGrid, (uint32_t)i, TargetBounds(g_Targets[i]));
     }
 
-    g_ControlPoints.clear();
+    if (g_ShotHitTimer > 0.0f) {
+        g_ShotHitTimer -= dt;
+    } else {
+        g_ShotHit = false;
+    }
+
+    if (g_UseLookAtCamera)
+        return;
+
+    // Câmera Livre: a direção do movimento vem dos ângulos controlados pelo mouse
+    float y = sin(g_CameraPhi);
+    float z = cos(g_CameraPhi)*cos(g_CameraTheta);
+    float x = cos(g_CameraPhi)*sin(g_CameraTheta);
+
+    glm::vec4 view_vector = -glm::normalize(glm::vec4(x,y,z,0.0f));
+    glm::vec4 camera_up_vector = glm::vec4(0.0f,1.0f,0.0f,0.0f);
+    glm::vec4 u_vector = crossproduct(camera_up_vector, -view_vector);
+    u_vector.y = 0;
+
+    glm::vec4 w_vector = view_vector;
+    w_vector.y = 0;
+
+    float camera_speed = 3.0f;
+    glm::vec4 camera_displacement = glm::vec4(0.0f);
+    if(tecla_W_pressionada)
+      camera_displacement += w_vector * camera_speed * dt;
+    if(tecla_A_pressionada)
+      camera_displacement -= u_vector * camera_speed * dt;
+    if(tecla_S_pressionada)
+      camera_displacement -= w_vector * camera_speed * dt;
+    if(tecla_D_pressionada)
+      camera_displacement += u_vector * camera_speed * dt;
+
+    // Daqui até o final da função, somente colisões.
+    PROFILE_SCOPE(PROFILE_COLLISION);
+
+    Sphere cameraSphere;
+    float base_radius = 0.5f;
+    float bonus_radius = 0.0f;
+    if (g_TargetPhase > 3) {
+        bonus_radius = (g_TargetPhase - 3) * 0.5f;
+    }
+    cameraSphere.radius = base_radius + bonus_radius;
+    cameraSphere.center = glm::vec3(g_FreeCameraPosition.x, g_FreeCameraPosition.y, g_FreeCameraPosition.z);
+
+    // As colisões são contínuas: testamos todo o caminho percorrido no passo,
+    // e não só a posição final, de forma que nenhum passo (por maior que
+    // seja, veja "--tick-rate") atravessa uma parede ou um alvo. Nas paredes
+    // a câmera desliza, em vez de parar.
+    glm::vec3 camera_start = cameraSphere.center;
+    glm::vec3 camera_end = moveSphereWithSliding(cameraSphere, glm::vec3(camera_displacement), g_ArenaWalls, 4);
+    glm::vec3 camera_motion = camera_end - camera_start;
+    g_FreeCameraPosition = glm::vec4(camera_end, 1.0f);
+
+    // Buscamos na grade somente os alvos próximos do caminho da câmera
+    static std::vector<uint32_t> nearby_targets;
+    nearby_targets.clear();
+
+    AABB camera_box;
+    camera_box.min = glm::min(camera_start, camera_end) - glm::vec3(cameraSphere.radius);
+    camera_box.max = glm::max(camera_start, camera_end) + glm::vec3(cameraSphere.radius);
+    Broadphase_QueryAABB(&g_TargetGrid, camera_box, &nearby_targets);
+
+    float target_radius = TargetCollisionRadius();
+
+    // Primeiro descartamos, todos de uma vez, os alvos longe do caminho: uma
+    // esfera que contém todo o movimento da câmera no passo contra esferas
+    // que contêm todo o movimento de cada alvo.
+    Sphere cameraBounds;
+    cameraBounds.center = camera_start + 0.5f * camera_motion;
+    cameraBounds.radius = cameraSphere.radius + 0.5f * glm::length(camera_motion);
+
+    static SphereBatch target_spheres;
+    static std::vector<uint32_t> target_hits;
+    clearBatch(&target_spheres);
+    for (size_t i = 0; i < nearby_targets.size(); ++i)
+    {
+        const Target& target = g_Targets[nearby_targets[i]];
+        Sphere targetBounds;
+        targetBounds.center = glm::mix(target.previous_position, target.position, 0.5f);
+        targetBounds.radius = target_radius + 0.5f * glm::distance(target.previous_position, target.position);
+        addToBatch(&target_spheres, targetBounds);
+    }
+    target_hits.resize(COLLISION_MASK_WORDS(nearby_targets.size()));
+    if (checkSphereSphereCollisionBatch(cameraBounds, target_spheres, target_hits.data()) == 0)
+        return;
+
+    // Dos alvos que sobraram, o primeiro tocado pela câmera durante o passo.
+    size_t hit_index = nearby_targets.size();
+    float hit_time = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < nearby_targets.size(); ++i)
+    {
+        if (!(target_hits[i / 32] & (1u << (i % 32))))
+            continue;
 
-    g_ControlPoints.push_back(p0);
-    g_ControlPoints.push_back({ rand_float(min_x, max_x), fixed_y, rand_float(min_z, max_z) });
-    g_ControlPoints.push_back({ rand_float(min_x, max_x), fixed_y, rand_float(min_z, max_z) });
-    g_ControlPoints.push_back({ rand_float(min_x, max_x), fixed_y, rand_float(min_z, max_z) });
+        const Target& target = g_Targets[nearby_targets[i]];
+        Sphere targetSphere;
+        targetSphere.center = target.previous_position;
+        targetSphere.radius = target_radius;
 
-    g_BezierT = 0.0f;
+        float time;
+        if (sweepSphereSphere(cameraSphere, camera_motion, targetSphere, target.position - target.previous_position, &time)
+            && time < hit_time)
+        {
+            hit_index = i;
+            hit_time = time;
+        }
+    }
+
+    if (hit_index == nearby_targets.size())
+        return;
+
+    if (g_TargetPhase == MAX_TARGET_PHASES) {
+        // O jogo termina ou o alvo para de encolher
+    } else {
+        g_TargetPhase++;
+        if (g_TargetPhase == 9) {
+            g_TargetPhase = 1;
+        }
+        // Recalcula a escala dos alvos (reduzindo pela metade)
+        g_TargetScale = INITIAL_TARGET_SCALE / pow(2.0f, g_TargetPhase - 1);
+        // Teletransporta o alvo para uma nova posição
+        Target& target = g_Targets[nearby_targets[hit_index]];
+        TeleportTarget(&target);
+        Broadphase_Update(&g_TargetGrid, nearby_targets[hit_index], TargetBounds(target));
+    }
+}
+
+// Roteiro de entrada do modo "--headless", em função somente do número do
+// quadro: a câmera livre anda em círculos pela arena, alternando entre
+// andar para frente e andar para o lado, e a cada 600 quadros passa 150
+// quadros na câmera look-at, para que os dois caminhos sejam medidos.
+void ApplyBenchmarkInput(int frame)
+{
+    g_UseLookAtCamera = (frame % 600) >= 450;
+
+    g_CameraTheta = 0.01f * frame;
+    g_CameraPhi = 0.1f * sin(0.02f * frame);
+
+    bool strafe = (frame / 120) % 2 == 1;
+    tecla_W_pressionada = !strafe;
+    tecla_A_pressionada = strafe;
+    tecla_S_pressionada = false;
+    tecla_D_pressionada = false;
+}
+
+// Faz o estado anterior da simulação igual ao atual, para que um
+// teletransporte não seja desenhado como um movimento através da arena.
+void ResetTargetInterpolation(Target* target)
+{
+    target->previous_position = target->position;
+    target->previous_angle = target->angle;
+    target->render_position = target->position;
+    target->render_angle = target->angle;
+}
+
+void ResetInterpolation()
+{
+    for (size_t i = 0; i < g_Targets.size(); ++i)
+        ResetTargetInterpolation(&g_Targets[i]);
+    g_PreviousFreeCameraPosition = g_FreeCameraPosition;
 }
 
 // Função que pega a matriz M e guarda a mesma no topo da pilha
@@ -866,129 +1340,281 @@ void ComputeNormals(ObjModel* model)
     if ( !model->attrib.normals.empty() )
         return;
 
-    // Primeiro computamos as normais para todos os TRIÂNGULOS.
-    // Segundo, computamos as normais dos VÉRTICES através do método proposto
-    // por Gouraud, onde a normal de cada vértice vai ser a média das normais de
-    // todas as faces que compartilham este vértice e que pertencem ao mesmo "smoothing group".
+    // Computamos as normais dos VÉRTICES através do método proposto por
+    // Gouraud, onde a normal de cada vértice vai ser a média das normais de
+    // todas as faces que compartilham este vértice e que pertencem ao mesmo
+    // "smoothing group". Todos os smoothing groups de todos os objetos são
+    // processados de uma só vez por ComputeSmoothNormals() (veja normals.h),
+    // que recebe os triângulos de todos os shapes em vetores contíguos.
+    size_t num_triangles = 0;
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+        num_triangles += model->shapes[shape].mesh.num_face_vertices.size();
 
-    // Obtemos a lista dos smoothing groups que existem no objeto
-    std::set<unsigned int> sgroup_ids;
+    std::vector<int> corner_vertices(3*num_triangles);
+    std::vector<unsigned int> triangle_sgroups(num_triangles);
+
+    size_t first_triangle = 0;
     for (size_t shape = 0; shape < model->shapes.size(); ++shape)
     {
-        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+        const tinyobj::mesh_t& mesh = model->shapes[shape].mesh;
+        size_t num_shape_triangles = mesh.num_face_vertices.size();
 
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        for (size_t triangle = 0; triangle < num_shape_triangles; ++triangle)
         {
-            unsigned int sgroup = model->shapes[shape].mesh.smoothing_group_ids[triangle];
-            sgroup_ids.insert(sgroup);
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+                corner_vertices[3*(first_triangle + triangle) + vertex] = mesh.indices[3*triangle + vertex].vertex_index;
+
+            triangle_sgroups[first_triangle + triangle] = mesh.smoothing_group_ids[triangle];
         }
+
+        first_triangle += num_shape_triangles;
     }
 
-    size_t num_vertices = model->attrib.vertices.size() / 3;
-    model->attrib.normals.reserve( 3*num_vertices );
+    std::vector<int> corner_normals(3*num_triangles);
+    ComputeSmoothNormals(model->attrib.vertices.data(), model->attrib.vertices.size() / 3,
+                         corner_vertices.data(), triangle_sgroups.data(), num_triangles,
+                         &model->attrib.normals, corner_normals.data());
 
-    // Processamos um smoothing group por vez
-    for (const unsigned int & sgroup : sgroup_ids)
+    // Escrevemos os índices das normais para os vértices dos triângulos
+    first_triangle = 0;
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
     {
-        std::vector<int> num_triangles_per_vertex(num_vertices, 0);
-        std::vector<glm::vec4> vertex_normals(num_vertices, glm::vec4(0.0f,0.0f,0.0f,0.0f));
+        tinyobj::mesh_t& mesh = model->shapes[shape].mesh;
+        size_t num_shape_triangles = mesh.num_face_vertices.size();
 
-        // Acumulamos as normais dos vértices de todos triângulos deste smoothing group
-        for (size_t shape = 0; shape < model->shapes.size(); ++shape)
-        {
-            size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+        for (size_t corner = 0; corner < 3*num_shape_triangles; ++corner)
+            mesh.indices[corner].normal_index = corner_normals[3*first_triangle + corner];
 
-            for (size_t triangle = 0; triangle < num_triangles; ++triangle)
-            {
-                unsigned int sgroup_tri = model->shapes[shape].mesh.smoothing_group_ids[triangle];
+        first_triangle += num_shape_triangles;
+    }
+}
 
-                if (sgroup_tri != sgroup)
-                    continue;
+// Constrói triângulos para futura renderização a partir de um ObjModel.
+void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
+{
+    MeshGeometry geometry;
+    BuildMeshGeometry(model, &geometry);
+    AddMeshToVirtualScene(MeshGeometry_View(geometry));
+}
 
-                glm::vec4  vertices[3];
-                for (size_t vertex = 0; vertex < 3; ++vertex)
-                {
-                    tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                    const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
-                    const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
-                    const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                    vertices[vertex] = glm::vec4(vx,vy,vz,1.0);
-                }
+// Malha lida por uma thread de trabalho, esperando o envio para a GPU: ou o
+// cache mapeado em memória, ou a geometria recém processada.
+struct LoadedMesh
+{
+    bool         from_cache;
+    MeshCache    cache;
+    MeshGeometry geometry;
+    std::vector<std::shared_ptr<const MeshBvh>> bvhs; // Uma BVH para cada objeto da malha
+    std::vector<float> uv_densities; // Veja SceneObject::uv_density
+};
+
+// Lê o i-ésimo índice de um objeto da malha, de 16 ou 32 bits.
+static uint32_t ReadShapeIndex(const MeshShape& shape, const uint8_t* indices, uint32_t i)
+{
+    if (shape.index_size == sizeof(uint16_t))
+    {
+        uint16_t index16;
+        memcpy(&index16, indices + 2*i, sizeof(index16));
+        return index16;
+    }
 
-                const glm::vec4  a = vertices[0];
-                const glm::vec4  b = vertices[1];
-                const glm::vec4  c = vertices[2];
+    uint32_t index;
+    memcpy(&index, indices + 4*i, sizeof(index));
+    return index;
+}
 
-                const glm::vec4  n = crossproduct(b-a,c-a);
+// Constrói uma BVH sobre os triângulos de cada objeto da malha. Executada pela
+// thread de trabalho, junto com a leitura do arquivo.
+void BuildMeshBvhs(const MeshView& mesh, std::vector<std::shared_ptr<const MeshBvh>>* bvhs)
+{
+    bvhs->resize(mesh.num_shapes);
 
-                for (size_t vertex = 0; vertex < 3; ++vertex)
-                {
-                    tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                    num_triangles_per_vertex[idx.vertex_index] += 1;
-                    vertex_normals[idx.vertex_index] += n;
-                }
-            }
+    std::vector<glm::vec3> vertices;
+    for (uint32_t shape = 0; shape < mesh.num_shapes; ++shape)
+    {
+        const MeshShape& theshape = mesh.shapes[shape];
+        const uint8_t* indices = mesh.indices + (size_t)theshape.first_index * theshape.index_size;
+
+        vertices.resize(theshape.num_indices);
+        for (uint32_t i = 0; i < theshape.num_indices; ++i)
+        {
+            uint32_t index = ReadShapeIndex(theshape, indices, i);
+            const float* position = mesh.vertices[theshape.base_vertex + index].position;
+            vertices[i] = glm::vec3(position[0], position[1], position[2]);
         }
 
-        // Computamos a média das normais acumuladas
-        std::vector<size_t> normal_indices(num_vertices, 0);
+        std::shared_ptr<MeshBvh> bvh = std::make_shared<MeshBvh>();
+        MeshBvh_Build(bvh.get(), vertices.data(), theshape.num_indices / 3);
+        (*bvhs)[shape] = bvh;
+    }
+}
+
+// Densidade média das coordenadas de textura de cada objeto da malha: raiz
+// da razão entre a área total dos triângulos no espaço UV e no espaço do
+// modelo. Utilizada para escolher o nível de mipmap necessário na tela (veja
+// texturestreaming.h). Executada pela thread de trabalho.
+void ComputeMeshUvDensities(const MeshView& mesh, std::vector<float>* uv_densities)
+{
+    uv_densities->assign(mesh.num_shapes, 0.0f);
+
+    for (uint32_t shape = 0; shape < mesh.num_shapes; ++shape)
+    {
+        const MeshShape& theshape = mesh.shapes[shape];
+        const uint8_t* indices = mesh.indices + (size_t)theshape.first_index * theshape.index_size;
 
-        for (size_t vertex_index = 0; vertex_index < vertex_normals.size(); ++vertex_index)
+        double model_area = 0.0;
+        double uv_area = 0.0;
+        for (uint32_t i = 0; i + 2 < theshape.num_indices; i += 3)
         {
-            if (num_triangles_per_vertex[vertex_index] == 0)
-                continue;
+            glm::vec3 p[3];
+            glm::vec2 uv[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                const PackedVertex& vertex = mesh.vertices[theshape.base_vertex + ReadShapeIndex(theshape, indices, i + k)];
+                p[k] = glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]);
+                uv[k] = glm::vec2(UnpackHalfFloat(vertex.texcoord[0]), UnpackHalfFloat(vertex.texcoord[1]));
+            }
 
-            glm::vec4 n = vertex_normals[vertex_index] / (float)num_triangles_per_vertex[vertex_index];
-            n /= norm(n);
+            model_area += 0.5 * glm::length(glm::cross(p[1] - p[0], p[2] - p[0]));
+            glm::vec2 e1 = uv[1] - uv[0];
+            glm::vec2 e2 = uv[2] - uv[0];
+            uv_area += 0.5 * std::fabs(e1.x*e2.y - e1.y*e2.x);
+        }
 
-            model->attrib.normals.push_back( n.x );
-            model->attrib.normals.push_back( n.y );
-            model->attrib.normals.push_back( n.z );
+        if (model_area > 0.0 && uv_area > 0.0)
+            (*uv_densities)[shape] = (float)std::sqrt(uv_area / model_area);
+    }
+}
 
-            size_t normal_index = (model->attrib.normals.size() / 3) - 1;
-            normal_indices[vertex_index] = normal_index;
+// Associa as BVHs construídas por BuildMeshBvhs() e as densidades de
+// ComputeMeshUvDensities() aos objetos de g_VirtualScene adicionados por
+// AddMeshToVirtualScene().
+void AttachMeshData(const MeshView& mesh, const LoadedMesh& loaded)
+{
+    for (uint32_t shape = 0; shape < mesh.num_shapes; ++shape)
+    {
+        SceneObjectHandle handle = FindSceneObject(mesh.shapes[shape].name);
+        if (handle != INVALID_SCENE_OBJECT)
+        {
+            g_VirtualScene[handle].bvh = loaded.bvhs[shape];
+            g_VirtualScene[handle].uv_density = loaded.uv_densities[shape];
         }
+    }
+}
+
+// Carrega um arquivo ".obj" e adiciona seus objetos em g_VirtualScene. Na
+// primeira execução a geometria processada é gravada em um cache binário ao
+// lado do arquivo ".obj" (veja meshcache.h); nas execuções seguintes o cache é
+// mapeado em memória e enviado diretamente para a GPU, sem passar pelo
+// tinyobjloader nem por ComputeNormals().
+//
+// A leitura e o processamento acontecem em uma thread de trabalho; os objetos
+// só aparecem em g_VirtualScene depois que AssetLoader_ProcessCompleted() for
+// chamada pela thread principal (veja assetloader.h).
+void LoadObjModelToVirtualScene(const char* filename)
+{
+    std::string path(filename);
+    std::shared_ptr<LoadedMesh> mesh = std::make_shared<LoadedMesh>();
 
-        // Escrevemos os índices das normais para os vértices dos triângulos deste smoothing group
-        for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    AssetLoader_Submit(path,
+        [path, mesh]()
         {
-            size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+            mesh->from_cache = MeshCache_Open(&mesh->cache, path.c_str());
+            if (mesh->from_cache)
+            {
+                printf("Carregando objetos do cache de \"%s\"... OK.\n", path.c_str());
+                BuildMeshBvhs(mesh->cache.view, &mesh->bvhs);
+                ComputeMeshUvDensities(mesh->cache.view, &mesh->uv_densities);
+                return;
+            }
+
+            ObjModel model(path.c_str());
+            ComputeNormals(&model);
 
-            for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+            BuildMeshGeometry(&model, &mesh->geometry);
+            MeshCache_Write(path.c_str(), mesh->geometry);
+            BuildMeshBvhs(MeshGeometry_View(mesh->geometry), &mesh->bvhs);
+            ComputeMeshUvDensities(MeshGeometry_View(mesh->geometry), &mesh->uv_densities);
+        },
+        [mesh]()
+        {
+            if (mesh->from_cache)
+            {
+                AddMeshToVirtualScene(mesh->cache.view);
+                AttachMeshData(mesh->cache.view, *mesh);
+                MeshCache_Close(&mesh->cache);
+            }
+            else
             {
-                unsigned int sgroup_tri = model->shapes[shape].mesh.smoothing_group_ids[triangle];
+                AddMeshToVirtualScene(MeshGeometry_View(mesh->geometry));
+                AttachMeshData(MeshGeometry_View(mesh->geometry), *mesh);
+            }
+        });
+}
+
+// Chave que identifica um vértice único de um arquivo ".obj": a combinação dos
+// índices de posição, normal e coordenada de textura de um canto de triângulo.
+struct ObjVertexKey
+{
+    int vertex_index;
+    int normal_index;
+    int texcoord_index;
+
+    bool operator==(const ObjVertexKey& other) const
+    {
+        return vertex_index == other.vertex_index
+            && normal_index == other.normal_index
+            && texcoord_index == other.texcoord_index;
+    }
+};
 
-                if (sgroup_tri != sgroup)
-                    continue;
+struct ObjVertexKeyHash
+{
+    size_t operator()(const ObjVertexKey& key) const
+    {
+        size_t h = (size_t)(unsigned int)key.vertex_index * 73856093u;
+        h ^= (size_t)(unsigned int)key.normal_index * 19349663u;
+        h ^= (size_t)(unsigned int)key.texcoord_index * 83492791u;
+        return h;
+    }
+};
 
-                for (size_t vertex = 0; vertex < 3; ++vertex)
-                {
-                    tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                    model->shapes[shape].mesh.indices[3*triangle + vertex].normal_index =
-                        normal_indices[ idx.vertex_index ];
-                }
-            }
-        }
+// Acrescenta um índice de "index_size" bytes ao final do buffer de índices.
+static void AppendIndex(std::vector<uint8_t>& indices, uint32_t index, uint32_t index_size)
+{
+    size_t offset = indices.size();
+    indices.resize(offset + index_size);
 
+    if (index_size == sizeof(uint16_t))
+    {
+        uint16_t index16 = (uint16_t)index;
+        memcpy(&indices[offset], &index16, sizeof(index16));
+    }
+    else
+    {
+        memcpy(&indices[offset], &index, sizeof(index));
     }
 }
 
-// Constrói triângulos para futura renderização a partir de um ObjModel.
-void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
+// Monta, na memória da CPU, os vetores de atributos e de índices de todos os
+// objetos de um ObjModel. Os cantos de triângulos que referenciam a mesma
+// tripla (posição, normal, coordenada de textura) são unificados em um único
+// vértice, de forma que o buffer de índices realmente compartilhe vértices
+// entre triângulos vizinhos (e a GPU possa reaproveitar o resultado do Vertex
+// Shader através do "post-transform cache").
+void BuildMeshGeometry(ObjModel* model, MeshGeometry* geometry)
 {
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
+    std::vector<uint8_t>&      indices  = geometry->indices;
+    std::vector<PackedVertex>& vertices = geometry->vertices;
 
-    std::vector<GLuint> indices;
-    std::vector<float>  model_coefficients;
-    std::vector<float>  normal_coefficients;
-    std::vector<float>  texture_coefficients;
+    std::unordered_map<ObjVertexKey, uint32_t, ObjVertexKeyHash> unique_vertices;
+    std::vector<uint32_t> shape_indices;
 
     for (size_t shape = 0; shape < model->shapes.size(); ++shape)
     {
-        size_t first_index = indices.size();
-        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+        const tinyobj::mesh_t& mesh = model->shapes[shape].mesh;
+        size_t num_triangles = mesh.num_face_vertices.size();
+        uint32_t base_vertex = vertices.size();
 
         const float minval = std::numeric_limits<float>::min();
         const float maxval = std::numeric_limits<float>::max();
@@ -996,23 +1622,40 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
         glm::vec3 bbox_min = glm::vec3(maxval,maxval,maxval);
         glm::vec3 bbox_max = glm::vec3(minval,minval,minval);
 
+        // Os vértices são unificados dentro de cada objeto, e os índices são
+        // relativos ao primeiro vértice do objeto (base_vertex).
+        unique_vertices.clear();
+        unique_vertices.reserve(3*num_triangles);
+        shape_indices.clear();
+        shape_indices.reserve(3*num_triangles);
+
         for (size_t triangle = 0; triangle < num_triangles; ++triangle)
         {
-            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
+            assert(mesh.num_face_vertices[triangle] == 3);
 
             for (size_t vertex = 0; vertex < 3; ++vertex)
             {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
+                tinyobj::index_t idx = mesh.indices[3*triangle + vertex];
+
+                ObjVertexKey key = { idx.vertex_index, idx.normal_index, idx.texcoord_index };
+                uint32_t next_vertex = (uint32_t)unique_vertices.size();
+                std::pair<std::unordered_map<ObjVertexKey, uint32_t, ObjVertexKeyHash>::iterator, bool> found =
+                    unique_vertices.insert(std::make_pair(key, next_vertex));
 
-                indices.push_back(first_index + 3*triangle + vertex);
+                shape_indices.push_back(found.first->second);
+
+                // Vértice já visto: somente o índice é necessário.
+                if (!found.second)
+                    continue;
+
+                PackedVertex packed;
 
                 const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
                 const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
                 const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                model_coefficients.push_back( vx ); // X
-                model_coefficients.push_back( vy ); // Y
-                model_coefficients.push_back( vz ); // Z
-                model_coefficients.push_back( 1.0f ); // W
+                packed.position[0] = vx; // X
+                packed.position[1] = vy; // Y
+                packed.position[2] = vz; // Z
 
                 bbox_min.x = std::min(bbox_min.x, vx);
                 bbox_min.y = std::min(bbox_min.y, vy);
@@ -1021,120 +1664,224 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
                 bbox_max.y = std::max(bbox_max.y, vy);
                 bbox_max.z = std::max(bbox_max.z, vz);
 
+                // Cantos sem normal ou sem coordenada de textura recebem
+                // zeros nestes atributos.
+                float nx = 0.0f, ny = 0.0f, nz = 0.0f;
                 if ( idx.normal_index != -1 )
                 {
-                    const float nx = model->attrib.normals[3*idx.normal_index + 0];
-                    const float ny = model->attrib.normals[3*idx.normal_index + 1];
-                    const float nz = model->attrib.normals[3*idx.normal_index + 2];
-                    normal_coefficients.push_back( nx ); // X
-                    normal_coefficients.push_back( ny ); // Y
-                    normal_coefficients.push_back( nz ); // Z
-                    normal_coefficients.push_back( 0.0f ); // W
+                    nx = model->attrib.normals[3*idx.normal_index + 0];
+                    ny = model->attrib.normals[3*idx.normal_index + 1];
+                    nz = model->attrib.normals[3*idx.normal_index + 2];
                 }
+                packed.normal = PackNormal_Int2_10_10_10(nx, ny, nz);
 
+                float u = 0.0f, v = 0.0f;
                 if ( idx.texcoord_index != -1 )
                 {
-                    const float u = model->attrib.texcoords[2*idx.texcoord_index + 0];
-                    const float v = model->attrib.texcoords[2*idx.texcoord_index + 1];
-                    texture_coefficients.push_back( u );
-                    texture_coefficients.push_back( v );
+                    u = model->attrib.texcoords[2*idx.texcoord_index + 0];
+                    v = model->attrib.texcoords[2*idx.texcoord_index + 1];
                 }
+                packed.texcoord[0] = PackHalfFloat(u);
+                packed.texcoord[1] = PackHalfFloat(v);
+
+                vertices.push_back(packed);
             }
         }
 
-        size_t last_index = indices.size() - 1;
+        uint32_t num_vertices = (uint32_t)unique_vertices.size();
 
-        SceneObject theobject;
-        theobject.name           = model->shapes[shape].name;
-        theobject.first_index    = first_index; // Primeiro índice
-        theobject.num_indices    = last_index - first_index + 1; // Número de indices
-        theobject.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
-        theobject.vertex_array_object_id = vertex_array_object_id;
+        // Reordenamos os triângulos para o cache de vértices da GPU e para
+        // reduzir overdraw, e depois os vértices na ordem em que são
+        // utilizados. Veja meshopt.h.
+        VertexCacheStatistics stats_before = AnalyzeVertexCache(shape_indices.data(), shape_indices.size(), num_vertices);
+
+        // Um objeto sem triângulos não tem vértices: vertices[base_vertex]
+        // estaria além do fim do vetor.
+        if (!shape_indices.empty())
+        {
+            OptimizeVertexCache(shape_indices.data(), shape_indices.size(), num_vertices);
+            OptimizeOverdraw(shape_indices.data(), shape_indices.size(),
+                             vertices[base_vertex].position, sizeof(PackedVertex), num_vertices);
+
+            std::vector<uint32_t> remap;
+            uint32_t num_used = (uint32_t)OptimizeVertexFetchRemap(shape_indices.data(), shape_indices.size(),
+                                                                   num_vertices, &remap);
+
+            // Vértices não utilizados (remap ~0u) são descartados. Os vértices
+            // deste objeto são os últimos do vetor, que pode ser encurtado.
+            std::vector<PackedVertex> reordered(num_used);
+            for (uint32_t v = 0; v < num_vertices; ++v)
+            {
+                if (remap[v] != ~0u)
+                    reordered[remap[v]] = vertices[base_vertex + v];
+            }
+            std::copy(reordered.begin(), reordered.end(), vertices.begin() + base_vertex);
+            vertices.resize(base_vertex + num_used);
+            num_vertices = num_used;
+        }
 
-        theobject.bbox_min = bbox_min;
-        theobject.bbox_max = bbox_max;
+        VertexCacheStatistics stats_after = AnalyzeVertexCache(shape_indices.data(), shape_indices.size(), num_vertices);
 
-        g_VirtualScene[model->shapes[shape].name] = theobject;
-    }
+        // Índices de 16 bits sempre que o objeto couber neles.
+        uint32_t index_size = (num_vertices <= 65536) ? sizeof(uint16_t) : sizeof(uint32_t);
 
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(float), model_coefficients.data());
-    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
-    GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+        // O primeiro índice precisa estar alinhado ao tamanho do seu tipo.
+        while (indices.size() % index_size != 0)
+            indices.push_back(0);
 
-    if ( !normal_coefficients.empty() )
-    {
-        GLuint VBO_normal_coefficients_id;
-        glGenBuffers(1, &VBO_normal_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(float), normal_coefficients.data());
-        
-        location = 3; // <--- ALTERE AQUI (era 1)
-        
-        number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        uint32_t first_index = indices.size() / index_size;
+        for (size_t i = 0; i < shape_indices.size(); ++i)
+            AppendIndex(indices, shape_indices[i], index_size);
+
+        MeshShape theshape;
+        memset(&theshape, 0, sizeof(theshape));
+        strncpy(theshape.name, model->shapes[shape].name.c_str(), MESHCACHE_MAX_NAME - 1);
+        theshape.first_index  = first_index; // Primeiro índice
+        theshape.num_indices  = shape_indices.size(); // Número de indices
+        theshape.index_size   = index_size;
+        theshape.base_vertex  = base_vertex;
+        theshape.num_vertices = num_vertices;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            theshape.bbox_min[i] = bbox_min[i];
+            theshape.bbox_max[i] = bbox_max[i];
+        }
+
+        geometry->shapes.push_back(theshape);
+
+        printf("- Objeto '%s': %u vértices únicos para %u índices (%u bits), ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+               theshape.name, num_vertices, theshape.num_indices, 8*index_size,
+               stats_before.acmr, stats_after.acmr, stats_before.atvr, stats_after.atvr);
     }
+}
+
+// Envia para a GPU a geometria de uma malha e adiciona cada um de seus
+// objetos em g_VirtualScene. Os dados podem vir tanto de uma MeshGeometry
+// quanto de um cache mapeado em memória.
+void AddMeshToVirtualScene(const MeshView& mesh)
+{
+    GLuint vertex_array_object_id;
+    glGenVertexArrays(1, &vertex_array_object_id);
+    glBindVertexArray(vertex_array_object_id);
 
-    if ( !texture_coefficients.empty() )
+    for (uint32_t shape = 0; shape < mesh.num_shapes; ++shape)
     {
-        GLuint VBO_texture_coefficients_id;
-        glGenBuffers(1, &VBO_texture_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_texture_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, texture_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, texture_coefficients.size() * sizeof(float), texture_coefficients.data());
-        location = 2; // "(location = 2)" em "shader_vertex.glsl"
-        number_of_dimensions = 2; // vec2 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        const MeshShape& theshape = mesh.shapes[shape];
+
+        SceneObject theobject;
+        theobject.name           = theshape.name;
+        theobject.first_index    = theshape.first_index; // Primeiro índice
+        theobject.num_indices    = theshape.num_indices; // Número de indices
+        theobject.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
+        theobject.index_type     = (theshape.index_size == sizeof(uint16_t)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        theobject.base_vertex    = theshape.base_vertex;
+        theobject.vertex_array_object_id = vertex_array_object_id;
+
+        theobject.bbox_min = glm::vec3(theshape.bbox_min[0], theshape.bbox_min[1], theshape.bbox_min[2]);
+        theobject.bbox_max = glm::vec3(theshape.bbox_max[0], theshape.bbox_max[1], theshape.bbox_max[2]);
+
+        AddSceneObject(theobject);
     }
 
+    // Todos os atributos ficam intercalados em um único VBO, no formato
+    // descrito por VERTEX_FORMAT_PACKED.
+    GLuint VBO_vertices_id;
+    glGenBuffers(1, &VBO_vertices_id);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_vertices_id);
+    glBufferData(GL_ARRAY_BUFFER, mesh.num_vertices * sizeof(PackedVertex), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, mesh.num_vertices * sizeof(PackedVertex), mesh.vertices);
+    VertexFormat_Apply(VERTEX_FORMAT_PACKED);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
     GLuint indices_id;
     glGenBuffers(1, &indices_id);
 
     // "Ligamos" o buffer. Note que o tipo agora é GL_ELEMENT_ARRAY_BUFFER.
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices_size, NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, mesh.indices_size, mesh.indices);
 
     // "Desligamos" o VAO, evitando assim que operações posteriores venham a
     // alterar o mesmo. Isso evita bugs.
     glBindVertexArray(0);
 }
 
-// Função que carrega uma imagem para ser utilizada como textura
+// Imagem decodificada na memória da CPU, esperando o envio para a GPU. Se
+// "compressed" é verdadeiro, a imagem está em "texture" (comprimida, com
+// todos os níveis de mipmap) e "data" não é utilizado.
+struct TextureImage
+{
+    unsigned char*    data;
+    int               width;
+    int               height;
+    bool              compressed;
+    CompressedTexture texture;
+};
+
+// Função que carrega uma imagem para ser utilizada como textura. A imagem é
+// decodificada em uma thread de trabalho (veja assetloader.h) e enviada para
+// a GPU pela thread principal. A unidade de textura é reservada aqui, de
+// forma que a ordem das chamadas define qual imagem fica em TextureImage0,
+// TextureImage1, etc., independentemente da ordem em que terminam.
 void LoadTextureImage(const char* filename)
 {
-    printf("Carregando imagem \"%s\"... ", filename);
+    std::string path(filename);
+    GLuint textureunit = g_NumLoadedTextures;
+    g_NumLoadedTextures += 1;
 
-    // Primeiro fazemos a leitura da imagem do disco
-    stbi_set_flip_vertically_on_load(true);
-    int width;
-    int height;
-    int channels;
-    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
+    std::shared_ptr<TextureImage> image = std::make_shared<TextureImage>();
+    image->data = NULL;
+    image->compressed = g_UseCompressedTextures;
 
-    if ( data == NULL )
-    {
-        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
-    }
+    AssetLoader_Submit(path,
+        [path, image]()
+        {
+            if (image->compressed && TextureCache_Read(path.c_str(), &image->texture))
+            {
+                printf("Carregando imagem do cache de \"%s\"... OK (%ux%u).\n",
+                       path.c_str(), image->texture.width, image->texture.height);
+                return;
+            }
 
-    printf("OK (%dx%d).\n", width, height);
+            // Fazemos a leitura da imagem do disco
+            int channels;
+            image->data = stbi_load(path.c_str(), &image->width, &image->height, &channels, 3);
 
-    // Agora criamos objetos na GPU com OpenGL para armazenar a textura
-    GLuint texture_id;
+            if ( image->data == NULL )
+                throw std::runtime_error("cannot open image file");
+
+            printf("Carregando imagem \"%s\"... OK (%dx%d).\n", path.c_str(), image->width, image->height);
+
+            // Comprimimos a imagem e guardamos o resultado para a próxima
+            // execução; a imagem decodificada não é mais necessária.
+            if (image->compressed)
+            {
+                CompressTexture(image->data, image->width, image->height, &image->texture);
+                TextureCache_Write(path.c_str(), image->texture);
+                stbi_image_free(image->data);
+                image->data = NULL;
+            }
+        },
+        [image, textureunit]()
+        {
+            if (image->compressed)
+            {
+                UploadCompressedTextureImage(&image->texture, textureunit);
+                return;
+            }
+
+            UploadTextureImage(image->data, image->width, image->height, textureunit);
+            stbi_image_free(image->data);
+            image->data = NULL;
+        });
+}
+
+// Cria o sampler utilizado por todas as texturas e o liga na unidade de
+// textura "textureunit".
+static void BindTextureSampler(GLuint textureunit)
+{
     GLuint sampler_id;
-    glGenTextures(1, &texture_id);
     glGenSamplers(1, &sampler_id);
 
     // Veja slides 95-96 do documento Aula_20_Mapeamento_de_Texturas.pdf
@@ -1145,127 +1892,268 @@ void LoadTextureImage(const char* filename)
     glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    glBindSampler(textureunit, sampler_id);
+}
+
+// Cria uma textura na GPU a partir de uma imagem RGB (8 bits por canal) e a
+// liga na unidade de textura "textureunit".
+void UploadTextureImage(const unsigned char* data, int width, int height, GLuint textureunit)
+{
+    // Criamos objetos na GPU com OpenGL para armazenar a textura
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+
     // Agora enviamos a imagem lida do disco para a GPU
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
     glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
 
-    GLuint textureunit = g_NumLoadedTextures;
     glActiveTexture(GL_TEXTURE0 + textureunit);
     glBindTexture(GL_TEXTURE_2D, texture_id);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
     glGenerateMipmap(GL_TEXTURE_2D);
-    glBindSampler(textureunit, sampler_id);
+    BindTextureSampler(textureunit);
+}
+
+// Análoga a UploadTextureImage(), para uma textura BC1 lida do cache de
+// texturas. Somente os níveis de mipmap menores são enviados agora; os
+// demais são enviados pelo sistema de streaming quando algum objeto na tela
+// precisar deles (veja texturestreaming.h). Os dados de "texture" passam a
+// pertencer ao sistema de streaming.
+void UploadCompressedTextureImage(CompressedTexture* texture, GLuint textureunit)
+{
+    GLuint texture_id;
+    glActiveTexture(GL_TEXTURE0 + textureunit);
+    StreamedTextureHandle handle = TextureStreaming_Add(texture, &texture_id);
 
-    stbi_image_free(data);
+    if (g_StreamedTextures.size() <= textureunit)
+        g_StreamedTextures.resize(textureunit + 1, INVALID_STREAMED_TEXTURE);
+    g_StreamedTextures[textureunit] = handle;
 
-    g_NumLoadedTextures += 1;
+    BindTextureSampler(textureunit);
+}
+
+// Procura "name" na lista de extensões suportadas pelo driver OpenGL.
+bool HasOpenGLExtension(const char* name)
+{
+    GLint num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (GLint i = 0; i < num_extensions; ++i)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension != NULL && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Adiciona um objeto em g_VirtualScene e retorna o seu handle. Se já existe
+// um objeto com o mesmo nome, ele é substituído e mantém o seu handle.
+SceneObjectHandle AddSceneObject(const SceneObject& object)
+{
+    std::unordered_map<std::string, SceneObjectHandle>::iterator it = g_VirtualSceneHandles.find(object.name);
+    if (it != g_VirtualSceneHandles.end())
+    {
+        g_VirtualScene[it->second] = object;
+        return it->second;
+    }
+
+    SceneObjectHandle handle = (SceneObjectHandle)g_VirtualScene.size();
+    g_VirtualScene.push_back(object);
+    g_VirtualSceneHandles[object.name] = handle;
+    return handle;
+}
+
+// Busca o handle de um objeto pelo nome. Deve ser utilizada somente durante
+// a inicialização; um objeto inexistente é um erro fatal.
+SceneObjectHandle FindSceneObject(const char* name)
+{
+    std::unordered_map<std::string, SceneObjectHandle>::const_iterator it = g_VirtualSceneHandles.find(name);
+    if (it == g_VirtualSceneHandles.end())
+    {
+        fprintf(stderr, "ERROR: Scene object \"%s\" not found.\n", name);
+        std::exit(EXIT_FAILURE);
+    }
+    return it->second;
+}
+
+// Preenche um DrawItem com a geometria de um objeto de g_VirtualScene e o
+// programa de GPU da permutação do seu material.
+static DrawItem MakeDrawItem(const SceneObject& object, const Material* material,
+                             bool render_as_black, float line_width)
+{
+    // Veja a documentação da função glDrawElementsBaseVertex() em
+    // http://docs.gl/gl3/glDrawElementsBaseVertex.
+    size_t index_size = (object.index_type == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+
+    DrawItem item;
+    item.program                = &g_ShaderPermutationByFeatures[material->features]->program;
+    item.vertex_array_object_id = object.vertex_array_object_id;
+    item.rendering_mode         = object.rendering_mode;
+    item.num_indices            = (GLsizei)object.num_indices;
+    item.index_type             = object.index_type;
+    item.index_offset           = object.first_index * index_size;
+    item.base_vertex            = object.base_vertex;
+    item.material               = material;
+    item.render_as_black        = render_as_black ? GL_TRUE : GL_FALSE;
+    item.line_width             = line_width;
+    item.model                  = glm::mat4(1.0f);
+    item.instance_count         = 0;
+    item.first_instance         = 0;
+    return item;
+}
+
+// AABB do objeto no espaço do mundo, depois da transformação "model".
+static AABB WorldBoundingBox(const SceneObject& object, const glm::mat4& model)
+{
+    AABB local_bbox;
+    local_bbox.min = object.bbox_min;
+    local_bbox.max = object.bbox_max;
+    return transformAABB(local_bbox, model);
+}
+
+// Testa se a AABB de um objeto intersecta o frustum da câmera, e atualiza
+// g_CullingStats.
+static bool IsInViewFrustum(const AABB& world_bbox)
+{
+    if (checkFrustumAABBCollision(g_ViewFrustum, world_bbox))
+    {
+        g_CullingStats.drawn += 1;
+        return true;
+    }
+
+    g_CullingStats.culled += 1;
+    return false;
+}
+
+// Unidade de textura amostrada pelo material de cada "object_id" (veja
+// material.h), e quantas unidades de coordenada de textura há em uma unidade
+// do espaço do mundo.
+static bool ObjectTextureMapping(const SceneObject& object, const glm::mat4& model, GLint object_id,
+                                 GLuint* textureunit, float* uv_per_world_unit)
+{
+    const Material* material = Material_ForObjectId(object_id);
+
+    // "Triplanar mapping" usa as coordenadas do mundo multiplicadas por uma
+    // escala fixa, independentemente da matriz "model".
+    if (material->features & MATERIAL_TRIPLANAR)
+    {
+        *textureunit = (GLuint)material->texture_unit;
+        *uv_per_world_unit = material->texture_scale;
+        return true;
+    }
+
+    if ((material->features & MATERIAL_TEXTURED) == 0)
+        return false;
+    *textureunit = (GLuint)material->texture_unit;
+
+    // Com escala não uniforme, a direção menos esticada é a que precisa de
+    // mais detalhe.
+    float min_scale = std::min(glm::length(glm::vec3(model[0])),
+                               std::min(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    if (object.uv_density <= 0.0f || min_scale <= 0.0f)
+        return false;
+
+    *uv_per_world_unit = object.uv_density / min_scale;
+    return true;
+}
+
+// Pede ao sistema de streaming detalhe suficiente para a textura do objeto,
+// a partir do tamanho de um pixel no ponto do objeto mais próximo da câmera.
+static void RequestTextureDetail(const SceneObject& object, const glm::mat4& model, const AABB& world_bbox,
+                                 GLint object_id)
+{
+    GLuint textureunit;
+    float uv_per_world_unit;
+    if (!ObjectTextureMapping(object, model, object_id, &textureunit, &uv_per_world_unit))
+        return;
+    if (textureunit >= g_StreamedTextures.size() || g_StreamedTextures[textureunit] == INVALID_STREAMED_TEXTURE)
+        return;
+
+    glm::vec3 camera = glm::vec3(g_CameraPosition);
+    glm::vec3 outside = glm::max(glm::max(world_bbox.min - camera, camera - world_bbox.max), glm::vec3(0.0f));
+    float distance = std::max(glm::length(outside), 0.1f); // Dentro da caixa: distância do "near plane"
+
+    float world_per_pixel = g_PixelFootprintPerDistance * distance + g_PixelFootprintConstant;
+    TextureStreaming_Request(g_StreamedTextures[textureunit], uv_per_world_unit * world_per_pixel);
 }
 
 // Função que desenha um objeto armazenado em g_VirtualScene. Veja definição
-// dos objetos na função BuildTrianglesAndAddToVirtualScene().
-void DrawVirtualObject(const char* object_name)
-{
-    // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
-    // vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene(). Veja
-    // comentários detalhados dentro da definição de BuildTrianglesAndAddToVirtualScene().
-    glBindVertexArray(g_VirtualScene[object_name].vertex_array_object_id);
-
-    // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
-    // apontados pelo VAO como linhas. Veja a definição de
-    // g_VirtualScene[""] dentro da função BuildTrianglesAndAddToVirtualScene(), e veja
-    // a documentação da função glDrawElements() em
-    // http://docs.gl/gl3/glDrawElements.
-    glDrawElements(
-        g_VirtualScene[object_name].rendering_mode,
-        g_VirtualScene[object_name].num_indices,
-        GL_UNSIGNED_INT,
-        (void*)(g_VirtualScene[object_name].first_index * sizeof(GLuint))
-    );
+// dos objetos na função AddMeshToVirtualScene(). O objeto é acrescentado na
+// fila de renderização (veja renderqueue.h) com a matriz "model" e o
+// "object_id" dados; o desenho acontece em RenderQueue_Flush().
+void DrawVirtualObject(SceneObjectHandle handle, const glm::mat4& model, GLint object_id,
+                       bool render_as_black, float line_width)
+{
+    const SceneObject& object = g_VirtualScene[handle];
+    AABB world_bbox = WorldBoundingBox(object, model);
+    if (!IsInViewFrustum(world_bbox))
+        return;
 
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+    RequestTextureDetail(object, model, world_bbox, object_id);
+
+    DrawItem item = MakeDrawItem(object, Material_ForObjectId(object_id), render_as_black, line_width);
+    item.model = model;
+    RenderQueue_Push(item);
 }
 
-// Função que desenha um cubo com arestas em preto, definido dentro da função BuildTriangles().
-void DrawCube(GLint render_as_black_uniform)
+// Desenha "num_instances" cópias de um objeto de g_VirtualScene com uma única
+// chamada OpenGL; cada cópia tem sua própria matriz "model". O "object_id" de
+// todas as cópias deve ter o mesmo material.
+void DrawVirtualObjectInstanced(SceneObjectHandle handle, const InstanceData* instances, size_t num_instances,
+                                bool render_as_black, float line_width)
 {
-  glBindVertexArray(g_VirtualScene["cube_faces"].vertex_array_object_id); // Bind VAO here
+    // Somente as cópias visíveis são enviadas; a fila de renderização copia
+    // as instâncias, então o vetor pode ser reaproveitado entre chamadas.
+    static std::vector<InstanceData> visible;
+    visible.clear();
 
-  // Informamos para a placa de vídeo (GPU) que a variável booleana
-  // "render_as_black" deve ser colocada como "false". Veja o arquivo
-  // "shader_vertex.glsl".
-  glUniform1i(render_as_black_uniform, false);
+    const SceneObject& object = g_VirtualScene[handle];
+    for (size_t i = 0; i < num_instances; ++i)
+    {
+        AABB world_bbox = WorldBoundingBox(object, instances[i].model);
+        if (!IsInViewFrustum(world_bbox))
+            continue;
 
-  // Pedimos para a GPU rasterizar os vértices do cubo apontados pelo
-  // VAO como triângulos, formando as faces do cubo. Esta
-  // renderização irá executar o Vertex Shader definido no arquivo
-  // "shader_vertex.glsl", e o mesmo irá utilizar as matrizes
-  // "model", "view" e "projection" definidas acima e já enviadas
-  // para a placa de vídeo (GPU).
-  //
-  // Veja a definição de g_VirtualScene["cube_faces"] dentro da
-  // função BuildTriangles(), e veja a documentação da função
-  // glDrawElements() em http://docs.gl/gl3/glDrawElements.
-  glDrawElements(
-      g_VirtualScene["cube_faces"].rendering_mode, // Veja slides 182-188 do documento Aula_04_Modelagem_Geometrica_3D.pdf
-      g_VirtualScene["cube_faces"].num_indices,    //
-      GL_UNSIGNED_INT,
-      (void*)(g_VirtualScene["cube_faces"].first_index * sizeof(GLuint))
-      );
+        RequestTextureDetail(object, instances[i].model, world_bbox, instances[i].object_id);
+        visible.push_back(instances[i]);
+    }
 
-  // Pedimos para OpenGL desenhar linhas com largura de 4 pixels.
-  glLineWidth(4.0f);
+    if (visible.empty())
+        return;
 
-  // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
-  // apontados pelo VAO como linhas. Veja a definição de
-  // g_VirtualScene["axes"] dentro da função BuildTriangles(), e veja
-  // a documentação da função glDrawElements() em
-  // http://docs.gl/gl3/glDrawElements.
-  //
-  // Importante: estes eixos serão desenhamos com a matriz "model"
-  // definida acima, e portanto sofrerão as mesmas transformações
-  // geométricas que o cubo. Isto é, estes eixos estarão
-  // representando o sistema de coordenadas do modelo (e não o global)!
-  glDrawElements(
-      g_VirtualScene["axes"].rendering_mode,
-      g_VirtualScene["axes"].num_indices,
-      GL_UNSIGNED_INT,
-      (void*)(g_VirtualScene["axes"].first_index * sizeof(GLuint))
-      );
+    // Todas as cópias usam o mesmo material, o da primeira.
+    DrawItem item = MakeDrawItem(object, Material_ForObjectId(visible[0].object_id), render_as_black, line_width);
+    RenderQueue_PushInstanced(item, visible.data(), visible.size());
+}
 
-  // Informamos para a placa de vídeo (GPU) que a variável booleana
-  // "render_as_black" deve ser colocada como "true". Veja o arquivo
-  // "shader_vertex.glsl".
-  glUniform1i(render_as_black_uniform, true);
-
-  // Pedimos para a GPU rasterizar os vértices do cubo apontados pelo
-  // VAO como linhas, formando as arestas pretas do cubo. Veja a
-  // definição de g_VirtualScene["cube_edges"] dentro da função
-  // BuildTriangles(), e veja a documentação da função
-  // glDrawElements() em http://docs.gl/gl3/glDrawElements.
-  glDrawElements(
-      g_VirtualScene["cube_edges"].rendering_mode,
-      g_VirtualScene["cube_edges"].num_indices,
-      GL_UNSIGNED_INT,
-      (void*)(g_VirtualScene["cube_edges"].first_index * sizeof(GLuint))
-      );
+// Função que desenha um cubo com arestas em preto, definido dentro da função
+// BuildTriangles(): as faces coloridas, os eixos do sistema de coordenadas do
+// modelo e as arestas pretas, nesta ordem.
+//
+// Importante: os eixos são desenhados com a mesma matriz "model" do cubo, e
+// portanto sofrem as mesmas transformações geométricas que o cubo. Isto é,
+// estes eixos representam o sistema de coordenadas do modelo (e não o global)!
+void DrawCube(const glm::mat4& model, GLint object_id)
+{
+  DrawVirtualObject(g_CubeFacesObject, model, object_id, false);
+  DrawVirtualObject(g_AxesObject, model, object_id, false, 4.0f);
+  DrawVirtualObject(g_CubeEdgesObject, model, object_id, true, 4.0f);
+}
 
-  glBindVertexArray(0);
+// Análoga a DrawCube(), para várias cópias do cubo: uma chamada OpenGL para
+// as faces, uma para os eixos e uma para as arestas de todas as cópias.
+void DrawCubeInstanced(const InstanceData* instances, size_t num_instances)
+{
+  DrawVirtualObjectInstanced(g_CubeFacesObject, instances, num_instances, false);
+  DrawVirtualObjectInstanced(g_AxesObject, instances, num_instances, false, 4.0f);
+  DrawVirtualObjectInstanced(g_CubeEdgesObject, instances, num_instances, true, 4.0f);
 }
 
-void DrawLine(GLint render_as_black_uniform)
+void DrawLine(const glm::mat4& model, GLint object_id)
 {
-  glUniform1i(render_as_black_uniform, false);
-  glLineWidth(10.0f);
-  glDrawElements(
-      g_VirtualScene["line"].rendering_mode,
-      g_VirtualScene["line"].num_indices,
-      GL_UNSIGNED_INT,
-      (void*)(g_VirtualScene["line"].first_index * sizeof(GLuint))
-      );
+  DrawVirtualObject(g_LineObject, model, object_id, false, 10.0f);
 }
 
 // Constrói triângulos para futura renderização (cubo original do Lab 3)
@@ -1312,7 +2200,7 @@ GLuint BuildTriangles()
 
   glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(model_coefficients), model_coefficients);
 
-  GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
+  GLuint location = ATTRIB_POSITION; // "(location = ATTRIB_POSITION)" em "shader_vertex.glsl"
   GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
   glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
 
@@ -1346,7 +2234,7 @@ GLuint BuildTriangles()
   glBindBuffer(GL_ARRAY_BUFFER, VBO_color_coefficients_id);
   glBufferData(GL_ARRAY_BUFFER, sizeof(color_coefficients), NULL, GL_STATIC_DRAW);
   glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(color_coefficients), color_coefficients);
-  location = 1; // "(location = 1)" em "shader_vertex.glsl"
+  location = ATTRIB_COLOR; // "(location = ATTRIB_COLOR)" em "shader_vertex.glsl"
   number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
   glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
   glEnableVertexAttribArray(location);
@@ -1375,7 +2263,7 @@ GLuint BuildTriangles()
   glGenBuffers(1, &VBO_normal_coefficients_id);
   glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
   glBufferData(GL_ARRAY_BUFFER, sizeof(normal_coefficients), normal_coefficients, GL_STATIC_DRAW);
-  location = 3; // "(location = 3)" em "shader_vertex.glsl"
+  location = ATTRIB_NORMAL; // "(location = ATTRIB_NORMAL)" em "shader_vertex.glsl"
   number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
   glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
   glEnableVertexAttribArray(location);
@@ -1427,8 +2315,10 @@ GLuint BuildTriangles()
   cube_faces.num_indices    = 36;       // Último índice está em indices[35]; total de 36 índices.
   cube_faces.rendering_mode = GL_TRIANGLES; // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
   cube_faces.vertex_array_object_id = vertex_array_object_id;
+  cube_faces.bbox_min       = glm::vec3(-0.5f, -1.0f, -0.5f);
+  cube_faces.bbox_max       = glm::vec3( 0.5f,  0.0f,  0.5f);
 
-  g_VirtualScene["cube_faces"] = cube_faces;
+  AddSceneObject(cube_faces);
 
   // Criamos um segundo objeto virtual (SceneObject) que se refere às arestas
   // pretas do cubo.
@@ -1438,8 +2328,10 @@ GLuint BuildTriangles()
   cube_edges.num_indices    = 24; // Último índice está em indices[59]; total de 24 índices.
   cube_edges.rendering_mode = GL_LINES; // Índices correspondem ao tipo de rasterização GL_LINES.
   cube_edges.vertex_array_object_id = vertex_array_object_id;
+  cube_edges.bbox_min       = cube_faces.bbox_min;
+  cube_edges.bbox_max       = cube_faces.bbox_max;
 
-  g_VirtualScene["cube_edges"] = cube_edges;
+  AddSceneObject(cube_edges);
 
   // Criamos um terceiro objeto virtual (SceneObject) que se refere aos eixos XYZ.
   SceneObject axes;
@@ -1448,7 +2340,9 @@ GLuint BuildTriangles()
   axes.num_indices    = 6; // Último índice está em indices[65]; total de 6 índices.
   axes.rendering_mode = GL_LINES; // Índices correspondem ao tipo de rasterização GL_LINES.
   axes.vertex_array_object_id = vertex_array_object_id;
-  g_VirtualScene["axes"] = axes;
+  axes.bbox_min       = glm::vec3(0.0f, 0.0f, 0.0f);
+  axes.bbox_max       = glm::vec3(10.0f, 10.0f, 10.0f);
+  AddSceneObject(axes);
 
   // Criamos um buffer OpenGL para armazenar os índices acima
   GLuint indices_id;
@@ -1490,7 +2384,7 @@ GLuint BuildLine()
 
     glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(model_coefficients), model_coefficients);
 
-    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
+    GLuint location = ATTRIB_POSITION; // "(location = ATTRIB_POSITION)" em "shader_vertex.glsl"
     GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
     glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
 
@@ -1508,7 +2402,7 @@ GLuint BuildLine()
     glBindBuffer(GL_ARRAY_BUFFER, VBO_color_coefficients_id);
     glBufferData(GL_ARRAY_BUFFER, sizeof(color_coefficients), NULL, GL_STATIC_DRAW);
     glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(color_coefficients), color_coefficients);
-    location = 1; // "(location = 1)" em "shader_vertex.glsl"
+    location = ATTRIB_COLOR; // "(location = ATTRIB_COLOR)" em "shader_vertex.glsl"
     number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
     glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(location);
@@ -1524,7 +2418,9 @@ GLuint BuildLine()
     line.num_indices    = 2;
     line.rendering_mode = GL_LINES;
     line.vertex_array_object_id = vertex_array_object_id;
-    g_VirtualScene["line"] = line;
+    line.bbox_min       = glm::vec3(0.0f, 0.0f, -1000.0f);
+    line.bbox_max       = glm::vec3(0.0f, 0.0f, 0.0f);
+    AddSceneObject(line);
 
     GLuint indices_id;
     glGenBuffers(1, &indices_id);
@@ -1587,29 +2483,29 @@ GLuint BuildPlane()
     glGenBuffers(1, &VBO_model_coefficients_id);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
     glBufferData(GL_ARRAY_BUFFER, sizeof(model_coefficients), model_coefficients, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(ATTRIB_POSITION, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(ATTRIB_POSITION);
 
     GLuint VBO_texture_coefficients_id;
     glGenBuffers(1, &VBO_texture_coefficients_id);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_texture_coefficients_id);
     glBufferData(GL_ARRAY_BUFFER, sizeof(texture_coefficients), texture_coefficients, GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(ATTRIB_TEXCOORD);
 
     GLuint VBO_color_coefficients_id;
     glGenBuffers(1, &VBO_color_coefficients_id);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_color_coefficients_id);
     glBufferData(GL_ARRAY_BUFFER, sizeof(color_coefficients), color_coefficients, GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(ATTRIB_COLOR);
 
     GLuint VBO_normal_coefficients_id;
     glGenBuffers(1, &VBO_normal_coefficients_id);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
     glBufferData(GL_ARRAY_BUFFER, sizeof(normal_coefficients), normal_coefficients, GL_STATIC_DRAW);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, 0); // location 3
-    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(ATTRIB_NORMAL, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(ATTRIB_NORMAL);
 
     GLuint indices_id;
     glGenBuffers(1, &indices_id);
@@ -1622,48 +2518,37 @@ GLuint BuildPlane()
     plane.num_indices = 6;
     plane.rendering_mode = GL_TRIANGLES;
     plane.vertex_array_object_id = vertex_array_object_id;
-    g_VirtualScene["plane"] = plane;
+    plane.bbox_min = glm::vec3(-500.0f, -0.5f, -500.0f);
+    plane.bbox_max = glm::vec3( 500.0f, -0.5f,  500.0f);
+    plane.uv_density = 50.0f / 1000.0f; // Coordenadas de textura de 0 a 50 ao longo de 1000 unidades
+    AddSceneObject(plane);
 
     glBindVertexArray(0);
 
     return vertex_array_object_id;
 }
 
-// Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Vertex(const char* filename)
-{
-  // Criamos um identificador (ID) para este shader, informando que o mesmo
-  // será aplicado nos vértices.
-  GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-
-  // Carregamos e compilamos o shader
-  LoadShader(filename, vertex_shader_id);
-
-  // Retorna o ID gerado acima
-  return vertex_shader_id;
-}
-
-// Carrega um Fragment Shader de um arquivo GLSL . Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Fragment(const char* filename)
+// Insere "defines" logo após a diretiva "#version" de um código GLSL (que
+// obrigatoriamente deve ser a primeira linha do shader).
+std::string InjectShaderDefines(const std::string& source, const std::string& defines)
 {
-  // Criamos um identificador (ID) para este shader, informando que o mesmo
-  // será aplicado nos fragmentos.
-  GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+  size_t version = source.find("#version");
+  if (version == std::string::npos)
+    return defines + source;
 
-  // Carregamos e compilamos o shader
-  LoadShader(filename, fragment_shader_id);
+  size_t end_of_line = source.find('\n', version);
+  if (end_of_line == std::string::npos)
+    return source + "\n" + defines;
 
-  // Retorna o ID gerado acima
-  return fragment_shader_id;
+  return source.substr(0, end_of_line + 1) + defines + source.substr(end_of_line + 1);
 }
 
-// Função auxilar, utilizada pelas duas funções acima. Carrega código de GPU de
-// um arquivo GLSL e faz sua compilação.
-void LoadShader(const char* filename, GLuint shader_id)
+// Lê o código de GPU de um arquivo GLSL, já com os "#define"s do formato de
+// vértice (veja vertexformat.h). A compilação é feita por shadercache.h.
+std::string ReadShaderSource(const char* filename)
 {
   // Lemos o arquivo de texto indicado pela variável "filename"
-  // e colocamos seu conteúdo em memória, apontado pela variável
-  // "shader_string".
+  // e colocamos seu conteúdo em memória.
   std::ifstream file;
   try {
     file.exceptions(std::ifstream::failbit);
@@ -1674,57 +2559,7 @@ void LoadShader(const char* filename, GLuint shader_id)
   }
   std::stringstream shader;
   shader << file.rdbuf();
-  std::string str = shader.str();
-  const GLchar* shader_string = str.c_str();
-  const GLint   shader_string_length = static_cast<GLint>( str.length() );
-
-  // Define o código do shader GLSL, contido na string "shader_string"
-  glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
-
-  // Compila o código do shader GLSL (em tempo de execução)
-  glCompileShader(shader_id);
-
-  // Verificamos se ocorreu algum erro ou "warning" durante a compilação
-  GLint compiled_ok;
-  glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
-
-  GLint log_length = 0;
-  glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
-
-  // Alocamos memória para guardar o log de compilação.
-  // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-  GLchar* log = new GLchar[log_length];
-  glGetShaderInfoLog(shader_id, log_length, &log_length, log);
-
-  // Imprime no terminal qualquer erro ou "warning" de compilação
-  if ( log_length != 0 )
-  {
-    std::string  output;
-
-    if ( !compiled_ok )
-    {
-      output += "ERROR: OpenGL compilation of \"";
-      output += filename;
-      output += "\" failed.\n";
-      output += "== Start of compilation log\n";
-      output += log;
-      output += "== End of compilation log\n";
-    }
-    else
-    {
-      output += "WARNING: OpenGL compilation of \"";
-      output += filename;
-      output += "\".\n";
-      output += "== Start of compilation log\n";
-      output += log;
-      output += "== End of compilation log\n";
-    }
-
-    fprintf(stderr, "%s", output.c_str());
-  }
-
-  // A chamada "delete" em C++ é equivalente ao "free()" do C
-  delete [] log;
+  return InjectShaderDefines(shader.str(), VertexFormat_ShaderDefines());
 }
 
 // Função que carrega os shaders de vértices e de fragmentos que serão
@@ -1750,70 +2585,78 @@ void LoadShadersFromFiles()
     //       |
     //       o-- shader_fragment.glsl
     //
-    GLuint vertex_shader_id = LoadShader_Vertex("../../src/shader_vertex.glsl");
-    GLuint fragment_shader_id = LoadShader_Fragment("../../src/shader_fragment.glsl");
-
-    // Deletamos o programa de GPU anterior, caso ele exista.
-    if ( g_GpuProgramID != 0 )
-        glDeleteProgram(g_GpuProgramID);
-
-    // Criamos um programa de GPU utilizando os shaders carregados acima.
-    g_GpuProgramID = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
-
-    // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
-    // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
-    // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
-    g_model_uniform      = glGetUniformLocation(g_GpuProgramID, "model"); // Variável da matriz "model"
-    g_view_uniform       = glGetUniformLocation(g_GpuProgramID, "view"); // Variável da matriz "view" em shader_vertex.glsl
-    g_projection_uniform = glGetUniformLocation(g_GpuProgramID, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
-    g_object_id_uniform  = glGetUniformLocation(g_GpuProgramID, "object_id"); // Variável "object_id" em shader_fragment.glsl
+    std::string vertex_source = ReadShaderSource("../../src/shader_vertex.glsl");
+    std::string fragment_source = ReadShaderSource("../../src/shader_fragment.glsl");
+
+    // Deletamos os programas de GPU anteriores, caso existam.
+    for (size_t i = 0; i < g_ShaderPermutations.size(); ++i)
+        glDeleteProgram(g_ShaderPermutations[i].pending.program_id);
+    g_ShaderPermutations.clear();
+    for (size_t i = 0; i < MATERIAL_NUM_PERMUTATIONS; ++i)
+        g_ShaderPermutationByFeatures[i] = NULL;
+
+    // Iniciamos a criação de um programa por permutação, sem esperar pelo
+    // driver: com KHR_parallel_shader_compile, todos são compilados ao mesmo
+    // tempo. O resultado só é consultado em FinishShadersFromFiles().
+    g_ShaderPermutations.resize(Material_NumPermutations());
+    for (size_t i = 0; i < g_ShaderPermutations.size(); ++i)
+    {
+        ShaderPermutation& permutation = g_ShaderPermutations[i];
+        permutation.features = Material_Permutation(i);
+
+        std::string name = "shader_" + Material_PermutationName(permutation.features);
+        std::string permutation_source = InjectShaderDefines(fragment_source, Material_ShaderDefines(permutation.features));
+        ShaderCache_BeginProgram(&permutation.pending, name.c_str(), vertex_source, permutation_source);
+    }
 }
 
-// Esta função cria um programa de GPU, o qual contém obrigatoriamente um
-// Vertex Shader e um Fragment Shader.
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
+// Termina os programas iniciados por LoadShadersFromFiles() e busca os seus
+// "uniforms". Com "wait" falso, somente os programas que o driver já
+// compilou (veja ShaderCache_IsProgramReady()) são terminados; com "wait"
+// verdadeiro, espera por todos, e deve ser chamada antes do primeiro desenho.
+// Retorna se todos os programas estão prontos.
+bool FinishShadersFromFiles(bool wait)
 {
-  // Criamos um identificador (ID) para este programa de GPU
-  GLuint program_id = glCreateProgram();
-
-  // Definição dos dois shaders GLSL que devem ser executados pelo programa
-  glAttachShader(program_id, vertex_shader_id);
-  glAttachShader(program_id, fragment_shader_id);
-
-  // Linkagem dos shaders acima ao programa
-  glLinkProgram(program_id);
-
-  // Verificamos se ocorreu algum erro durante a linkagem
-  GLint linked_ok = GL_FALSE;
-  glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
-
-  // Imprime no terminal qualquer erro de linkagem
-  if ( linked_ok == GL_FALSE )
-  {
-    GLint log_length = 0;
-    glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &log_length);
-
-    // Alocamos memória para guardar o log de compilação.
-    // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-    GLchar* log = new GLchar[log_length];
+    bool all_finished = true;
 
-    glGetProgramInfoLog(program_id, log_length, &log_length, log);
-
-    std::string output;
-
-    output += "ERROR: OpenGL linking of program failed.\n";
-    output += "== Start of link log\n";
-    output += log;
-    output += "\n== End of link log\n";
+    for (size_t i = 0; i < g_ShaderPermutations.size(); ++i)
+    {
+        ShaderPermutation& permutation = g_ShaderPermutations[i];
+        if (g_ShaderPermutationByFeatures[permutation.features] != NULL)
+            continue; // Já terminado em uma chamada anterior
 
-    // A chamada "delete" em C++ é equivalente ao "free()" do C
-    delete [] log;
+        if (!wait && !ShaderCache_IsProgramReady(permutation.pending))
+        {
+            all_finished = false;
+            continue;
+        }
 
-    fprintf(stderr, "%s", output.c_str());
-  }
+        ShaderCache_FinishProgram(&permutation.pending);
+
+        // Buscamos o endereço das variáveis definidas dentro dos shaders.
+        // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
+        // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
+        // Variáveis que a permutação não usa têm endereço -1.
+        GLuint program_id = permutation.pending.program_id;
+        RenderQueue_BindFrameUniforms(program_id); // Bloco "FrameUniforms", com as matrizes "view" e "projection"
+
+        RenderProgram& program = permutation.program;
+        program.program_id              = program_id;
+        program.model_uniform           = glGetUniformLocation(program_id, "model"); // Variável da matriz "model"
+        program.model_view_projection_uniform = glGetUniformLocation(program_id, "model_view_projection"); // Variáveis calculadas na CPU
+        program.normal_matrix_uniform   = glGetUniformLocation(program_id, "normal_matrix"); // a partir de "model" (veja renderqueue.h)
+        program.render_as_black_uniform = glGetUniformLocation(program_id, "render_as_black"); // Variável booleana em shader_vertex.glsl
+        program.instanced_uniform       = glGetUniformLocation(program_id, "instanced"); // Variável booleana em shader_vertex.glsl
+        program.diffuse_uniform         = glGetUniformLocation(program_id, "material_diffuse");
+        program.specular_uniform        = glGetUniformLocation(program_id, "material_specular");
+        program.shininess_uniform       = glGetUniformLocation(program_id, "material_shininess");
+        program.texture_scale_uniform   = glGetUniformLocation(program_id, "material_texture_scale");
+        program.texture_uniform         = glGetUniformLocation(program_id, "TextureImage");
+
+        g_ShaderPermutationByFeatures[permutation.features] = &permutation;
+    }
 
-  // Retornamos o ID gerado acima
-  return program_id;
+    return all_finished;
 }
 
 // Definição da função que será chamada sempre que a janela do sistema
@@ -1824,6 +2667,7 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
   glViewport(0, 0, width, height);
 
   g_ScreenRatio = (float)width / height;
+  g_ScreenHeight = height;
 }
 
 // Variáveis globais que armazenam a última posição do cursor do mouse, para
@@ -1834,28 +2678,23 @@ double g_LastCursorPosX, g_LastCursorPosY;
 // Função callback chamada sempre que o usuário aperta algum dos botões do mouse
 void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
-  if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && !g_UseLookAtCamera)
+  // Cliques durante a tela de carregamento são ignorados: o alvo ainda não existe.
+  if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && !g_UseLookAtCamera && g_TargetObject != INVALID_SCENE_OBJECT)
   {
-    glm::mat4 model = Matrix_Identity();
-    model = model * Matrix_Translate(g_TargetPosition.x, g_TargetPosition.y, g_TargetPosition.z);
-    model = model * Matrix_Rotate_Y(g_TargetAngle);
-    model = model * Matrix_Rotate_X(-1.57079632679f); // Rotaciona para ficar em pé
-    model = model * Matrix_Scale(0.015f * g_TargetScale, 0.015f * g_TargetScale, 0.015f * g_TargetScale);
-
-    glm::mat4 invModel = glm::inverse(model);
-    Ray local_ray;
-    local_ray.origin = glm::vec3(invModel * glm::vec4(g_CameraPosition.x, g_CameraPosition.y, g_CameraPosition.z, 1.0f));
-    local_ray.direction = glm::vec3(invModel * glm::vec4(g_CameraViewVector.x, g_CameraViewVector.y, g_CameraViewVector.z, 0.0f));
-
-    SceneObject target = g_VirtualScene["10480_archery_target"];
-    AABB target_bbox;
-    target_bbox.min = target.bbox_min;
-    target_bbox.max = target.bbox_max;
+    Ray ray;
+    ray.origin = glm::vec3(g_CameraPosition);
+    ray.direction = glm::vec3(g_CameraViewVector);
 
-    if (checkRayAABBCollision(local_ray, target_bbox))
+    uint32_t hit_id;
+    float hit_distance;
+    if (RaycastTargets(ray, &hit_id, &hit_distance))
     {
-        GenerateNewBezierPath(true);
-        g_TargetPosition = g_ControlPoints[0];
+        Target& target = g_Targets[hit_id];
+        TeleportTarget(&target);
+        Broadphase_Update(&g_TargetGrid, hit_id, TargetBounds(target));
+
+        g_ShotHit = true;
+        g_ShotHitTimer = 1.0f;
     }
   }
   if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE)
@@ -2014,6 +2853,12 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
     g_ShowInfoText = !g_ShowInfoText;
   }
 
+  // Se o usuário apertar a tecla F3, fazemos um "toggle" do profiler mostrado na tela.
+  if (key == GLFW_KEY_F3 && action == GLFW_PRESS)
+  {
+    g_ShowProfiler = !g_ShowProfiler;
+  }
+
   // Se o usuário apertar a tecla L, alternamos o tipo de câmera
   if (key == GLFW_KEY_L && action == GLFW_PRESS)
   {
@@ -2158,7 +3003,10 @@ void TextRendering_ShowEulerAngles(GLFWwindow* window)
   snprintf(buffer, 80, "Euler Angles rotation matrix = Z(%.2f)*Y(%.2f)*X(%.2f)\n", g_AngleZ, g_AngleY, g_AngleX);
   TextRendering_PrintString(window, buffer, -1.0f+pad/10, -1.0f+2*pad/10, 1.0f);
 
-  snprintf(buffer, 80, "Shot Hit: %s", g_ShotHit ? "True" : "False");
+  if (g_AimOnTarget)
+    snprintf(buffer, 80, "Shot Hit: %s  Aim: target %u (%.1f)", g_ShotHit ? "True" : "False", g_AimTarget, g_AimDistance);
+  else
+    snprintf(buffer, 80, "Shot Hit: %s", g_ShotHit ? "True" : "False");
   TextRendering_PrintString(window, buffer, -1.0f+pad/10, -1.0f+4*pad/10, 1.0f);
 }
 
@@ -2177,6 +3025,100 @@ void TextRendering_ShowProjection(GLFWwindow* window)
     TextRendering_PrintString(window, "Orthographic", 1.0f-13*charwidth, -1.0f+2*lineheight/10, 1.0f);
 }
 
+// Tela mostrada enquanto texturas e modelos são carregados: número de
+// recursos concluídos, uma barra de progresso e o último recurso concluído.
+void TextRendering_ShowLoadingProgress(GLFWwindow* window)
+{
+  glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  AssetLoaderProgress progress = AssetLoader_Progress();
+
+  const int bar_width = 30;
+  int filled = progress.num_submitted > 0 ? (int)(bar_width * progress.num_finished / progress.num_submitted) : 0;
+
+  char buffer[80];
+  snprintf(buffer, 80, "Carregando... %zu/%zu", progress.num_finished, progress.num_submitted);
+
+  std::string bar = "[" + std::string(filled, '#') + std::string(bar_width - filled, '.') + "]";
+
+  float lineheight = TextRendering_LineHeight(window);
+  float charwidth = TextRendering_CharWidth(window);
+
+  TextRendering_PrintString(window, buffer, -0.5f*strlen(buffer)*charwidth, lineheight, 1.0f);
+  TextRendering_PrintString(window, bar, -0.5f*bar.size()*charwidth, 0.0f, 1.0f);
+
+  if (!progress.last_finished.empty())
+    TextRendering_PrintString(window, progress.last_finished, -0.5f*progress.last_finished.size()*charwidth, -lineheight, 1.0f);
+}
+
+// Mostra quantas chamadas OpenGL a fila de renderização fez no último quadro
+// e quantas foram evitadas pelo cache de estado (veja renderqueue.h), além
+// dos contadores de descarte de objetos e de streaming de texturas.
+void TextRendering_ShowRenderQueueStats(GLFWwindow* window)
+{
+  if ( !g_ShowInfoText )
+    return;
+
+  const RenderQueueStats& stats = RenderQueue_Stats();
+
+  float lineheight = TextRendering_LineHeight(window);
+
+  char buffer[80];
+  snprintf(buffer, 80, "Draws: %u (%u instanced, %u instances)",
+           stats.draw_calls, stats.instanced_draw_calls, stats.instances);
+  TextRendering_PrintString(window, buffer, -1.0f, 1.0f-lineheight, 1.0f);
+  snprintf(buffer, 80, "Programs: %u (-%u)  VAOs: %u (-%u)",
+           stats.program_binds, stats.program_binds_skipped, stats.vao_binds, stats.vao_binds_skipped);
+  TextRendering_PrintString(window, buffer, -1.0f, 1.0f-2*lineheight, 1.0f);
+  snprintf(buffer, 80, "Uniforms: %u (-%u)  Lines: %u (-%u)",
+           stats.uniform_writes, stats.uniform_writes_skipped, stats.line_width_changes, stats.line_width_changes_skipped);
+  TextRendering_PrintString(window, buffer, -1.0f, 1.0f-3*lineheight, 1.0f);
+  snprintf(buffer, 80, "Culling: %u drawn, %u culled",
+           g_CullingStats.drawn, g_CullingStats.culled);
+  TextRendering_PrintString(window, buffer, -1.0f, 1.0f-4*lineheight, 1.0f);
+
+  // Residência das texturas (veja texturestreaming.h).
+  if (g_UseCompressedTextures)
+  {
+    const TextureStreamingStats& textures = TextureStreaming_Stats();
+    const float megabyte = 1024.0f*1024.0f;
+    snprintf(buffer, 80, "Textures: %.1f/%.1f MB (all %.1f), %u/%u mips, -%.1f MB",
+             textures.resident_bytes/megabyte, textures.budget_bytes/megabyte, textures.full_bytes/megabyte,
+             textures.levels_resident, textures.levels_total, textures.pending_bytes/megabyte);
+    TextRendering_PrintString(window, buffer, -1.0f, 1.0f-5*lineheight, 1.0f);
+  }
+}
+
+// Escrevemos na tela, abaixo dos contadores da fila de renderização, o
+// tempo médio de CPU e de GPU de cada seção do quadro (veja profiler.h).
+void TextRendering_ShowProfiler(GLFWwindow* window)
+{
+  if ( !g_ShowProfiler )
+    return;
+
+  ProfileSummary summary = Profiler_Summary();
+
+  float lineheight = TextRendering_LineHeight(window);
+  float y = 1.0f - 6*lineheight;
+
+  char buffer[80];
+  snprintf(buffer, 80, "Profiler (%u frames)    CPU ms   GPU ms", summary.num_frames);
+  TextRendering_PrintString(window, buffer, -1.0f, y, 1.0f);
+  snprintf(buffer, 80, "  %-20s %7.3f", "frame", summary.frame_ms);
+  TextRendering_PrintString(window, buffer, -1.0f, y - lineheight, 1.0f);
+
+  for (int i = 0; i < PROFILE_NUM_SECTIONS; ++i)
+  {
+    ProfileSection section = (ProfileSection)i;
+    if (summary.gpu_ms[i] >= 0.0)
+      snprintf(buffer, 80, "  %-20s %7.3f  %7.3f", Profiler_SectionName(section), summary.cpu_ms[i], summary.gpu_ms[i]);
+    else
+      snprintf(buffer, 80, "  %-20s %7.3f        -", Profiler_SectionName(section), summary.cpu_ms[i]);
+    TextRendering_PrintString(window, buffer, -1.0f, y - (i + 2)*lineheight, 1.0f);
+  }
+}
+
 // Escrevemos na tela o número de quadros renderizados por segundo (frames per
 // second).
 void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
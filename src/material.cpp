@@ -0,0 +1,100 @@
+#include "../include/material.h"
+
+#include <cctype>
+
+// Tabela de materiais, com os mesmos valores que antes ficavam espalhados
+// pelos "if"s de "shader_fragment.glsl". O termo ambiente é sempre Ka = Kd/2.
+struct MaterialEntry
+{
+    GLint    first_object_id;
+    GLint    last_object_id;
+    Material material;
+};
+
+static const MaterialEntry g_Materials[] = {
+    {  1,  1, { "bunny",  MATERIAL_FLAT_COLOR,   glm::vec3(0.08f, 0.4f, 0.8f), glm::vec3(0.8f), 32.0f, 0, 0.0f } },
+    {  5,  5, { "sphere", MATERIAL_FLAT_COLOR,   glm::vec3(0.8f, 0.4f, 0.08f), glm::vec3(0.0f),  1.0f, 0, 0.0f } },
+    {  6,  6, { "target", MATERIAL_TEXTURED,     glm::vec3(0.0f),              glm::vec3(0.1f), 10.0f, 4, 0.0f } },
+    {  7,  7, { "plane",  MATERIAL_TEXTURED,     glm::vec3(0.0f),              glm::vec3(0.1f), 10.0f, 5, 0.0f } },
+    { 10, 13, { "usp",    MATERIAL_TEXTURED,     glm::vec3(0.0f),              glm::vec3(0.8f), 32.0f, 3, 0.0f } },
+    { 50, 50, { "wall",   MATERIAL_TRIPLANAR,    glm::vec3(0.0f),              glm::vec3(0.1f), 10.0f, 2, 0.1f } },
+    { 99, 99, { "robot",  MATERIAL_VERTEX_COLOR, glm::vec3(0.0f),              glm::vec3(0.0f),  1.0f, 0, 0.0f } },
+};
+
+static const Material g_DefaultMaterial = {
+    "default", MATERIAL_FLAT_COLOR, glm::vec3(0.0f), glm::vec3(0.0f), 1.0f, 0, 0.0f
+};
+
+const Material* Material_ForObjectId(GLint object_id)
+{
+    for (size_t i = 0; i < sizeof(g_Materials)/sizeof(g_Materials[0]); ++i)
+    {
+        if (object_id >= g_Materials[i].first_object_id && object_id <= g_Materials[i].last_object_id)
+            return &g_Materials[i].material;
+    }
+    return &g_DefaultMaterial;
+}
+
+// Lista das permutações, construída na primeira consulta.
+static uint32_t g_Permutations[MATERIAL_NUM_PERMUTATIONS];
+static size_t   g_NumPermutations = 0;
+
+static void CollectPermutations()
+{
+    if (g_NumPermutations > 0)
+        return;
+
+    bool used[MATERIAL_NUM_PERMUTATIONS] = { false };
+    used[g_DefaultMaterial.features] = true;
+    for (size_t i = 0; i < sizeof(g_Materials)/sizeof(g_Materials[0]); ++i)
+        used[g_Materials[i].material.features] = true;
+
+    for (uint32_t features = 0; features < MATERIAL_NUM_PERMUTATIONS; ++features)
+    {
+        if (used[features])
+            g_Permutations[g_NumPermutations++] = features;
+    }
+}
+
+size_t Material_NumPermutations()
+{
+    CollectPermutations();
+    return g_NumPermutations;
+}
+
+uint32_t Material_Permutation(size_t index)
+{
+    CollectPermutations();
+    return g_Permutations[index];
+}
+
+// Nome de cada bit de MaterialFeature, na ordem dos bits.
+static const char* const g_FeatureNames[] = {
+    "VERTEX_COLOR", "FLAT_COLOR", "TEXTURED", "TRIPLANAR"
+};
+
+std::string Material_ShaderDefines(uint32_t features)
+{
+    std::string defines;
+    for (size_t bit = 0; bit < sizeof(g_FeatureNames)/sizeof(g_FeatureNames[0]); ++bit)
+    {
+        if (features & (1u << bit))
+            defines += std::string("#define MATERIAL_") + g_FeatureNames[bit] + "\n";
+    }
+    return defines;
+}
+
+std::string Material_PermutationName(uint32_t features)
+{
+    std::string name;
+    for (size_t bit = 0; bit < sizeof(g_FeatureNames)/sizeof(g_FeatureNames[0]); ++bit)
+    {
+        if ((features & (1u << bit)) == 0)
+            continue;
+        if (!name.empty())
+            name += "-";
+        for (const char* c = g_FeatureNames[bit]; *c != '\0'; ++c)
+            name += (char)tolower(*c);
+    }
+    return name.empty() ? "none" : name;
+}
@@ -0,0 +1,353 @@
+#include "../include/meshcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+// Incremente sempre que o formato do arquivo ou o processamento da geometria
+// mudar, para que caches antigos sejam descartados e escritos novamente.
+#define MESHCACHE_VERSION 4
+
+// Todos os blocos de dados do arquivo começam em um múltiplo deste valor.
+#define MESHCACHE_ALIGNMENT 16
+
+static const char MESHCACHE_MAGIC[8] = { 'F', 'C', 'G', 'M', 'E', 'S', 'H', '\0' };
+
+// Cabeçalho no início do arquivo de cache. Os campos "source_*" identificam
+// a versão do arquivo ".obj" a partir da qual o cache foi gerado.
+struct MeshCacheHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t source_size;
+    int64_t  source_mtime;
+    uint64_t source_hash;
+    uint32_t num_shapes;
+    uint32_t num_vertices;
+    uint32_t indices_size;
+    uint32_t vertex_size;
+    uint64_t shapes_offset;
+    uint64_t vertices_offset;
+    uint64_t indices_offset;
+    uint64_t file_size;
+};
+
+struct SourceInfo
+{
+    uint64_t size;
+    int64_t  mtime;
+    uint64_t hash;
+};
+
+static std::string CachePath(const char* obj_filename)
+{
+    return std::string(obj_filename) + ".meshcache";
+}
+
+static uint64_t AlignUp(uint64_t offset)
+{
+    return (offset + MESHCACHE_ALIGNMENT - 1) & ~(uint64_t)(MESHCACHE_ALIGNMENT - 1);
+}
+
+// Hash FNV-1a de 64 bits do conteúdo do arquivo.
+// Veja http://www.isthe.com/chongo/tech/comp/fnv/
+static bool HashFile(const char* filename, uint64_t* hash)
+{
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL)
+        return false;
+
+    uint64_t h = 14695981039346656037ULL;
+    unsigned char buffer[64*1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            h ^= buffer[i];
+            h *= 1099511628211ULL;
+        }
+    }
+
+    fclose(f);
+    *hash = h;
+    return true;
+}
+
+static bool GetSourceInfo(const char* obj_filename, SourceInfo* info, bool compute_hash)
+{
+    struct stat st;
+    if (stat(obj_filename, &st) != 0)
+        return false;
+
+    info->size  = (uint64_t)st.st_size;
+    info->mtime = (int64_t)st.st_mtime;
+    info->hash  = 0;
+
+    if (compute_hash)
+        return HashFile(obj_filename, &info->hash);
+
+    return true;
+}
+
+MeshView MeshGeometry_View(const MeshGeometry& geometry)
+{
+    MeshView view;
+    view.shapes       = geometry.shapes.data();
+    view.num_shapes   = (uint32_t)geometry.shapes.size();
+    view.vertices     = geometry.vertices.data();
+    view.num_vertices = (uint32_t)geometry.vertices.size();
+    view.indices      = geometry.indices.data();
+    view.indices_size = (uint32_t)geometry.indices.size();
+    return view;
+}
+
+// Mapeia o arquivo inteiro em memória, somente para leitura.
+static bool MapFile(MeshCache* cache, const char* filename)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    cache->data    = data;
+    cache->size    = (size_t)size.QuadPart;
+    cache->file    = file;
+    cache->mapping = mapping;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    cache->data    = data;
+    cache->size    = (size_t)st.st_size;
+    cache->file    = NULL;
+    cache->mapping = NULL;
+#endif
+    return true;
+}
+
+void MeshCache_Close(MeshCache* cache)
+{
+    if (cache->data == NULL)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(cache->data);
+    CloseHandle((HANDLE)cache->mapping);
+    CloseHandle((HANDLE)cache->file);
+#else
+    munmap(cache->data, cache->size);
+#endif
+
+    memset(cache, 0, sizeof(*cache));
+}
+
+// Confere se um objeto lido do cache aponta somente para dentro dos buffers
+// descritos pelo cabeçalho. Um arquivo com o corpo corrompido mas com o
+// cabeçalho intacto passa pela verificação do ".obj" de origem, e sem esta
+// verificação causaria leituras fora do mapeamento.
+static bool IsValidShape(const MeshShape& shape, const MeshCacheHeader& header)
+{
+    if (memchr(shape.name, '\0', MESHCACHE_MAX_NAME) == NULL)
+        return false;
+    if (shape.index_size != sizeof(uint16_t) && shape.index_size != sizeof(uint32_t))
+        return false;
+
+    uint64_t end_index  = ((uint64_t)shape.first_index + shape.num_indices) * shape.index_size;
+    uint64_t end_vertex = (uint64_t)shape.base_vertex + shape.num_vertices;
+    return end_index <= header.indices_size && end_vertex <= header.num_vertices;
+}
+
+bool MeshCache_Open(MeshCache* cache, const char* obj_filename)
+{
+    memset(cache, 0, sizeof(*cache));
+
+    SourceInfo source;
+    if (!GetSourceInfo(obj_filename, &source, false))
+        return false;
+
+    std::string path = CachePath(obj_filename);
+    if (!MapFile(cache, path.c_str()))
+        return false;
+
+    const MeshCacheHeader* header = (const MeshCacheHeader*)cache->data;
+    const char* base = (const char*)cache->data;
+
+    bool valid = cache->size >= sizeof(MeshCacheHeader)
+              && memcmp(header->magic, MESHCACHE_MAGIC, sizeof(MESHCACHE_MAGIC)) == 0
+              && header->version == MESHCACHE_VERSION
+              && header->header_size == sizeof(MeshCacheHeader)
+              && header->vertex_size == sizeof(PackedVertex)
+              && header->file_size == cache->size
+              && header->source_size == source.size
+              && header->source_mtime == source.mtime;
+
+    // Tamanho e data de modificação coincidem; confirmamos pelo conteúdo.
+    if (valid)
+        valid = GetSourceInfo(obj_filename, &source, true) && header->source_hash == source.hash;
+
+    if (valid)
+    {
+        uint64_t end_shapes    = header->shapes_offset    + (uint64_t)header->num_shapes   * sizeof(MeshShape);
+        uint64_t end_vertices  = header->vertices_offset  + (uint64_t)header->num_vertices * sizeof(PackedVertex);
+        uint64_t end_indices   = header->indices_offset   + (uint64_t)header->indices_size;
+
+        valid = end_shapes <= cache->size
+             && end_vertices <= cache->size
+             && end_indices <= cache->size;
+    }
+
+    if (valid)
+    {
+        const MeshShape* shapes = (const MeshShape*)(base + header->shapes_offset);
+        for (uint32_t i = 0; i < header->num_shapes && valid; ++i)
+            valid = IsValidShape(shapes[i], *header);
+    }
+
+    if (!valid)
+    {
+        MeshCache_Close(cache);
+        return false;
+    }
+
+    MeshView& view = cache->view;
+    view.shapes       = (const MeshShape*)(base + header->shapes_offset);
+    view.num_shapes   = header->num_shapes;
+    view.vertices     = (const PackedVertex*)(base + header->vertices_offset);
+    view.num_vertices = header->num_vertices;
+    view.indices      = (const uint8_t*)(base + header->indices_offset);
+    view.indices_size = header->indices_size;
+
+    return true;
+}
+
+// Escreve "size" bytes e completa com zeros até o próximo alinhamento.
+static bool WriteBlock(FILE* f, const void* data, size_t size, uint64_t* offset)
+{
+    static const char zeros[MESHCACHE_ALIGNMENT] = { 0 };
+
+    if (size > 0 && fwrite(data, 1, size, f) != size)
+        return false;
+
+    uint64_t end = *offset + size;
+    uint64_t padding = AlignUp(end) - end;
+    if (padding > 0 && fwrite(zeros, 1, (size_t)padding, f) != padding)
+        return false;
+
+    *offset = end + padding;
+    return true;
+}
+
+bool MeshCache_Write(const char* obj_filename, const MeshGeometry& geometry)
+{
+    SourceInfo source;
+    if (!GetSourceInfo(obj_filename, &source, true))
+        return false;
+
+    MeshView view = MeshGeometry_View(geometry);
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESHCACHE_MAGIC, sizeof(MESHCACHE_MAGIC));
+    header.version      = MESHCACHE_VERSION;
+    header.header_size  = sizeof(MeshCacheHeader);
+    header.source_size  = source.size;
+    header.source_mtime = source.mtime;
+    header.source_hash  = source.hash;
+    header.num_shapes   = view.num_shapes;
+    header.num_vertices = view.num_vertices;
+    header.indices_size = view.indices_size;
+    header.vertex_size  = sizeof(PackedVertex);
+
+    size_t shapes_size    = view.num_shapes * sizeof(MeshShape);
+    size_t vertices_size  = geometry.vertices.size() * sizeof(PackedVertex);
+    size_t indices_size   = geometry.indices.size();
+
+    uint64_t offset = AlignUp(sizeof(MeshCacheHeader));
+    header.shapes_offset    = offset; offset = AlignUp(offset + shapes_size);
+    header.vertices_offset  = offset; offset = AlignUp(offset + vertices_size);
+    header.indices_offset   = offset; offset = AlignUp(offset + indices_size);
+    header.file_size        = offset;
+
+    // Escrevemos em um arquivo temporário e depois o renomeamos, para que uma
+    // execução interrompida nunca deixe um cache pela metade.
+    std::string path = CachePath(obj_filename);
+    std::string tmp_path = path + ".tmp";
+
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "WARNING: Cannot write mesh cache \"%s\".\n", path.c_str());
+        return false;
+    }
+
+    offset = 0;
+    bool ok = WriteBlock(f, &header, sizeof(header), &offset)
+           && WriteBlock(f, geometry.shapes.data(), shapes_size, &offset)
+           && WriteBlock(f, geometry.vertices.data(), vertices_size, &offset)
+           && WriteBlock(f, geometry.indices.data(), indices_size, &offset)
+           && offset == header.file_size;
+
+    ok = (fclose(f) == 0) && ok;
+
+    if (ok)
+    {
+        remove(path.c_str());
+        ok = rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+
+    if (!ok)
+    {
+        remove(tmp_path.c_str());
+        fprintf(stderr, "WARNING: Cannot write mesh cache \"%s\".\n", path.c_str());
+    }
+
+    return ok;
+}
@@ -0,0 +1,374 @@
+#include "../include/meshopt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t num_indices, size_t num_vertices,
+                                         unsigned int cache_size)
+{
+    VertexCacheStatistics stats;
+    memset(&stats, 0, sizeof(stats));
+
+    if (num_indices == 0 || num_vertices == 0)
+        return stats;
+
+    // Cada vértice guarda o "instante" em que entrou no cache. Em um cache
+    // FIFO, ele continua lá enquanto menos de "cache_size" outros vértices
+    // tiverem entrado depois dele.
+    std::vector<uint32_t> insertion_time(num_vertices, 0);
+    uint32_t time = cache_size + 1;
+
+    for (size_t i = 0; i < num_indices; ++i)
+    {
+        uint32_t v = indices[i];
+        if (time - insertion_time[v] > cache_size)
+        {
+            insertion_time[v] = time++;
+            stats.vertices_transformed += 1;
+        }
+    }
+
+    stats.acmr = (float)stats.vertices_transformed / (float)(num_indices / 3);
+    stats.atvr = (float)stats.vertices_transformed / (float)num_vertices;
+    return stats;
+}
+
+// Parâmetros do algoritmo de Forsyth, com os valores sugeridos no artigo.
+static const int   FORSYTH_CACHE_SIZE          = 32;
+static const float FORSYTH_CACHE_DECAY_POWER   = 1.5f;
+static const float FORSYTH_LAST_TRI_SCORE      = 0.75f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+static const int   FORSYTH_MAX_VALENCE_TABLE   = 32;
+
+struct ForsythScoreTable
+{
+    float cache[FORSYTH_CACHE_SIZE];
+    float valence[FORSYTH_MAX_VALENCE_TABLE];
+
+    ForsythScoreTable()
+    {
+        for (int i = 0; i < FORSYTH_CACHE_SIZE; ++i)
+        {
+            if (i < 3)
+            {
+                // Vértices do último triângulo emitido recebem um valor fixo,
+                // para não favorecer excessivamente tiras de triângulos.
+                cache[i] = FORSYTH_LAST_TRI_SCORE;
+            }
+            else
+            {
+                float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                cache[i] = powf(1.0f - (i - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+            }
+        }
+
+        valence[0] = 0.0f;
+        for (int i = 1; i < FORSYTH_MAX_VALENCE_TABLE; ++i)
+            valence[i] = FORSYTH_VALENCE_BOOST_SCALE * powf((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+    }
+
+    // Pontuação de um vértice dada sua posição no cache (-1 se fora dele) e o
+    // número de triângulos ainda não emitidos que o utilizam.
+    float VertexScore(int cache_position, uint32_t remaining_valence) const
+    {
+        if (remaining_valence == 0)
+            return -1.0f;
+
+        float score = (cache_position >= 0) ? cache[cache_position] : 0.0f;
+
+        if (remaining_valence < (uint32_t)FORSYTH_MAX_VALENCE_TABLE)
+            score += valence[remaining_valence];
+        else
+            score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remaining_valence, -FORSYTH_VALENCE_BOOST_POWER);
+
+        return score;
+    }
+};
+
+void OptimizeVertexCache(uint32_t* indices, size_t num_indices, size_t num_vertices)
+{
+    static const ForsythScoreTable table;
+
+    size_t num_triangles = num_indices / 3;
+    if (num_triangles == 0)
+        return;
+
+    // Listas de adjacência vértice -> triângulos, armazenadas de forma
+    // contígua. remaining_valence[v] é o tamanho atual da lista de v: os
+    // triângulos emitidos são movidos para o final dela.
+    std::vector<uint32_t> remaining_valence(num_vertices, 0);
+    for (size_t i = 0; i < num_indices; ++i)
+        remaining_valence[indices[i]] += 1;
+
+    std::vector<uint32_t> adjacency_offset(num_vertices + 1, 0);
+    for (size_t v = 0; v < num_vertices; ++v)
+        adjacency_offset[v + 1] = adjacency_offset[v] + remaining_valence[v];
+
+    std::vector<uint32_t> adjacency(num_indices);
+    std::vector<uint32_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+    for (size_t i = 0; i < num_indices; ++i)
+        adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+
+    std::vector<int>   cache_position(num_vertices, -1);
+    std::vector<float> vertex_score(num_vertices);
+    for (size_t v = 0; v < num_vertices; ++v)
+        vertex_score[v] = table.VertexScore(-1, remaining_valence[v]);
+
+    std::vector<float> triangle_score(num_triangles);
+    std::vector<char>  emitted(num_triangles, 0);
+
+    int best_triangle = -1;
+    float best_score = -1.0f;
+    for (size_t t = 0; t < num_triangles; ++t)
+    {
+        triangle_score[t] = vertex_score[indices[3*t + 0]] + vertex_score[indices[3*t + 1]] + vertex_score[indices[3*t + 2]];
+        if (triangle_score[t] > best_score)
+        {
+            best_score = triangle_score[t];
+            best_triangle = (int)t;
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(num_triangles * 3);
+
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    int cache_count = 0;
+    size_t input_cursor = 0;
+
+    while (best_triangle >= 0)
+    {
+        const uint32_t* triangle = &indices[3*best_triangle];
+        emitted[best_triangle] = 1;
+        output.push_back(triangle[0]);
+        output.push_back(triangle[1]);
+        output.push_back(triangle[2]);
+
+        // Removemos o triângulo emitido das listas de seus vértices.
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v = triangle[k];
+            uint32_t* list = &adjacency[adjacency_offset[v]];
+            uint32_t count = remaining_valence[v];
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (list[i] == (uint32_t)best_triangle)
+                {
+                    std::swap(list[i], list[count - 1]);
+                    remaining_valence[v] -= 1;
+                    break;
+                }
+            }
+        }
+
+        // Simulamos um cache LRU: os vértices do triângulo vão para o início
+        // e os demais são empurrados para trás.
+        uint32_t new_cache[FORSYTH_CACHE_SIZE + 3];
+        int new_count = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v = triangle[k];
+            if (std::find(new_cache, new_cache + new_count, v) == new_cache + new_count)
+                new_cache[new_count++] = v;
+        }
+        for (int i = 0; i < cache_count; ++i)
+        {
+            uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                new_cache[new_count++] = v;
+        }
+
+        for (int i = 0; i < new_count; ++i)
+        {
+            uint32_t v = new_cache[i];
+            cache_position[v] = (i < FORSYTH_CACHE_SIZE) ? i : -1;
+            vertex_score[v] = table.VertexScore(cache_position[v], remaining_valence[v]);
+        }
+
+        // Somente triângulos que usam vértices cujas pontuações mudaram
+        // precisam ser reavaliados; o melhor deles é o próximo a ser emitido.
+        best_triangle = -1;
+        best_score = -1.0f;
+        for (int i = 0; i < new_count; ++i)
+        {
+            uint32_t v = new_cache[i];
+            const uint32_t* list = &adjacency[adjacency_offset[v]];
+            for (uint32_t j = 0; j < remaining_valence[v]; ++j)
+            {
+                uint32_t t = list[j];
+                triangle_score[t] = vertex_score[indices[3*t + 0]] + vertex_score[indices[3*t + 1]] + vertex_score[indices[3*t + 2]];
+                if (triangle_score[t] > best_score)
+                {
+                    best_score = triangle_score[t];
+                    best_triangle = (int)t;
+                }
+            }
+        }
+
+        cache_count = std::min(new_count, FORSYTH_CACHE_SIZE);
+        memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+
+        // Nenhum triângulo vizinho ao cache: continuamos do próximo triângulo
+        // ainda não emitido, na ordem original.
+        if (best_triangle < 0)
+        {
+            while (input_cursor < num_triangles && emitted[input_cursor])
+                input_cursor += 1;
+
+            if (input_cursor < num_triangles)
+                best_triangle = (int)input_cursor;
+        }
+    }
+
+    memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+struct OverdrawCluster
+{
+    size_t first_triangle;
+    size_t num_triangles;
+    float  sort_key;
+};
+
+static bool CompareClusters(const OverdrawCluster& a, const OverdrawCluster& b)
+{
+    return a.sort_key > b.sort_key;
+}
+
+static const float* VertexPosition(const float* positions, size_t stride, uint32_t v)
+{
+    return (const float*)((const char*)positions + v * stride);
+}
+
+void OptimizeOverdraw(uint32_t* indices, size_t num_indices, const float* positions, size_t stride,
+                      size_t num_vertices)
+{
+    size_t num_triangles = num_indices / 3;
+    if (num_triangles == 0)
+        return;
+
+    // Delimitamos os grupos nos triângulos cujos três vértices não estariam
+    // no cache FIFO: trocar a ordem dos grupos não causa novos cache misses
+    // além dos que já existiam nestes pontos.
+    std::vector<OverdrawCluster> clusters;
+    std::vector<uint32_t> insertion_time(num_vertices, 0);
+    uint32_t time = MESHOPT_FIFO_CACHE_SIZE + 1;
+
+    for (size_t t = 0; t < num_triangles; ++t)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v = indices[3*t + k];
+            if (time - insertion_time[v] > MESHOPT_FIFO_CACHE_SIZE)
+            {
+                insertion_time[v] = time++;
+                misses += 1;
+            }
+        }
+
+        if (misses == 3 || clusters.empty())
+        {
+            OverdrawCluster cluster = { t, 0, 0.0f };
+            clusters.push_back(cluster);
+        }
+        clusters.back().num_triangles += 1;
+    }
+
+    if (clusters.size() < 2)
+        return;
+
+    // Centro do modelo, ponderado pela área dos triângulos.
+    double center[3] = { 0.0, 0.0, 0.0 };
+    double total_area = 0.0;
+
+    std::vector<float> normals(3 * num_triangles);
+    std::vector<float> centroids(3 * num_triangles);
+    std::vector<float> areas(num_triangles);
+
+    for (size_t t = 0; t < num_triangles; ++t)
+    {
+        const float* a = VertexPosition(positions, stride, indices[3*t + 0]);
+        const float* b = VertexPosition(positions, stride, indices[3*t + 1]);
+        const float* c = VertexPosition(positions, stride, indices[3*t + 2]);
+
+        float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float n[3]  = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+        float area  = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]) * 0.5f;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            normals[3*t + i]   = n[i]; // Não normalizada: já é ponderada pela área
+            centroids[3*t + i] = (a[i] + b[i] + c[i]) / 3.0f;
+            center[i] += centroids[3*t + i] * area;
+        }
+        areas[t] = area;
+        total_area += area;
+    }
+
+    if (total_area > 0.0)
+        for (int i = 0; i < 3; ++i)
+            center[i] /= total_area;
+
+    // Grupos voltados para fora (normal média apontando para longe do centro)
+    // tendem a ocultar os demais, então são desenhados primeiro.
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        OverdrawCluster& cluster = clusters[c];
+        float centroid[3] = { 0.0f, 0.0f, 0.0f };
+        float normal[3] = { 0.0f, 0.0f, 0.0f };
+        float area = 0.0f;
+
+        for (size_t t = cluster.first_triangle; t < cluster.first_triangle + cluster.num_triangles; ++t)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                centroid[i] += centroids[3*t + i] * areas[t];
+                normal[i] += normals[3*t + i];
+            }
+            area += areas[t];
+        }
+
+        float length = sqrtf(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+        if (area <= 0.0f || length <= 0.0f)
+            continue;
+
+        float key = 0.0f;
+        for (int i = 0; i < 3; ++i)
+            key += (centroid[i] / area - (float)center[i]) * (normal[i] / length);
+        cluster.sort_key = key;
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), CompareClusters);
+
+    std::vector<uint32_t> output;
+    output.reserve(num_indices);
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        const uint32_t* first = &indices[3*clusters[c].first_triangle];
+        output.insert(output.end(), first, first + 3*clusters[c].num_triangles);
+    }
+
+    memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+size_t OptimizeVertexFetchRemap(uint32_t* indices, size_t num_indices, size_t num_vertices,
+                                std::vector<uint32_t>* remap)
+{
+    remap->assign(num_vertices, ~0u);
+
+    uint32_t next_vertex = 0;
+    for (size_t i = 0; i < num_indices; ++i)
+    {
+        uint32_t& new_index = (*remap)[indices[i]];
+        if (new_index == ~0u)
+            new_index = next_vertex++;
+
+        indices[i] = new_index;
+    }
+
+    return next_vertex;
+}
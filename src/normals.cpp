@@ -0,0 +1,181 @@
+#include "../include/normals.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "../include/parallel.h"
+
+// Utilizamos instruções SSE quando o compilador as suporta (sempre o caso em
+// x86-64); caso contrário, as mesmas contas são feitas com floats.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+  #include <xmmintrin.h>
+  #define NORMALS_USE_SSE 1
+#else
+  #define NORMALS_USE_SSE 0
+#endif
+
+// Número mínimo de elementos processados por cada thread.
+#define NORMALS_MIN_CHUNK 4096
+
+// Normal (não normalizada, proporcional à área) de cada triângulo, com quatro
+// floats por triângulo para permitir leituras alinhadas a registradores SSE.
+static void ComputeFaceNormals(const float* positions, const int* corner_vertices,
+                               size_t begin, size_t end, float* face_normals)
+{
+    for (size_t triangle = begin; triangle < end; ++triangle)
+    {
+        const float* a = positions + 3*(size_t)corner_vertices[3*triangle + 0];
+        const float* b = positions + 3*(size_t)corner_vertices[3*triangle + 1];
+        const float* c = positions + 3*(size_t)corner_vertices[3*triangle + 2];
+        float* n = face_normals + 4*triangle;
+
+#if NORMALS_USE_SSE
+        __m128 va = _mm_set_ps(0.0f, a[2], a[1], a[0]);
+        __m128 u  = _mm_sub_ps(_mm_set_ps(0.0f, b[2], b[1], b[0]), va);
+        __m128 v  = _mm_sub_ps(_mm_set_ps(0.0f, c[2], c[1], c[0]), va);
+
+        // u x v = u.yzx * v.zxy - u.zxy * v.yzx
+        __m128 u_yzx = _mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 v_yzx = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 cross = _mm_sub_ps(_mm_mul_ps(u, v_yzx), _mm_mul_ps(u_yzx, v));
+        _mm_storeu_ps(n, _mm_shuffle_ps(cross, cross, _MM_SHUFFLE(3, 0, 2, 1)));
+#else
+        float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        n[0] = u[1]*v[2] - u[2]*v[1];
+        n[1] = u[2]*v[0] - u[0]*v[2];
+        n[2] = u[0]*v[1] - u[1]*v[0];
+        n[3] = 0.0f;
+#endif
+    }
+}
+
+// Soma as normais dos triângulos dos cantos [first, last) e escreve o
+// resultado normalizado em "out". Uma soma nula resulta em uma normal nula.
+static void AccumulateNormal(const uint32_t* first, const uint32_t* last, const float* face_normals, float* out)
+{
+#if NORMALS_USE_SSE
+    __m128 sum = _mm_setzero_ps();
+    for (const uint32_t* corner = first; corner != last; ++corner)
+        sum = _mm_add_ps(sum, _mm_loadu_ps(face_normals + 4*(*corner / 3)));
+
+    __m128 squared = _mm_mul_ps(sum, sum);
+    __m128 length2 = _mm_add_ss(_mm_add_ss(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 1, 1, 1))),
+                                _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 2, 2, 2)));
+    float length = _mm_cvtss_f32(_mm_sqrt_ss(length2));
+
+    float result[4];
+    _mm_storeu_ps(result, length > 0.0f ? _mm_div_ps(sum, _mm_set1_ps(length)) : _mm_setzero_ps());
+    out[0] = result[0];
+    out[1] = result[1];
+    out[2] = result[2];
+#else
+    float sum[3] = { 0.0f, 0.0f, 0.0f };
+    for (const uint32_t* corner = first; corner != last; ++corner)
+    {
+        const float* n = face_normals + 4*(*corner / 3);
+        sum[0] += n[0];
+        sum[1] += n[1];
+        sum[2] += n[2];
+    }
+
+    float length = std::sqrt(sum[0]*sum[0] + sum[1]*sum[1] + sum[2]*sum[2]);
+    float scale = length > 0.0f ? 1.0f / length : 0.0f;
+    out[0] = sum[0] * scale;
+    out[1] = sum[1] * scale;
+    out[2] = sum[2] * scale;
+#endif
+}
+
+void ComputeSmoothNormals(const float* positions, size_t num_positions,
+                          const int* corner_vertices, const unsigned int* triangle_sgroups, size_t num_triangles,
+                          std::vector<float>* normals, int* corner_normals)
+{
+    const size_t num_corners = 3*num_triangles;
+
+    // Passo 1: normais de todos os triângulos, em paralelo.
+    std::vector<float> face_normals(4*num_triangles);
+    ParallelFor(num_triangles, NORMALS_MIN_CHUNK, [&](size_t begin, size_t end) {
+        ComputeFaceNormals(positions, corner_vertices, begin, end, face_normals.data());
+    });
+
+    // Passo 2: agrupamos os cantos por vértice (counting sort). Os cantos de
+    // um vértice ficam em vertex_corners[vertex_offsets[v] .. vertex_offsets[v+1]).
+    std::vector<uint32_t> vertex_offsets(num_positions + 1, 0);
+    for (size_t corner = 0; corner < num_corners; ++corner)
+        vertex_offsets[corner_vertices[corner] + 1] += 1;
+    for (size_t vertex = 0; vertex < num_positions; ++vertex)
+        vertex_offsets[vertex + 1] += vertex_offsets[vertex];
+
+    std::vector<uint32_t> vertex_corners(num_corners);
+    {
+        std::vector<uint32_t> cursor(vertex_offsets.begin(), vertex_offsets.end() - 1);
+        for (size_t corner = 0; corner < num_corners; ++corner)
+            vertex_corners[cursor[corner_vertices[corner]]++] = (uint32_t)corner;
+    }
+
+    // Passo 3: dentro de cada vértice, ordenamos os cantos por smoothing group
+    // e contamos quantos grupos distintos existem (= normais deste vértice).
+    std::vector<uint32_t> normal_offsets(num_positions + 1, 0);
+    ParallelFor(num_positions, NORMALS_MIN_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; ++vertex)
+        {
+            uint32_t* first = vertex_corners.data() + vertex_offsets[vertex];
+            uint32_t* last  = vertex_corners.data() + vertex_offsets[vertex + 1];
+            if (first == last)
+                continue;
+
+            // Caso mais comum: um único grupo, nada a ordenar.
+            unsigned int sgroup = triangle_sgroups[*first / 3];
+            bool single_group = std::all_of(first, last, [&](uint32_t corner) {
+                return triangle_sgroups[corner / 3] == sgroup;
+            });
+
+            uint32_t num_groups = 1;
+            if (!single_group)
+            {
+                std::sort(first, last, [&](uint32_t a, uint32_t b) {
+                    unsigned int ga = triangle_sgroups[a / 3];
+                    unsigned int gb = triangle_sgroups[b / 3];
+                    return ga < gb || (ga == gb && a < b);
+                });
+                for (uint32_t* corner = first + 1; corner != last; ++corner)
+                    if (triangle_sgroups[*corner / 3] != triangle_sgroups[*(corner - 1) / 3])
+                        num_groups += 1;
+            }
+
+            normal_offsets[vertex + 1] = num_groups;
+        }
+    });
+    for (size_t vertex = 0; vertex < num_positions; ++vertex)
+        normal_offsets[vertex + 1] += normal_offsets[vertex];
+
+    // Passo 4: média das normais de cada grupo de cada vértice. Cada vértice
+    // escreve somente as suas normais e os seus cantos, sem conflitos entre threads.
+    normals->assign(3*(size_t)normal_offsets[num_positions], 0.0f);
+    float* out = normals->data();
+    ParallelFor(num_positions, NORMALS_MIN_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; ++vertex)
+        {
+            const uint32_t* first = vertex_corners.data() + vertex_offsets[vertex];
+            const uint32_t* last  = vertex_corners.data() + vertex_offsets[vertex + 1];
+            uint32_t normal_index = normal_offsets[vertex];
+
+            while (first != last)
+            {
+                unsigned int sgroup = triangle_sgroups[*first / 3];
+                const uint32_t* group_end = first;
+                while (group_end != last && triangle_sgroups[*group_end / 3] == sgroup)
+                    ++group_end;
+
+                AccumulateNormal(first, group_end, face_normals.data(), out + 3*(size_t)normal_index);
+                for (const uint32_t* corner = first; corner != group_end; ++corner)
+                    corner_normals[*corner] = (int)normal_index;
+
+                normal_index += 1;
+                first = group_end;
+            }
+        }
+    });
+}
@@ -0,0 +1,45 @@
+#include "../include/parallel.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+unsigned int Parallel_NumThreads()
+{
+    // hardware_concurrency() pode retornar 0 quando o valor é desconhecido.
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    return std::max(1u, num_threads);
+}
+
+void ParallelFor(size_t count, size_t min_chunk, const std::function<void(size_t begin, size_t end)>& function)
+{
+    if (count == 0)
+        return;
+
+    min_chunk = std::max((size_t)1, min_chunk);
+
+    size_t num_chunks = std::min((size_t)Parallel_NumThreads(), (count + min_chunk - 1) / min_chunk);
+    if (num_chunks <= 1)
+    {
+        function(0, count);
+        return;
+    }
+
+    size_t chunk_size = (count + num_chunks - 1) / num_chunks;
+    num_chunks = (count + chunk_size - 1) / chunk_size;
+
+    // O último bloco é processado pela thread atual enquanto as outras trabalham.
+    std::vector<std::thread> threads;
+    threads.reserve(num_chunks - 1);
+    for (size_t chunk = 0; chunk + 1 < num_chunks; ++chunk)
+    {
+        size_t begin = chunk * chunk_size;
+        size_t end = std::min(count, begin + chunk_size);
+        threads.emplace_back(function, begin, end);
+    }
+
+    function((num_chunks - 1) * chunk_size, count);
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
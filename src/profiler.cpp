@@ -0,0 +1,296 @@
+#include "../include/profiler.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include <glad/glad.h>
+
+// Máximo de ocorrências de seções guardadas por quadro; as demais só são
+// somadas no tempo total da seção.
+#define PROFILER_MAX_EVENTS_PER_FRAME 64
+
+// Número de queries da GPU em uso por seção. Os resultados de um quadro
+// ficam prontos alguns quadros depois; se a query mais antiga ainda não
+// terminou quando precisamos reutilizá-la, a seção não é medida na GPU
+// naquele quadro, em vez de esperarmos.
+#define PROFILER_GPU_QUERIES 4
+
+static const char* const SECTION_NAMES[PROFILE_NUM_SECTIONS] = {
+    "simulation",
+    "collision",
+    "scene draw",
+    "HUD text",
+    "swap",
+};
+
+// Seções medidas também na GPU. Queries GL_TIME_ELAPSED não podem ser
+// aninhadas, então somente seções que nunca se sobrepõem entram aqui.
+static const bool SECTION_GPU[PROFILE_NUM_SECTIONS] = {
+    false, false, true, true, false,
+};
+
+struct ProfileEvent
+{
+    ProfileSection section;
+    double         start_us;
+    double         duration_us;
+};
+
+struct ProfileFrame
+{
+    uint64_t     index;
+    double       start_us;
+    double       duration_us;
+    double       cpu_us[PROFILE_NUM_SECTIONS];
+    double       gpu_us[PROFILE_NUM_SECTIONS]; // Negativo: sem medida
+    ProfileEvent events[PROFILER_MAX_EVENTS_PER_FRAME];
+    int          num_events;
+};
+
+struct GpuQuery
+{
+    GLuint   id;
+    bool     pending;
+    uint64_t frame_index;
+};
+
+static ProfileFrame g_Frames[PROFILER_HISTORY_FRAMES];
+static uint64_t     g_FrameIndex = 0; // Quadro atual
+static uint64_t     g_NumFrames = 0;  // Quadros completos (até PROFILER_HISTORY_FRAMES no buffer)
+static double       g_SectionStart[PROFILE_NUM_SECTIONS];
+
+static GpuQuery     g_GpuQueries[PROFILE_NUM_SECTIONS][PROFILER_GPU_QUERIES];
+static int          g_GpuActiveSection = -1;
+static bool         g_GpuInitialized = false;
+
+static std::chrono::steady_clock::time_point g_StartTime = std::chrono::steady_clock::now();
+
+static double NowMicroseconds()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - g_StartTime).count();
+}
+
+static ProfileFrame& CurrentFrame()
+{
+    return g_Frames[g_FrameIndex % PROFILER_HISTORY_FRAMES];
+}
+
+void Profiler_Init()
+{
+    for (int section = 0; section < PROFILE_NUM_SECTIONS; ++section)
+    {
+        if (!SECTION_GPU[section])
+            continue;
+
+        for (int i = 0; i < PROFILER_GPU_QUERIES; ++i)
+        {
+            glGenQueries(1, &g_GpuQueries[section][i].id);
+            g_GpuQueries[section][i].pending = false;
+        }
+    }
+    g_GpuInitialized = true;
+}
+
+void Profiler_Shutdown()
+{
+    if (!g_GpuInitialized)
+        return;
+
+    for (int section = 0; section < PROFILE_NUM_SECTIONS; ++section)
+        for (int i = 0; i < PROFILER_GPU_QUERIES; ++i)
+            if (g_GpuQueries[section][i].id != 0)
+                glDeleteQueries(1, &g_GpuQueries[section][i].id);
+
+    g_GpuInitialized = false;
+}
+
+// Recolhe os resultados prontos, sem bloquear.
+static void CollectGpuQueries()
+{
+    for (int section = 0; section < PROFILE_NUM_SECTIONS; ++section)
+    {
+        for (int i = 0; i < PROFILER_GPU_QUERIES; ++i)
+        {
+            GpuQuery& query = g_GpuQueries[section][i];
+            if (!query.pending)
+                continue;
+
+            GLuint available = 0;
+            glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                continue;
+
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &nanoseconds);
+            query.pending = false;
+
+            // O quadro pode já ter saído do buffer circular.
+            ProfileFrame& frame = g_Frames[query.frame_index % PROFILER_HISTORY_FRAMES];
+            if (frame.index == query.frame_index)
+                frame.gpu_us[section] = (frame.gpu_us[section] < 0.0 ? 0.0 : frame.gpu_us[section]) + nanoseconds / 1000.0;
+        }
+    }
+}
+
+void Profiler_BeginFrame()
+{
+    if (g_GpuInitialized)
+        CollectGpuQueries();
+
+    ProfileFrame& frame = CurrentFrame();
+    frame.index = g_FrameIndex;
+    frame.start_us = NowMicroseconds();
+    frame.duration_us = 0.0;
+    frame.num_events = 0;
+    for (int section = 0; section < PROFILE_NUM_SECTIONS; ++section)
+    {
+        frame.cpu_us[section] = 0.0;
+        frame.gpu_us[section] = -1.0;
+    }
+}
+
+void Profiler_EndFrame()
+{
+    ProfileFrame& frame = CurrentFrame();
+    frame.duration_us = NowMicroseconds() - frame.start_us;
+
+    g_FrameIndex += 1;
+    g_NumFrames += 1;
+}
+
+void Profiler_Begin(ProfileSection section)
+{
+    g_SectionStart[section] = NowMicroseconds();
+
+    if (!g_GpuInitialized || !SECTION_GPU[section] || g_GpuActiveSection >= 0)
+        return;
+
+    GpuQuery& query = g_GpuQueries[section][g_FrameIndex % PROFILER_GPU_QUERIES];
+    if (query.pending)
+        return;
+
+    glBeginQuery(GL_TIME_ELAPSED, query.id);
+    query.pending = true;
+    query.frame_index = g_FrameIndex;
+    g_GpuActiveSection = section;
+}
+
+void Profiler_End(ProfileSection section)
+{
+    if (g_GpuActiveSection == (int)section)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        g_GpuActiveSection = -1;
+    }
+
+    double end = NowMicroseconds();
+    double duration = end - g_SectionStart[section];
+
+    ProfileFrame& frame = CurrentFrame();
+    frame.cpu_us[section] += duration;
+
+    if (frame.num_events < PROFILER_MAX_EVENTS_PER_FRAME)
+    {
+        ProfileEvent& event = frame.events[frame.num_events++];
+        event.section = section;
+        event.start_us = g_SectionStart[section];
+        event.duration_us = duration;
+    }
+}
+
+const char* Profiler_SectionName(ProfileSection section)
+{
+    return SECTION_NAMES[section];
+}
+
+// Intervalo de quadros completos presentes no buffer circular.
+static void HistoryRange(uint64_t* first, uint64_t* end)
+{
+    *end = g_FrameIndex;
+    *first = (g_NumFrames > PROFILER_HISTORY_FRAMES) ? g_FrameIndex - PROFILER_HISTORY_FRAMES : g_FrameIndex - g_NumFrames;
+}
+
+ProfileSummary Profiler_Summary()
+{
+    ProfileSummary summary;
+    uint32_t gpu_frames[PROFILE_NUM_SECTIONS];
+
+    summary.num_frames = 0;
+    summary.frame_ms = 0.0;
+    for (int section = 0; section < PROFILE_NUM_SECTIONS; ++section)
+    {
+        summary.cpu_ms[section] = 0.0;
+        summary.gpu_ms[section] = 0.0;
+        gpu_frames[section] = 0;
+    }
+
+    uint64_t first, end;
+    HistoryRange(&first, &end);
+    for (uint64_t index = first; index < end; ++index)
+    {
+        const ProfileFrame& frame = g_Frames[index % PROFILER_HISTORY_FRAMES];
+        summary.num_frames += 1;
+        summary.frame_ms += frame.duration_us / 1000.0;
+        for (int section = 0; section < PROFILE_NUM_SECTIONS; ++section)
+        {
+            summary.cpu_ms[section] += frame.cpu_us[section] / 1000.0;
+            if (frame.gpu_us[section] >= 0.0)
+            {
+                summary.gpu_ms[section] += frame.gpu_us[section] / 1000.0;
+                gpu_frames[section] += 1;
+            }
+        }
+    }
+
+    if (summary.num_frames > 0)
+    {
+        summary.frame_ms /= summary.num_frames;
+        for (int section = 0; section < PROFILE_NUM_SECTIONS; ++section)
+            summary.cpu_ms[section] /= summary.num_frames;
+    }
+
+    for (int section = 0; section < PROFILE_NUM_SECTIONS; ++section)
+        summary.gpu_ms[section] = gpu_frames[section] > 0 ? summary.gpu_ms[section] / gpu_frames[section] : -1.0;
+
+    return summary;
+}
+
+bool Profiler_WriteChromeTrace(const char* path)
+{
+    FILE* f = fopen(path, "w");
+    if (f == NULL)
+        return false;
+
+    // "tid" 1 é a thread principal (CPU) e "tid" 2 é a GPU.
+    fprintf(f, "{\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+
+    uint64_t first, end;
+    HistoryRange(&first, &end);
+    for (uint64_t index = first; index < end; ++index)
+    {
+        const ProfileFrame& frame = g_Frames[index % PROFILER_HISTORY_FRAMES];
+
+        fprintf(f, ",\n{\"name\":\"frame %llu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                (unsigned long long)frame.index, frame.start_us, frame.duration_us);
+
+        bool gpu_written[PROFILE_NUM_SECTIONS] = { false };
+        for (int i = 0; i < frame.num_events; ++i)
+        {
+            const ProfileEvent& event = frame.events[i];
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                    SECTION_NAMES[event.section], event.start_us, event.duration_us);
+
+            if (frame.gpu_us[event.section] >= 0.0 && !gpu_written[event.section])
+            {
+                fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+                        SECTION_NAMES[event.section], event.start_us, frame.gpu_us[event.section]);
+                gpu_written[event.section] = true;
+            }
+        }
+    }
+
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    return fclose(f) == 0;
+}
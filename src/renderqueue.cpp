@@ -0,0 +1,357 @@
+#include "../include/renderqueue.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../include/vertexformat.h"
+
+static std::vector<DrawItem> g_Items;
+static std::vector<InstanceData> g_Instances; // Instâncias de todos os itens instanciados do quadro
+static std::vector<uint32_t> g_Order; // Índices em g_Items, na ordem de desenho
+static RenderQueueStats      g_Stats;
+
+// Uniform Buffer com os dados do quadro (veja FrameUniforms), e uma cópia da
+// matriz "projection * view" para o cálculo de "model_view_projection".
+static GLuint    g_FrameUniformBufferId = 0;
+static glm::mat4 g_ViewProjection(1.0f);
+
+// Último valor enviado para cada parte do estado OpenGL durante o Flush().
+struct RenderStateCache
+{
+    const RenderProgram* program;
+    GLuint    vertex_array_object_id;
+    // Os valores dos uniforms abaixo valem para "program"? Uniforms são
+    // estado de cada programa, então todos são invalidados quando ele muda.
+    bool      texture_unit_valid;
+    bool      instanced_valid;
+    bool      model_valid;
+    bool      material_valid;
+    bool      render_as_black_valid;
+    GLint     texture_unit;
+    GLboolean instanced;
+    const Material* material;
+    GLboolean render_as_black;
+    glm::mat4 model;
+    float     line_width; // Negativo: desconhecido
+};
+
+// VBO de instâncias. Só cresce, de forma que os atributos por instância de
+// qualquer VAO sempre apontam para dentro do buffer.
+static GLuint g_InstanceBufferId = 0;
+static size_t g_InstanceBufferCapacity = 0; // Em número de instâncias
+
+static void UploadInstances()
+{
+    if (g_Instances.empty())
+        return;
+
+    if (g_InstanceBufferId == 0)
+        glGenBuffers(1, &g_InstanceBufferId);
+
+    glBindBuffer(GL_ARRAY_BUFFER, g_InstanceBufferId);
+
+    // "Orphaning": alocamos um novo bloco de memória a cada quadro, para que a
+    // CPU não espere a GPU terminar de ler as instâncias do quadro anterior.
+    g_InstanceBufferCapacity = std::max(g_InstanceBufferCapacity, g_Instances.size());
+    glBufferData(GL_ARRAY_BUFFER, g_InstanceBufferCapacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, g_Instances.size() * sizeof(InstanceData), g_Instances.data());
+}
+
+// Aponta os atributos por instância do VAO atualmente ligado para as
+// instâncias a partir de "first_instance". Sem glDrawElementsInstancedBaseInstance
+// (OpenGL 4.2), o deslocamento é dado pelo ponteiro dos atributos.
+static void BindInstanceAttributes(uint32_t first_instance)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, g_InstanceBufferId);
+
+    size_t base = first_instance * sizeof(InstanceData);
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        GLuint location = ATTRIB_INSTANCE_MODEL + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(base + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+
+    for (GLuint column = 0; column < 3; ++column)
+    {
+        GLuint location = ATTRIB_INSTANCE_NORMAL_MATRIX + column;
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(base + offsetof(InstanceData, normal_matrix) + column * sizeof(glm::vec3)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+}
+
+// Envia os parâmetros de um material para os uniforms que a permutação usa.
+static void SetMaterialUniforms(const RenderProgram& program, const Material& material)
+{
+    if (program.diffuse_uniform >= 0)
+    {
+        glUniform3fv(program.diffuse_uniform, 1, glm::value_ptr(material.diffuse));
+        g_Stats.uniform_writes += 1;
+    }
+    if (program.specular_uniform >= 0)
+    {
+        glUniform3fv(program.specular_uniform, 1, glm::value_ptr(material.specular));
+        g_Stats.uniform_writes += 1;
+    }
+    if (program.shininess_uniform >= 0)
+    {
+        glUniform1f(program.shininess_uniform, material.shininess);
+        g_Stats.uniform_writes += 1;
+    }
+    if (program.texture_scale_uniform >= 0)
+    {
+        glUniform1f(program.texture_scale_uniform, material.texture_scale);
+        g_Stats.uniform_writes += 1;
+    }
+}
+
+static bool IsLinePrimitive(GLenum mode)
+{
+    return mode == GL_LINES || mode == GL_LINE_STRIP || mode == GL_LINE_LOOP;
+}
+
+void RenderQueue_Begin()
+{
+    g_Items.clear();
+    g_Instances.clear();
+}
+
+void RenderQueue_SetFrameUniforms(const FrameUniforms& frame)
+{
+    if (g_FrameUniformBufferId == 0)
+    {
+        glGenBuffers(1, &g_FrameUniformBufferId);
+        glBindBuffer(GL_UNIFORM_BUFFER, g_FrameUniformBufferId);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_STREAM_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, g_FrameUniformBufferId);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, g_FrameUniformBufferId);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    g_ViewProjection = frame.view_projection;
+}
+
+void RenderQueue_BindFrameUniforms(GLuint program_id)
+{
+    GLuint block_index = glGetUniformBlockIndex(program_id, "FrameUniforms");
+    if (block_index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program_id, block_index, FRAME_UNIFORMS_BINDING);
+}
+
+void RenderQueue_Push(const DrawItem& item)
+{
+    g_Items.push_back(item);
+    g_Items.back().instance_count = 0;
+}
+
+void RenderQueue_PushInstanced(const DrawItem& item, const InstanceData* instances, size_t num_instances)
+{
+    if (num_instances == 0)
+        return;
+
+    g_Items.push_back(item);
+    g_Items.back().instance_count = (GLsizei)num_instances;
+    g_Items.back().first_instance = (uint32_t)g_Instances.size();
+
+    size_t first = g_Instances.size();
+    g_Instances.insert(g_Instances.end(), instances, instances + num_instances);
+
+    // A inversa é calculada aqui uma vez por cópia, e não pela GPU em cada vértice.
+    for (size_t i = first; i < g_Instances.size(); ++i)
+        g_Instances[i].normal_matrix = glm::inverseTranspose(glm::mat3(g_Instances[i].model));
+}
+
+const RenderQueueStats& RenderQueue_Stats()
+{
+    return g_Stats;
+}
+
+void RenderQueue_Flush()
+{
+    memset(&g_Stats, 0, sizeof(g_Stats));
+
+    // Ordenamos por programa, textura, VAO e material. A ordenação é estável:
+    // itens com o mesmo estado mantêm a ordem em que foram enviados (por
+    // exemplo, as arestas de um cubo depois das suas faces).
+    g_Order.resize(g_Items.size());
+    for (size_t i = 0; i < g_Order.size(); ++i)
+        g_Order[i] = (uint32_t)i;
+
+    std::stable_sort(g_Order.begin(), g_Order.end(), [](uint32_t a, uint32_t b) {
+        const DrawItem& x = g_Items[a];
+        const DrawItem& y = g_Items[b];
+        if (x.program->program_id != y.program->program_id)
+            return x.program->program_id < y.program->program_id;
+        if (x.material->texture_unit != y.material->texture_unit)
+            return x.material->texture_unit < y.material->texture_unit;
+        if (x.vertex_array_object_id != y.vertex_array_object_id)
+            return x.vertex_array_object_id < y.vertex_array_object_id;
+        return x.material < y.material;
+    });
+
+    UploadInstances();
+
+    RenderStateCache cache;
+    cache.program = NULL;
+    cache.vertex_array_object_id = 0;
+    cache.line_width = -1.0f;
+
+    bool first_item = true;
+
+    for (uint32_t index : g_Order)
+    {
+        const DrawItem& item = g_Items[index];
+
+        if (first_item || item.program != cache.program)
+        {
+            glUseProgram(item.program->program_id);
+            cache.program = item.program;
+            cache.texture_unit_valid = false;
+            cache.instanced_valid = false;
+            cache.model_valid = false;
+            cache.material_valid = false;
+            cache.render_as_black_valid = false;
+            g_Stats.program_binds += 1;
+        }
+        else
+        {
+            g_Stats.program_binds_skipped += 1;
+        }
+
+        if (first_item || item.vertex_array_object_id != cache.vertex_array_object_id)
+        {
+            glBindVertexArray(item.vertex_array_object_id);
+            cache.vertex_array_object_id = item.vertex_array_object_id;
+            g_Stats.vao_binds += 1;
+        }
+        else
+        {
+            g_Stats.vao_binds_skipped += 1;
+        }
+
+        const RenderProgram& program = *item.program;
+
+        // Só as permutações com textura têm o sampler "TextureImage".
+        if (program.texture_uniform >= 0)
+        {
+            if (!cache.texture_unit_valid || item.material->texture_unit != cache.texture_unit)
+            {
+                glUniform1i(program.texture_uniform, item.material->texture_unit);
+                cache.texture_unit = item.material->texture_unit;
+                cache.texture_unit_valid = true;
+                g_Stats.texture_binds += 1;
+            }
+            else
+            {
+                g_Stats.texture_binds_skipped += 1;
+            }
+        }
+        const GLboolean instanced = (item.instance_count > 0) ? GL_TRUE : GL_FALSE;
+
+        if (!cache.instanced_valid || instanced != cache.instanced)
+        {
+            glUniform1i(program.instanced_uniform, instanced);
+            cache.instanced = instanced;
+            cache.instanced_valid = true;
+            g_Stats.uniform_writes += 1;
+        }
+        else
+        {
+            g_Stats.uniform_writes_skipped += 1;
+        }
+
+        // Em desenhos instanciados, "model" e a matriz de normais vêm do VBO
+        // de instâncias e os uniforms não são utilizados pelo shader.
+        if (!instanced)
+        {
+            if (!cache.model_valid || memcmp(&item.model, &cache.model, sizeof(glm::mat4)) != 0)
+            {
+                glm::mat4 model_view_projection = g_ViewProjection * item.model;
+                glm::mat3 normal_matrix = glm::inverseTranspose(glm::mat3(item.model));
+                glUniformMatrix4fv(program.model_uniform, 1, GL_FALSE, glm::value_ptr(item.model));
+                glUniformMatrix4fv(program.model_view_projection_uniform, 1, GL_FALSE, glm::value_ptr(model_view_projection));
+                glUniformMatrix3fv(program.normal_matrix_uniform, 1, GL_FALSE, glm::value_ptr(normal_matrix));
+                cache.model = item.model;
+                cache.model_valid = true;
+                g_Stats.uniform_writes += 3;
+            }
+            else
+            {
+                g_Stats.uniform_writes_skipped += 1;
+            }
+        }
+
+        if (!cache.material_valid || item.material != cache.material)
+        {
+            SetMaterialUniforms(program, *item.material);
+            cache.material = item.material;
+            cache.material_valid = true;
+        }
+        else
+        {
+            g_Stats.uniform_writes_skipped += 1;
+        }
+
+        // Só a permutação MATERIAL_VERTEX_COLOR usa "render_as_black".
+        if (program.render_as_black_uniform >= 0)
+        {
+            if (!cache.render_as_black_valid || item.render_as_black != cache.render_as_black)
+            {
+                glUniform1i(program.render_as_black_uniform, item.render_as_black);
+                cache.render_as_black = item.render_as_black;
+                cache.render_as_black_valid = true;
+                g_Stats.uniform_writes += 1;
+            }
+            else
+            {
+                g_Stats.uniform_writes_skipped += 1;
+            }
+        }
+
+        if (IsLinePrimitive(item.rendering_mode))
+        {
+            if (item.line_width != cache.line_width)
+            {
+                glLineWidth(item.line_width);
+                cache.line_width = item.line_width;
+                g_Stats.line_width_changes += 1;
+            }
+            else
+            {
+                g_Stats.line_width_changes_skipped += 1;
+            }
+        }
+
+        if (instanced)
+        {
+            BindInstanceAttributes(item.first_instance);
+            glDrawElementsInstancedBaseVertex(item.rendering_mode, item.num_indices, item.index_type,
+                                              (void*)item.index_offset, item.instance_count, item.base_vertex);
+            g_Stats.instanced_draw_calls += 1;
+            g_Stats.instances += item.instance_count;
+        }
+        else
+        {
+            glDrawElementsBaseVertex(item.rendering_mode, item.num_indices, item.index_type,
+                                     (void*)item.index_offset, item.base_vertex);
+        }
+        g_Stats.draw_calls += 1;
+
+        first_item = false;
+    }
+
+    // "Desligamos" o VAO uma única vez, evitando assim que operações
+    // posteriores venham a alterar o mesmo.
+    glBindVertexArray(0);
+}
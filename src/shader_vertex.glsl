@@ -1,16 +1,36 @@
 #version 330 core
 
 // ENTRADAS
-layout (location = 0) in vec4 model_coefficients;
-layout (location = 1) in vec4 color_in;
-layout (location = 2) in vec2 texture_coefficients;
-layout (location = 3) in vec4 normal_coefficients;
+// Os locais ATTRIB_* são definidos pelo programa (veja include/vertexformat.h).
+// Atributos com menos componentes na memória (posição vec3, normal compactada)
+// são completados pela GPU: W=1 para a posição.
+layout (location = ATTRIB_POSITION) in vec4 model_coefficients;
+layout (location = ATTRIB_COLOR) in vec4 color_in;
+layout (location = ATTRIB_TEXCOORD) in vec2 texture_coefficients;
+layout (location = ATTRIB_NORMAL) in vec4 normal_coefficients;
+
+// Atributos por instância, utilizados quando "instanced" é verdadeiro no
+// lugar das variáveis "model" e "normal_matrix" (veja include/renderqueue.h).
+layout (location = ATTRIB_INSTANCE_MODEL) in mat4 instance_model;
+layout (location = ATTRIB_INSTANCE_NORMAL_MATRIX) in mat3 instance_normal_matrix;
 
 // UNIFORMS
+// Dados do quadro, compartilhados por todos os programas através de um
+// Uniform Buffer (veja FrameUniforms em include/renderqueue.h).
+layout (std140) uniform FrameUniforms
+{
+    mat4 view_projection;   // projection * view
+    vec4 camera_position;   // Coordenadas do mundo; a luz fica na câmera
+    vec4 light_intensity;   // Espectro da fonte de iluminação (rgb)
+    vec4 ambient_intensity; // Espectro da luz ambiente (rgb)
+};
+
+// Matrizes do objeto, calculadas na CPU uma vez por objeto
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat4 model_view_projection; // projection * view * model
+uniform mat3 normal_matrix;         // inverse(transpose(model))
 uniform bool render_as_black;
+uniform bool instanced;
 
 // SAÍDAS
 out vec4 position_world;
@@ -19,21 +39,25 @@ out vec4 vertex_color;
 out vec2 v_TexCoords; // Adicionado para passar UVs
 flat out int v_render_as_black_int;
 
-uniform sampler2D TextureImage0;
-uniform sampler2D TextureImage1;
-uniform sampler2D TextureImage2;
-
 void main()
 {
-    // Posição final em Coordenadas de Recorte
-    gl_Position = projection * view * model * model_coefficients;
+    if (instanced)
+    {
+        // Posição em Coordenadas do Mundo
+        position_world = instance_model * model_coefficients;
 
-    // Posição em Coordenadas do Mundo
-    position_world = model * model_coefficients;
+        // Posição final em Coordenadas de Recorte
+        gl_Position = view_projection * position_world;
 
-    // Normal em Coordenadas do Mundo (usa a entrada da location = 3)
-    normal = inverse(transpose(model)) * normal_coefficients;
-    normal.w = 0.0;
+        // Normal em Coordenadas do Mundo (usa a entrada da location = 3)
+        normal = vec4(instance_normal_matrix * normal_coefficients.xyz, 0.0);
+    }
+    else
+    {
+        position_world = model * model_coefficients;
+        gl_Position = model_view_projection * model_coefficients;
+        normal = vec4(normal_matrix * normal_coefficients.xyz, 0.0);
+    }
 
     // Passa os atributos do robô para o fragment shader
     vertex_color = color_in; // Passa a cor da location = 1
@@ -0,0 +1,322 @@
+#include "../include/shadercache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Enumerações e funções de ARB_get_program_binary (OpenGL 4.1) e de
+// KHR_parallel_shader_compile, que não estão em glad.h (OpenGL 3.3).
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+#define GL_COMPLETION_STATUS_KHR           0x91B1
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+static PFNGLGETPROGRAMBINARYPROC  g_GetProgramBinary  = NULL;
+static PFNGLPROGRAMBINARYPROC     g_ProgramBinary     = NULL;
+static PFNGLPROGRAMPARAMETERIPROC g_ProgramParameteri = NULL;
+
+static bool     g_ProgramBinarySupported = false;
+static bool     g_ParallelCompileSupported = false;
+static uint64_t g_DriverHash = 0;
+
+bool HasOpenGLExtension(const char* name); // Função definida em main.cpp
+
+// Incremente sempre que o formato do arquivo mudar.
+#define SHADERCACHE_VERSION 1
+
+static const char SHADERCACHE_MAGIC[8] = { 'F', 'C', 'G', 'P', 'R', 'O', 'G', '\0' };
+
+// Cabeçalho do arquivo de cache, seguido por "binary_size" bytes retornados
+// por glGetProgramBinary().
+struct ProgramCacheHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t key;
+    uint32_t binary_format;
+    uint32_t binary_size;
+};
+
+// Hash FNV-1a de 64 bits, acumulado a partir de "h".
+static uint64_t HashBytes(uint64_t h, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t HashString(uint64_t h, const char* string)
+{
+    // Incluímos o '\0' para que "ab" + "c" e "a" + "bc" sejam diferentes.
+    return HashBytes(h, string != NULL ? string : "", string != NULL ? strlen(string) + 1 : 1);
+}
+
+static std::string CachePath(const std::string& name)
+{
+    return name + ".progcache";
+}
+
+void ShaderCache_Init(GLADloadproc load)
+{
+    bool has_program_binary = (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 1))
+                           || HasOpenGLExtension("GL_ARB_get_program_binary");
+    if (has_program_binary)
+    {
+        g_GetProgramBinary  = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+        g_ProgramBinary     = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+        g_ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+
+        // Alguns drivers anunciam a extensão mas não aceitam nenhum formato.
+        GLint num_formats = 0;
+        if (g_GetProgramBinary != NULL && g_ProgramBinary != NULL && g_ProgramParameteri != NULL)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+        g_ProgramBinarySupported = num_formats > 0;
+    }
+
+    // Pedimos ao driver o máximo de threads de compilação que ele permitir.
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC max_threads = NULL;
+    if (HasOpenGLExtension("GL_KHR_parallel_shader_compile"))
+        max_threads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+    else if (HasOpenGLExtension("GL_ARB_parallel_shader_compile"))
+        max_threads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+    if (max_threads != NULL)
+    {
+        max_threads(0xFFFFFFFFu);
+        g_ParallelCompileSupported = true;
+    }
+
+    // Um programa compilado só vale para o mesmo driver e a mesma GPU.
+    uint64_t h = 14695981039346656037ULL;
+    h = HashString(h, (const char*)glGetString(GL_VENDOR));
+    h = HashString(h, (const char*)glGetString(GL_RENDERER));
+    h = HashString(h, (const char*)glGetString(GL_VERSION));
+    g_DriverHash = h;
+
+    printf("Shaders: program binary cache %s, parallel compilation %s.\n",
+           g_ProgramBinarySupported ? "enabled" : "not supported",
+           g_ParallelCompileSupported ? "enabled" : "not supported");
+}
+
+// Tenta carregar o programa do arquivo de cache. Retorna false se o arquivo
+// não existe, é de outro código fonte ou de outro driver, ou se o driver
+// recusou o binário.
+static bool LoadProgramBinary(PendingProgram* program)
+{
+    if (!g_ProgramBinarySupported)
+        return false;
+
+    std::string path = CachePath(program->name);
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == NULL)
+        return false;
+
+    ProgramCacheHeader header;
+    bool valid = fread(&header, sizeof(header), 1, f) == 1
+              && memcmp(header.magic, SHADERCACHE_MAGIC, sizeof(SHADERCACHE_MAGIC)) == 0
+              && header.version == SHADERCACHE_VERSION
+              && header.header_size == sizeof(ProgramCacheHeader)
+              && header.key == program->key
+              && header.binary_size > 0;
+
+    std::vector<char> binary;
+    if (valid)
+    {
+        binary.resize(header.binary_size);
+        valid = fread(binary.data(), binary.size(), 1, f) == 1;
+    }
+    fclose(f);
+
+    if (!valid)
+        return false;
+
+    GLuint program_id = glCreateProgram();
+    g_ProgramBinary(program_id, header.binary_format, binary.data(), (GLsizei)binary.size());
+
+    // Diferente de glLinkProgram(), o resultado de glProgramBinary() é
+    // conhecido imediatamente; um driver atualizado pode recusar o binário.
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE)
+    {
+        glDeleteProgram(program_id);
+        return false;
+    }
+
+    program->program_id = program_id;
+    return true;
+}
+
+static void SaveProgramBinary(const PendingProgram& program)
+{
+    GLint length = 0;
+    glGetProgramiv(program.program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary((size_t)length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    g_GetProgramBinary(program.program_id, length, &written, &format, binary.data());
+    if (written <= 0)
+        return;
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SHADERCACHE_MAGIC, sizeof(SHADERCACHE_MAGIC));
+    header.version       = SHADERCACHE_VERSION;
+    header.header_size   = sizeof(ProgramCacheHeader);
+    header.key           = program.key;
+    header.binary_format = format;
+    header.binary_size   = (uint32_t)written;
+
+    // Escrevemos em um arquivo temporário e depois o renomeamos, para que uma
+    // execução interrompida nunca deixe um cache pela metade.
+    std::string path = CachePath(program.name);
+    std::string tmp_path = path + ".tmp";
+
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    bool ok = f != NULL
+           && fwrite(&header, sizeof(header), 1, f) == 1
+           && fwrite(binary.data(), (size_t)written, 1, f) == 1;
+    if (f != NULL)
+        ok = (fclose(f) == 0) && ok;
+
+    if (ok)
+    {
+        remove(path.c_str());
+        ok = rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+
+    if (!ok)
+    {
+        remove(tmp_path.c_str());
+        fprintf(stderr, "WARNING: Cannot write shader cache \"%s\".\n", path.c_str());
+    }
+}
+
+static GLuint StartShaderCompilation(GLenum type, const std::string& source)
+{
+    GLuint shader_id = glCreateShader(type);
+    const GLchar* shader_string = source.c_str();
+    const GLint   shader_string_length = (GLint)source.length();
+    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
+    glCompileShader(shader_id);
+    return shader_id;
+}
+
+void ShaderCache_BeginProgram(PendingProgram* program, const char* name,
+                              const std::string& vertex_source, const std::string& fragment_source)
+{
+    uint64_t key = g_DriverHash;
+    key = HashString(key, vertex_source.c_str());
+    key = HashString(key, fragment_source.c_str());
+
+    program->name               = name;
+    program->program_id         = 0;
+    program->vertex_shader_id   = 0;
+    program->fragment_shader_id = 0;
+    program->key                = key;
+    program->finished           = false;
+    program->linked             = false;
+    program->from_cache         = LoadProgramBinary(program);
+
+    if (program->from_cache)
+    {
+        program->finished = true;
+        program->linked = true;
+        return;
+    }
+
+    program->vertex_shader_id   = StartShaderCompilation(GL_VERTEX_SHADER, vertex_source);
+    program->fragment_shader_id = StartShaderCompilation(GL_FRAGMENT_SHADER, fragment_source);
+
+    program->program_id = glCreateProgram();
+    glAttachShader(program->program_id, program->vertex_shader_id);
+    glAttachShader(program->program_id, program->fragment_shader_id);
+    if (g_ProgramBinarySupported)
+        g_ProgramParameteri(program->program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program->program_id);
+}
+
+bool ShaderCache_IsProgramReady(const PendingProgram& program)
+{
+    if (program.finished)
+        return true;
+    if (!g_ParallelCompileSupported)
+        return false;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(program.program_id, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed != GL_FALSE;
+}
+
+// Imprime no terminal qualquer erro ou "warning" de compilação de um shader.
+static void PrintShaderLog(const PendingProgram& program, GLuint shader_id, const char* stage)
+{
+    GLint compiled_ok = GL_FALSE;
+    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
+
+    GLint log_length = 0;
+    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
+    if (log_length <= 1)
+        return;
+
+    std::vector<GLchar> log((size_t)log_length);
+    glGetShaderInfoLog(shader_id, log_length, NULL, log.data());
+
+    fprintf(stderr, "%s: OpenGL compilation of \"%s\" (%s shader)%s\n"
+                    "== Start of compilation log\n%s== End of compilation log\n",
+            compiled_ok ? "WARNING" : "ERROR", program.name.c_str(), stage,
+            compiled_ok ? "." : " failed.", log.data());
+}
+
+bool ShaderCache_FinishProgram(PendingProgram* program)
+{
+    if (program->finished)
+        return program->linked;
+
+    // Aqui esperamos pelo driver, se ele ainda não terminou.
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(program->program_id, GL_LINK_STATUS, &linked_ok);
+
+    PrintShaderLog(*program, program->vertex_shader_id, "vertex");
+    PrintShaderLog(*program, program->fragment_shader_id, "fragment");
+
+    if (linked_ok == GL_FALSE)
+    {
+        GLint log_length = 0;
+        glGetProgramiv(program->program_id, GL_INFO_LOG_LENGTH, &log_length);
+        std::vector<GLchar> log((size_t)log_length + 1, '\0');
+        glGetProgramInfoLog(program->program_id, log_length, NULL, log.data());
+
+        fprintf(stderr, "ERROR: OpenGL linking of program \"%s\" failed.\n"
+                        "== Start of link log\n%s\n== End of link log\n",
+                program->name.c_str(), log.data());
+    }
+    else if (g_ProgramBinarySupported)
+    {
+        SaveProgramBinary(*program);
+    }
+
+    // Os shaders não são mais necessários depois da linkagem.
+    glDetachShader(program->program_id, program->vertex_shader_id);
+    glDetachShader(program->program_id, program->fragment_shader_id);
+    glDeleteShader(program->vertex_shader_id);
+    glDeleteShader(program->fragment_shader_id);
+    program->vertex_shader_id = 0;
+    program->fragment_shader_id = 0;
+
+    program->finished = true;
+    program->linked = linked_ok != GL_FALSE;
+    return program->linked;
+}
@@ -1,6 +1,8 @@
 // Based on http://hamelot.io/visualization/opengl-text-without-any-external-libraries/
 //   and on https://github.com/rougier/freetype-gl
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -10,8 +12,7 @@
 
 #include "utils.h"
 #include "dejavufont.h"
-
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+#include "shadercache.h"
 
 const GLchar* const textvertexshader_source = ""
 "#version 330\n"
@@ -35,58 +36,43 @@ const GLchar* const textfragmentshader_source = ""
 "}\n"
 "\0";
 
-void TextRendering_LoadShader(const GLchar* const shader_string, GLuint shader_id)
-{
-  // Define o código do shader, contido na string "shader_string"
-  glShaderSource(shader_id, 1, &shader_string, NULL);
+GLuint textVAO;
+GLuint textVBO;
+GLuint textprogram_id;
+GLuint texttexture_id;
 
-  // Compila o código do shader (em tempo de execução)
-  glCompileShader(shader_id);
+// O programa de texto é compilado em segundo plano e só é consultado no
+// primeiro TextRendering_Flush() (veja shadercache.h).
+static PendingProgram g_TextProgram;
+static bool g_TextProgramReady = false;
+static const GLuint TEXT_TEXTURE_UNIT = 31;
 
-  // Verificamos se ocorreu algum erro ou "warning" durante a compilação
-  GLint compiled_ok;
-  glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
+// Tabela codepoint -> glifo, construída em TextRendering_Init(). A fonte só
+// contém caracteres ASCII, então uma tabela direta de 256 entradas basta.
+static texture_glyph_t* g_GlyphTable[256];
 
-  GLint log_length = 0;
-  glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
+// Vértices (x, y, s, t) de todos os glifos impressos no quadro atual. São
+// enviados para a GPU e desenhados de uma só vez por TextRendering_Flush().
+struct TextVertex { float x, y, s, t; };
+static std::vector<TextVertex> g_TextVertices;
+static size_t g_TextBufferCapacity = 0; // Em número de vértices
 
-  // Alocamos memória para guardar o log de compilação.
-  // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-  GLchar* log = new GLchar[log_length];
-  glGetShaderInfoLog(shader_id, log_length, &log_length, log);
+// Tamanho da janela, consultado uma vez por quadro (no primeiro texto impresso).
+static int g_TextWindowWidth = 1;
+static int g_TextWindowHeight = 1;
+static bool g_TextWindowSizeValid = false;
 
-  // Imprime no terminal qualquer erro ou "warning" de compilação
-  if ( log_length != 0 )
-  {
-    std::string  output;
-
-    if ( !compiled_ok )
-    {
-      output += "ERROR: OpenGL compilation failed.\n";
-      output += "== Start of compilation log\n";
-      output += log;
-      output += "== End of compilation log\n";
-    }
-    else
-    {
-      output += "ERROR: OpenGL compilation failed.\n";
-      output += "== Start of compilation log\n";
-      output += log;
-      output += "== End of compilation log\n";
-    }
-
-    fprintf(stderr, "%s", output.c_str());
-  }
+static void UpdateWindowSize(GLFWwindow* window)
+{
+  if (g_TextWindowSizeValid)
+    return;
 
-  // A chamada "delete" em C++ é equivalente ao "free()" do C
-  delete [] log;
+  glfwGetWindowSize(window, &g_TextWindowWidth, &g_TextWindowHeight);
+  g_TextWindowWidth = std::max(g_TextWindowWidth, 1);
+  g_TextWindowHeight = std::max(g_TextWindowHeight, 1);
+  g_TextWindowSizeValid = true;
 }
 
-GLuint textVAO;
-GLuint textVBO;
-GLuint textprogram_id;
-GLuint texttexture_id;
-
 void TextRendering_Init()
 {
   GLuint sampler;
@@ -101,23 +87,11 @@ void TextRendering_Init()
   glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glCheckError();
 
-  GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
-  TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
-  glCheckError();
-
-  GLuint textfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
-  TextRendering_LoadShader(textfragmentshader_source, textfragmentshader_id);
-  glCheckError();
-
-  textprogram_id = CreateGpuProgram(textvertexshader_id, textfragmentshader_id);
-  glLinkProgram(textprogram_id);
-  glCheckError();
-
-  GLuint texttex_uniform;
-  texttex_uniform = glGetUniformLocation(textprogram_id, "tex");
+  ShaderCache_BeginProgram(&g_TextProgram, "text", textvertexshader_source, textfragmentshader_source);
+  textprogram_id = g_TextProgram.program_id;
   glCheckError();
 
-  GLuint textureunit = 31;
+  GLuint textureunit = TEXT_TEXTURE_UNIT;
   glActiveTexture(GL_TEXTURE0 + textureunit);
   glBindTexture(GL_TEXTURE_2D, texttexture_id);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, dejavufont.tex_width, dejavufont.tex_height, 0, GL_RED, GL_UNSIGNED_BYTE, dejavufont.tex_data);
@@ -127,43 +101,40 @@ void TextRendering_Init()
   glBindVertexArray(textVAO);
 
   glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-  glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
   glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
   glEnableVertexAttribArray(0);
   glCheckError();
 
-  glUseProgram(textprogram_id);
-  glUniform1i(texttex_uniform, textureunit);
-  glUseProgram(0);
-  glCheckError();
-
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
   glCheckError();
+
+  for (size_t i = 0; i < dejavufont.glyphs_count; ++i)
+  {
+    uint32_t codepoint = dejavufont.glyphs[i].codepoint;
+    if (codepoint < 256 && g_GlyphTable[codepoint] == NULL)
+      g_GlyphTable[codepoint] = &dejavufont.glyphs[i];
+  }
 }
 
 float textscale = 3.5f;
 
+// Não desenha nada: os glifos são acumulados e desenhados por TextRendering_Flush().
 void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
 {
+  UpdateWindowSize(window);
+
   scale *= textscale;
-  int width, height;
-  glfwGetWindowSize(window, &width, &height);
-  float sx = scale / width;
-  float sy = scale / height;
+  float sx = scale / g_TextWindowWidth;
+  float sy = scale / g_TextWindowHeight;
+
+  const float ds = 0.5f/dejavufont.tex_width;
+  const float dt = 0.5f/dejavufont.tex_height;
 
   for (size_t i = 0; i < str.size(); i++)
   {
-    // Find the glyph for the character we are looking for
-    texture_glyph_t *glyph = 0;
-    for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
-    {
-      if (dejavufont.glyphs[j].codepoint == (uint32_t)str[i])
-      {
-        glyph = &dejavufont.glyphs[j];
-        break;
-      }
-    }
+    texture_glyph_t *glyph = g_GlyphTable[(unsigned char)str[i]];
     if (!glyph) {
       continue;
     }
@@ -173,12 +144,12 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
     float x1 = (float) (x0 + glyph->width * sx);
     float y1 = (float) (y0 - glyph->height * sy);
 
-    float s0 = glyph->s0 - 0.5f/dejavufont.tex_width;
-    float t0 = glyph->t0 - 0.5f/dejavufont.tex_height;
-    float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
-    float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
+    float s0 = glyph->s0 - ds;
+    float t0 = glyph->t0 - dt;
+    float s1 = glyph->s1 - ds;
+    float t1 = glyph->t1 - dt;
 
-    struct {float x, y, s, t;} data[6] = {
+    TextVertex data[6] = {
       { x0, y0, s0, t0 },
       { x0, y1, s0, t1 },
       { x1, y1, s1, t1 },
@@ -186,43 +157,75 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
       { x1, y1, s1, t1 },
       { x1, y0, s1, t0 }
     };
+    g_TextVertices.insert(g_TextVertices.end(), data, data + 6);
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    x += (glyph->advance_x * sx);
+  }
+}
 
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glDepthFunc(GL_ALWAYS);
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+// Desenha, com uma única chamada OpenGL, todo o texto impresso desde a
+// última chamada. Deve ser chamada uma vez por quadro, antes de glfwSwapBuffers().
+void TextRendering_Flush()
+{
+  // O tamanho da janela pode mudar até o próximo quadro.
+  g_TextWindowSizeValid = false;
 
-    glUseProgram(textprogram_id);
-    glBindVertexArray(textVAO);
+  if (g_TextVertices.empty())
+    return;
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+  if (!g_TextProgramReady)
+  {
+    ShaderCache_FinishProgram(&g_TextProgram);
 
-    glBindVertexArray(0);
+    GLint texttex_uniform = glGetUniformLocation(textprogram_id, "tex");
+    glUseProgram(textprogram_id);
+    glUniform1i(texttex_uniform, TEXT_TEXTURE_UNIT);
     glUseProgram(0);
-    glDepthFunc(GL_LESS);
+    glCheckError();
 
-    glDisable(GL_BLEND);
-
-    x += (glyph->advance_x * sx);
+    g_TextProgramReady = true;
   }
+
+  glBindBuffer(GL_ARRAY_BUFFER, textVBO);
+
+  // "Orphaning": alocamos um novo bloco de memória a cada quadro, para que a
+  // CPU não espere a GPU terminar de ler o texto do quadro anterior. O
+  // tamanho só cresce, acompanhando o quadro com mais texto.
+  g_TextBufferCapacity = std::max(g_TextBufferCapacity, g_TextVertices.size());
+  glBufferData(GL_ARRAY_BUFFER, g_TextBufferCapacity * sizeof(TextVertex), NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, g_TextVertices.size() * sizeof(TextVertex), g_TextVertices.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glDepthFunc(GL_ALWAYS);
+
+  glUseProgram(textprogram_id);
+  glBindVertexArray(textVAO);
+
+  glDrawArrays(GL_TRIANGLES, 0, (GLsizei)g_TextVertices.size());
+
+  glBindVertexArray(0);
+  glUseProgram(0);
+  glDepthFunc(GL_LESS);
+
+  glDisable(GL_BLEND);
+
+  g_TextVertices.clear();
 }
 
 float TextRendering_LineHeight(GLFWwindow* window)
 {
-  int width, height;
-  glfwGetWindowSize(window, &width, &height);
-  return dejavufont.height / height * textscale;
+  UpdateWindowSize(window);
+  return dejavufont.height / g_TextWindowHeight * textscale;
 }
 
 float TextRendering_CharWidth(GLFWwindow* window)
 {
-  int width, height;
-  glfwGetWindowSize(window, &width, &height);
-  return dejavufont.glyphs[32].advance_x / width * textscale;
+  UpdateWindowSize(window);
+  return dejavufont.glyphs[32].advance_x / g_TextWindowWidth * textscale;
 }
 
 void TextRendering_PrintMatrix(GLFWwindow* window, glm::mat4 M, float x, float y, float scale = 1.0f)
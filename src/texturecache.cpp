@@ -0,0 +1,549 @@
+#include "../include/texturecache.h"
+#include "../include/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+
+// Incremente sempre que o formato do arquivo ou a compressão mudarem, para
+// que caches antigos sejam descartados e escritos novamente.
+#define TEXTURECACHE_VERSION 1
+
+static const char TEXTURECACHE_MAGIC[8] = { 'F', 'C', 'G', 'T', 'E', 'X', 'C', '\0' };
+
+// Cabeçalho no início do arquivo de cache, seguido pelos blocos de todos os
+// níveis de mipmap. Os campos "source_*" identificam a versão da imagem a
+// partir da qual o cache foi gerado.
+struct TextureCacheHeader
+{
+    char               magic[8];
+    uint32_t           version;
+    uint32_t           header_size;
+    uint64_t           source_size;
+    int64_t            source_mtime;
+    uint64_t           source_hash;
+    uint32_t           format;
+    uint32_t           width;
+    uint32_t           height;
+    uint32_t           num_levels;
+    CompressedMipLevel levels[TEXTURECACHE_MAX_LEVELS];
+    uint64_t           data_size;
+};
+
+struct SourceInfo
+{
+    uint64_t size;
+    int64_t  mtime;
+    uint64_t hash;
+};
+
+static std::string CachePath(const char* image_filename)
+{
+    return std::string(image_filename) + ".texcache";
+}
+
+// Hash FNV-1a de 64 bits do conteúdo do arquivo (o mesmo do cache de
+// malhas, veja meshcache.cpp).
+static bool HashFile(const char* filename, uint64_t* hash)
+{
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL)
+        return false;
+
+    uint64_t h = 14695981039346656037ULL;
+    unsigned char buffer[64*1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            h ^= buffer[i];
+            h *= 1099511628211ULL;
+        }
+    }
+
+    fclose(f);
+    *hash = h;
+    return true;
+}
+
+static bool GetSourceInfo(const char* image_filename, SourceInfo* info, bool compute_hash)
+{
+    struct stat st;
+    if (stat(image_filename, &st) != 0)
+        return false;
+
+    info->size  = (uint64_t)st.st_size;
+    info->mtime = (int64_t)st.st_mtime;
+    info->hash  = 0;
+
+    if (compute_hash)
+        return HashFile(image_filename, &info->hash);
+
+    return true;
+}
+
+// Tamanho em bytes de um nível BC1 com "width" x "height" pixels. Blocos
+// incompletos nas bordas ocupam um bloco inteiro.
+static uint32_t BC1LevelSize(uint32_t width, uint32_t height)
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) * TEXTURECACHE_BC1_BLOCK_SIZE;
+}
+
+// ---------------------------------------------------------------------------
+// Compressão BC1
+//
+// Cada bloco guarda duas cores de 16 bits (R5 G6 B5) e, para cada um dos 16
+// pixels, um índice de 2 bits que escolhe entre as duas cores e duas cores
+// intermediárias (1/3 e 2/3 do caminho entre elas). As cores são escolhidas
+// sobre o eixo principal da distribuição dos pixels do bloco (autovetor da
+// matriz de covariância, computado por iteração de potência).
+// Veja https://www.khronos.org/opengl/wiki/S3_Texture_Compression
+// ---------------------------------------------------------------------------
+
+static int ClampInt(int value, int min_value, int max_value)
+{
+    return value < min_value ? min_value : (value > max_value ? max_value : value);
+}
+
+static uint16_t PackRgb565(const float color[3])
+{
+    int r = ClampInt((int)std::lround(color[0] * (31.0f / 255.0f)), 0, 31);
+    int g = ClampInt((int)std::lround(color[1] * (63.0f / 255.0f)), 0, 63);
+    int b = ClampInt((int)std::lround(color[2] * (31.0f / 255.0f)), 0, 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+// Expande para 8 bits repetindo os bits mais significativos, como a GPU faz.
+static void UnpackRgb565(uint16_t value, int color[3])
+{
+    int r = (value >> 11) & 31;
+    int g = (value >> 5) & 63;
+    int b = value & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Paleta de quatro cores de um bloco. Se color0 <= color1 o bloco está no
+// modo de três cores, com o índice 3 significando preto.
+static void BC1Palette(uint16_t color0, uint16_t color1, int palette[4][3])
+{
+    UnpackRgb565(color0, palette[0]);
+    UnpackRgb565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        if (color0 > color1)
+        {
+            palette[2][c] = (2*palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2*palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+}
+
+void EncodeBC1Block(const unsigned char pixels[16][3], uint8_t block[TEXTURECACHE_BC1_BLOCK_SIZE])
+{
+    // Média e matriz de covariância (simétrica) das cores do bloco.
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    float min_color[3] = { 255.0f, 255.0f, 255.0f };
+    float max_color[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            mean[c] += pixels[i][c];
+            min_color[c] = std::fmin(min_color[c], pixels[i][c]);
+            max_color[c] = std::fmax(max_color[c], pixels[i][c]);
+        }
+    }
+    for (int c = 0; c < 3; ++c)
+        mean[c] /= 16.0f;
+
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }; // xx xy xz yy yz zz
+    for (int i = 0; i < 16; ++i)
+    {
+        float r = pixels[i][0] - mean[0];
+        float g = pixels[i][1] - mean[1];
+        float b = pixels[i][2] - mean[2];
+        cov[0] += r*r; cov[1] += r*g; cov[2] += r*b;
+        cov[3] += g*g; cov[4] += g*b; cov[5] += b*b;
+    }
+
+    // Iteração de potência, partindo da diagonal da caixa envolvente das
+    // cores (que já é uma boa aproximação na maioria dos blocos).
+    float axis[3] = { max_color[0] - min_color[0], max_color[1] - min_color[1], max_color[2] - min_color[2] };
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[3] = {
+            cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2],
+            cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2],
+            cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2],
+        };
+        float length = std::sqrt(next[0]*next[0] + next[1]*next[1] + next[2]*next[2]);
+        if (length < 1e-6f)
+            break;
+        axis[0] = next[0] / length;
+        axis[1] = next[1] / length;
+        axis[2] = next[2] / length;
+    }
+
+    float endpoints[2][3];
+    float axis_length = std::sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+    if (axis_length < 1e-6f)
+    {
+        // Bloco de cor sólida
+        for (int c = 0; c < 3; ++c)
+            endpoints[0][c] = endpoints[1][c] = mean[c];
+    }
+    else
+    {
+        for (int c = 0; c < 3; ++c)
+            axis[c] /= axis_length;
+
+        float t_min = 0.0f, t_max = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            float t = (pixels[i][0] - mean[0])*axis[0] + (pixels[i][1] - mean[1])*axis[1] + (pixels[i][2] - mean[2])*axis[2];
+            t_min = std::fmin(t_min, t);
+            t_max = std::fmax(t_max, t);
+        }
+
+        // Aproximamos um pouco as extremidades, que ficariam com o erro de
+        // quantização de todo o intervalo.
+        float inset = (t_max - t_min) / 16.0f;
+        t_min += inset;
+        t_max -= inset;
+
+        for (int c = 0; c < 3; ++c)
+        {
+            endpoints[0][c] = mean[c] + axis[c]*t_max;
+            endpoints[1][c] = mean[c] + axis[c]*t_min;
+        }
+    }
+
+    uint16_t color0 = PackRgb565(endpoints[0]);
+    uint16_t color1 = PackRgb565(endpoints[1]);
+    if (color0 < color1)
+    {
+        uint16_t swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+
+    // Com color0 == color1 o bloco estaria no modo de três cores; todos os
+    // índices ficam em zero, que é a própria cor0.
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        BC1Palette(color0, color1, palette);
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0;
+            int best_distance = 0x7FFFFFFF;
+            for (int p = 0; p < 4; ++p)
+            {
+                int dr = pixels[i][0] - palette[p][0];
+                int dg = pixels[i][1] - palette[p][1];
+                int db = pixels[i][2] - palette[p][2];
+                int distance = dr*dr + dg*dg + db*db;
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (2*i);
+        }
+    }
+
+    // Tudo em little-endian, como esperado pela GPU.
+    block[0] = (uint8_t)(color0 & 0xFF);
+    block[1] = (uint8_t)(color0 >> 8);
+    block[2] = (uint8_t)(color1 & 0xFF);
+    block[3] = (uint8_t)(color1 >> 8);
+    block[4] = (uint8_t)(indices & 0xFF);
+    block[5] = (uint8_t)((indices >> 8) & 0xFF);
+    block[6] = (uint8_t)((indices >> 16) & 0xFF);
+    block[7] = (uint8_t)(indices >> 24);
+}
+
+void DecodeBC1Block(const uint8_t block[TEXTURECACHE_BC1_BLOCK_SIZE], unsigned char pixels[16][3])
+{
+    uint16_t color0 = (uint16_t)(block[0] | (block[1] << 8));
+    uint16_t color1 = (uint16_t)(block[2] | (block[3] << 8));
+    uint32_t indices = (uint32_t)block[4] | ((uint32_t)block[5] << 8) | ((uint32_t)block[6] << 16) | ((uint32_t)block[7] << 24);
+
+    int palette[4][3];
+    BC1Palette(color0, color1, palette);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        int p = (indices >> (2*i)) & 3;
+        for (int c = 0; c < 3; ++c)
+            pixels[i][c] = (unsigned char)palette[p][c];
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Geração dos níveis de mipmap
+// ---------------------------------------------------------------------------
+
+// Conversões entre sRGB (8 bits) e intensidade linear em [0,1].
+// Veja https://en.wikipedia.org/wiki/SRGB
+static float SrgbToLinear(unsigned char value)
+{
+    struct Table
+    {
+        float values[256];
+        Table()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                float s = i / 255.0f;
+                values[i] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+            }
+        }
+    };
+    static const Table table; // Inicialização thread-safe em C++11
+    return table.values[value];
+}
+
+static unsigned char LinearToSrgb(float linear)
+{
+    float s = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+    return (unsigned char)ClampInt((int)std::lround(s * 255.0f), 0, 255);
+}
+
+// Reduz uma imagem RGB pela metade em cada dimensão (no mínimo 1 pixel),
+// com a média de 2x2 pixels em espaço linear. Em dimensões ímpares o último
+// pixel é repetido.
+static void DownsampleLevel(const unsigned char* src, uint32_t src_width, uint32_t src_height,
+                            unsigned char* dst, uint32_t dst_width, uint32_t dst_height)
+{
+    ParallelFor(dst_height, 16, [=](size_t begin, size_t end)
+    {
+        for (size_t y = begin; y < end; ++y)
+        {
+            uint32_t y0 = std::min((uint32_t)(2*y), src_height - 1);
+            uint32_t y1 = std::min((uint32_t)(2*y + 1), src_height - 1);
+            for (uint32_t x = 0; x < dst_width; ++x)
+            {
+                uint32_t x0 = std::min(2*x, src_width - 1);
+                uint32_t x1 = std::min(2*x + 1, src_width - 1);
+                const unsigned char* p00 = src + 3*((size_t)y0*src_width + x0);
+                const unsigned char* p01 = src + 3*((size_t)y0*src_width + x1);
+                const unsigned char* p10 = src + 3*((size_t)y1*src_width + x0);
+                const unsigned char* p11 = src + 3*((size_t)y1*src_width + x1);
+                unsigned char* out = dst + 3*((size_t)y*dst_width + x);
+                for (int c = 0; c < 3; ++c)
+                {
+                    float sum = SrgbToLinear(p00[c]) + SrgbToLinear(p01[c]) + SrgbToLinear(p10[c]) + SrgbToLinear(p11[c]);
+                    out[c] = LinearToSrgb(0.25f * sum);
+                }
+            }
+        }
+    });
+}
+
+// Comprime uma imagem RGB inteira em BC1, uma linha de blocos por vez. Os
+// blocos incompletos nas bordas repetem o último pixel.
+static void CompressLevel(const unsigned char* rgb, uint32_t width, uint32_t height, uint8_t* blocks)
+{
+    uint32_t blocks_x = (width + 3) / 4;
+    uint32_t blocks_y = (height + 3) / 4;
+
+    ParallelFor(blocks_y, 4, [=](size_t begin, size_t end)
+    {
+        unsigned char pixels[16][3];
+        for (size_t by = begin; by < end; ++by)
+        {
+            for (uint32_t bx = 0; bx < blocks_x; ++bx)
+            {
+                for (uint32_t i = 0; i < 16; ++i)
+                {
+                    uint32_t x = std::min(4*bx + i % 4, width - 1);
+                    uint32_t y = std::min((uint32_t)(4*by) + i / 4, height - 1);
+                    const unsigned char* p = rgb + 3*((size_t)y*width + x);
+                    pixels[i][0] = p[0];
+                    pixels[i][1] = p[1];
+                    pixels[i][2] = p[2];
+                }
+                EncodeBC1Block(pixels, blocks + (by*blocks_x + bx)*TEXTURECACHE_BC1_BLOCK_SIZE);
+            }
+        }
+    });
+}
+
+void CompressTexture(const unsigned char* rgb, int width, int height, CompressedTexture* texture)
+{
+    texture->format     = TEXTURE_FORMAT_BC1_SRGB;
+    texture->width      = (uint32_t)width;
+    texture->height     = (uint32_t)height;
+    texture->num_levels = 0;
+
+    // Dimensões e posição de cada nível, até 1x1.
+    uint32_t level_width  = texture->width;
+    uint32_t level_height = texture->height;
+    uint32_t offset = 0;
+    while (texture->num_levels < TEXTURECACHE_MAX_LEVELS)
+    {
+        CompressedMipLevel& level = texture->levels[texture->num_levels++];
+        level.width  = level_width;
+        level.height = level_height;
+        level.offset = offset;
+        level.size   = BC1LevelSize(level_width, level_height);
+        offset += level.size;
+
+        if (level_width == 1 && level_height == 1)
+            break;
+        level_width  = std::max(1u, level_width / 2);
+        level_height = std::max(1u, level_height / 2);
+    }
+    texture->data.resize(offset);
+
+    // Cada nível é gerado a partir do anterior. Somente dois níveis
+    // descomprimidos ficam na memória ao mesmo tempo.
+    std::vector<unsigned char> current;
+    std::vector<unsigned char> next;
+    const unsigned char* pixels = rgb;
+    for (uint32_t i = 0; i < texture->num_levels; ++i)
+    {
+        const CompressedMipLevel& level = texture->levels[i];
+        if (i > 0)
+        {
+            const CompressedMipLevel& previous = texture->levels[i - 1];
+            next.resize((size_t)level.width * level.height * 3);
+            DownsampleLevel(pixels, previous.width, previous.height, next.data(), level.width, level.height);
+            current.swap(next);
+            pixels = current.data();
+        }
+        CompressLevel(pixels, level.width, level.height, texture->data.data() + level.offset);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Leitura e escrita do arquivo de cache
+// ---------------------------------------------------------------------------
+
+bool TextureCache_Read(const char* image_filename, CompressedTexture* texture)
+{
+    SourceInfo source;
+    if (!GetSourceInfo(image_filename, &source, false))
+        return false;
+
+    std::string path = CachePath(image_filename);
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == NULL)
+        return false;
+
+    TextureCacheHeader header;
+    bool valid = fread(&header, sizeof(header), 1, f) == 1
+              && memcmp(header.magic, TEXTURECACHE_MAGIC, sizeof(TEXTURECACHE_MAGIC)) == 0
+              && header.version == TEXTURECACHE_VERSION
+              && header.header_size == sizeof(TextureCacheHeader)
+              && header.format == TEXTURE_FORMAT_BC1_SRGB
+              && header.num_levels >= 1
+              && header.num_levels <= TEXTURECACHE_MAX_LEVELS
+              && header.source_size == source.size
+              && header.source_mtime == source.mtime;
+
+    // Os níveis devem ter as dimensões esperadas e caber nos dados.
+    for (uint32_t i = 0; valid && i < header.num_levels; ++i)
+    {
+        const CompressedMipLevel& level = header.levels[i];
+        uint32_t expected_width  = std::max(1u, header.width >> i);
+        uint32_t expected_height = std::max(1u, header.height >> i);
+        valid = level.width == expected_width
+             && level.height == expected_height
+             && level.size == BC1LevelSize(level.width, level.height)
+             && (uint64_t)level.offset + level.size <= header.data_size;
+    }
+
+    // Tamanho e data de modificação coincidem; confirmamos pelo conteúdo.
+    if (valid)
+        valid = GetSourceInfo(image_filename, &source, true) && header.source_hash == source.hash;
+
+    if (valid)
+    {
+        texture->data.resize((size_t)header.data_size);
+        valid = header.data_size == 0 || fread(texture->data.data(), (size_t)header.data_size, 1, f) == 1;
+    }
+
+    fclose(f);
+
+    if (!valid)
+    {
+        texture->data.clear();
+        return false;
+    }
+
+    texture->format     = header.format;
+    texture->width      = header.width;
+    texture->height     = header.height;
+    texture->num_levels = header.num_levels;
+    memcpy(texture->levels, header.levels, sizeof(header.levels));
+    return true;
+}
+
+bool TextureCache_Write(const char* image_filename, const CompressedTexture& texture)
+{
+    SourceInfo source;
+    if (!GetSourceInfo(image_filename, &source, true))
+        return false;
+
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TEXTURECACHE_MAGIC, sizeof(TEXTURECACHE_MAGIC));
+    header.version      = TEXTURECACHE_VERSION;
+    header.header_size  = sizeof(TextureCacheHeader);
+    header.source_size  = source.size;
+    header.source_mtime = source.mtime;
+    header.source_hash  = source.hash;
+    header.format       = texture.format;
+    header.width        = texture.width;
+    header.height       = texture.height;
+    header.num_levels   = texture.num_levels;
+    memcpy(header.levels, texture.levels, sizeof(header.levels));
+    header.data_size    = texture.data.size();
+
+    // Escrevemos em um arquivo temporário e depois o renomeamos, para que uma
+    // execução interrompida nunca deixe um cache pela metade.
+    std::string path = CachePath(image_filename);
+    std::string tmp_path = path + ".tmp";
+
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "WARNING: Cannot write texture cache \"%s\".\n", path.c_str());
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+           && (texture.data.empty() || fwrite(texture.data.data(), texture.data.size(), 1, f) == 1);
+
+    ok = (fclose(f) == 0) && ok;
+
+    if (ok)
+    {
+        remove(path.c_str());
+        ok = rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+
+    if (!ok)
+    {
+        remove(tmp_path.c_str());
+        fprintf(stderr, "WARNING: Cannot write texture cache \"%s\".\n", path.c_str());
+    }
+
+    return ok;
+}
@@ -0,0 +1,437 @@
+#include "../include/texturestreaming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// Estado de uma textura. Os níveis [resident_level, num_levels) estão
+// prontos na GPU; se allocated_level < resident_level, o nível
+// allocated_level está sendo enviado e "uploaded_rows" linhas de blocos já
+// foram copiadas.
+struct StreamedTexture
+{
+    GLuint            texture_id;
+    CompressedTexture source;            // Todos os níveis, na memória da CPU
+    uint32_t          initial_level;     // Níveis a partir deste nunca são descartados
+    uint32_t          resident_level;    // Valor de GL_TEXTURE_BASE_LEVEL
+    uint32_t          allocated_level;
+    uint32_t          uploaded_rows;
+    uint32_t          wanted_level;      // Nível pedido no quadro atual
+    bool              requested;         // Algum pedido no quadro atual?
+    uint64_t          last_request_frame;
+};
+
+// Uma cópia de linhas de blocos do PBO do quadro para um nível de uma textura.
+struct PendingCopy
+{
+    uint32_t texture;
+    uint32_t level;
+    uint32_t first_row;
+    uint32_t num_rows;
+    size_t   offset;   // Posição dentro do PBO
+    size_t   size;
+};
+
+static std::vector<StreamedTexture> g_Textures;
+static GLuint   g_PixelBuffers[TEXTURESTREAMING_PBO_COUNT];
+static GLsync   g_Fences[TEXTURESTREAMING_PBO_COUNT];
+static uint32_t g_NextPixelBuffer = 0;
+static size_t   g_UploadBytesPerFrame = 0;
+static uint64_t g_Frame = 0;
+static TextureStreamingStats g_Stats;
+
+static size_t LevelSize(const StreamedTexture& texture, uint32_t level)
+{
+    return texture.source.levels[level].size;
+}
+
+static uint32_t LevelBlockRows(const StreamedTexture& texture, uint32_t level)
+{
+    return (texture.source.levels[level].height + 3) / 4;
+}
+
+static size_t LevelRowSize(const StreamedTexture& texture, uint32_t level)
+{
+    return ((texture.source.levels[level].width + 3) / 4) * TEXTURECACHE_BC1_BLOCK_SIZE;
+}
+
+// As funções abaixo assumem que a textura está ligada em GL_TEXTURE_2D.
+
+static void UploadLevel(const StreamedTexture& texture, uint32_t level, const void* data)
+{
+    const CompressedMipLevel& mip = texture.source.levels[level];
+    glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,
+                           (GLsizei)mip.width, (GLsizei)mip.height, 0, (GLsizei)mip.size, data);
+}
+
+// Libera a memória de um nível redefinindo-o com tamanho 0x0. Níveis abaixo
+// de GL_TEXTURE_BASE_LEVEL não participam da completude da textura, então
+// isso não afeta a amostragem.
+static void FreeLevel(uint32_t level)
+{
+    glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGB8, 0, 0, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+}
+
+void TextureStreaming_Init(size_t budget_bytes, size_t upload_bytes_per_frame)
+{
+    memset(&g_Stats, 0, sizeof(g_Stats));
+    g_Stats.budget_bytes = budget_bytes;
+
+    // Cada quadro envia pelo menos uma linha de blocos, e a maior linha
+    // possível (32768 pixels de largura) tem 64 KB.
+    g_UploadBytesPerFrame = std::max<size_t>(upload_bytes_per_frame, 64*1024);
+    g_NextPixelBuffer = 0;
+    g_Frame = 0;
+
+    glGenBuffers(TEXTURESTREAMING_PBO_COUNT, g_PixelBuffers);
+    for (int i = 0; i < TEXTURESTREAMING_PBO_COUNT; ++i)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_PixelBuffers[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)g_UploadBytesPerFrame, NULL, GL_STREAM_DRAW);
+        g_Fences[i] = 0;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreaming_Shutdown()
+{
+    for (size_t i = 0; i < g_Textures.size(); ++i)
+        glDeleteTextures(1, &g_Textures[i].texture_id);
+    g_Textures.clear();
+
+    for (int i = 0; i < TEXTURESTREAMING_PBO_COUNT; ++i)
+    {
+        if (g_Fences[i] != 0)
+            glDeleteSync(g_Fences[i]);
+        g_Fences[i] = 0;
+    }
+    glDeleteBuffers(TEXTURESTREAMING_PBO_COUNT, g_PixelBuffers);
+}
+
+void TextureStreaming_SetBudget(size_t budget_bytes)
+{
+    g_Stats.budget_bytes = budget_bytes;
+}
+
+StreamedTextureHandle TextureStreaming_Add(CompressedTexture* texture, GLuint* texture_id)
+{
+    StreamedTexture streamed;
+    streamed.source = std::move(*texture);
+
+    // Primeiro nível pequeno o suficiente para ser enviado imediatamente.
+    const CompressedTexture& source = streamed.source;
+    uint32_t initial_level = source.num_levels - 1;
+    for (uint32_t i = 0; i < source.num_levels; ++i)
+    {
+        if (std::max(source.levels[i].width, source.levels[i].height) <= TEXTURESTREAMING_INITIAL_SIZE)
+        {
+            initial_level = i;
+            break;
+        }
+    }
+
+    streamed.initial_level      = initial_level;
+    streamed.resident_level     = initial_level;
+    streamed.allocated_level    = initial_level;
+    streamed.uploaded_rows      = 0;
+    streamed.wanted_level       = initial_level;
+    streamed.requested          = false;
+    streamed.last_request_frame = g_Frame;
+
+    glGenTextures(1, &streamed.texture_id);
+    glBindTexture(GL_TEXTURE_2D, streamed.texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)initial_level);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)source.num_levels - 1);
+
+    for (uint32_t i = initial_level; i < source.num_levels; ++i)
+    {
+        UploadLevel(streamed, i, source.data.data() + source.levels[i].offset);
+        g_Stats.resident_bytes += LevelSize(streamed, i);
+    }
+
+    *texture_id = streamed.texture_id;
+    g_Textures.push_back(std::move(streamed));
+    return (StreamedTextureHandle)(g_Textures.size() - 1);
+}
+
+void TextureStreaming_Request(StreamedTextureHandle handle, float uv_per_pixel)
+{
+    StreamedTexture& texture = g_Textures[handle];
+
+    // Com N texels do nível 0 por pixel, o nível floor(log2(N)) ainda tem
+    // pelo menos um texel por pixel.
+    float texels_per_pixel = uv_per_pixel * (float)std::max(texture.source.width, texture.source.height);
+    uint32_t level = 0;
+    if (texels_per_pixel > 1.0f)
+        level = (uint32_t)std::floor(std::log2(texels_per_pixel));
+    level = std::min(level, texture.initial_level);
+
+    if (!texture.requested || level < texture.wanted_level)
+        texture.wanted_level = level;
+    texture.requested = true;
+    texture.last_request_frame = g_Frame;
+}
+
+// Descarta o nível mais detalhado de uma textura que tenha mais detalhe do
+// que o pedido, escolhendo a utilizada há mais tempo. Retorna false se não
+// há nada que possa ser descartado.
+static bool EvictOneLevel(uint32_t except)
+{
+    uint32_t best = (uint32_t)g_Textures.size();
+    for (uint32_t i = 0; i < g_Textures.size(); ++i)
+    {
+        const StreamedTexture& texture = g_Textures[i];
+        bool surplus = texture.resident_level < texture.wanted_level
+                    && texture.allocated_level == texture.resident_level;
+        if (i == except || !surplus)
+            continue;
+
+        if (best == g_Textures.size()
+            || texture.last_request_frame < g_Textures[best].last_request_frame
+            || (texture.last_request_frame == g_Textures[best].last_request_frame
+                && LevelSize(texture, texture.resident_level) > LevelSize(g_Textures[best], g_Textures[best].resident_level)))
+        {
+            best = i;
+        }
+    }
+
+    if (best == g_Textures.size())
+        return false;
+
+    StreamedTexture& texture = g_Textures[best];
+    uint32_t level = texture.resident_level;
+    glBindTexture(GL_TEXTURE_2D, texture.texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)(level + 1));
+    FreeLevel(level);
+
+    texture.resident_level  = level + 1;
+    texture.allocated_level = level + 1;
+    g_Stats.resident_bytes -= LevelSize(texture, level);
+    g_Stats.evictions += 1;
+    return true;
+}
+
+// Próxima textura que deve receber dados: primeiro uma que já está no meio
+// de um envio; senão, a que está mais longe do nível pedido (em caso de
+// empate, a de próximo nível menor, que fica pronta antes).
+static uint32_t NextTextureToUpload(const std::vector<bool>& skip)
+{
+    uint32_t best = (uint32_t)g_Textures.size();
+    for (uint32_t i = 0; i < g_Textures.size(); ++i)
+    {
+        const StreamedTexture& texture = g_Textures[i];
+        if (skip[i])
+            continue;
+        if (texture.allocated_level < texture.resident_level)
+            return i;
+        if (texture.wanted_level >= texture.resident_level)
+            continue;
+
+        if (best == g_Textures.size())
+        {
+            best = i;
+            continue;
+        }
+
+        const StreamedTexture& other = g_Textures[best];
+        uint32_t gap = texture.resident_level - texture.wanted_level;
+        uint32_t other_gap = other.resident_level - other.wanted_level;
+        if (gap > other_gap
+            || (gap == other_gap && LevelSize(texture, texture.resident_level - 1) < LevelSize(other, other.resident_level - 1)))
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Escolhe as cópias deste quadro, limitadas a "g_UploadBytesPerFrame" bytes,
+// alocando na GPU os níveis que começam a ser enviados.
+static void PlanCopies(std::vector<PendingCopy>* copies)
+{
+    std::vector<bool> skip(g_Textures.size(), false);
+    size_t used = 0;
+
+    while (used < g_UploadBytesPerFrame)
+    {
+        uint32_t index = NextTextureToUpload(skip);
+        if (index == g_Textures.size())
+            break;
+
+        StreamedTexture& texture = g_Textures[index];
+        if (texture.allocated_level == texture.resident_level)
+        {
+            // Novo nível: precisa caber no orçamento de memória de vídeo.
+            uint32_t level = texture.resident_level - 1;
+            size_t size = LevelSize(texture, level);
+            while (g_Stats.resident_bytes + size > g_Stats.budget_bytes && EvictOneLevel(index))
+                ;
+            if (g_Stats.resident_bytes + size > g_Stats.budget_bytes)
+            {
+                skip[index] = true;
+                continue;
+            }
+
+            glBindTexture(GL_TEXTURE_2D, texture.texture_id);
+            UploadLevel(texture, level, NULL);
+            texture.allocated_level = level;
+            texture.uploaded_rows = 0;
+            g_Stats.resident_bytes += size;
+        }
+
+        uint32_t level = texture.allocated_level;
+        size_t row_size = LevelRowSize(texture, level);
+        uint32_t rows_left = LevelBlockRows(texture, level) - texture.uploaded_rows;
+        uint32_t rows = (uint32_t)std::min<size_t>(rows_left, (g_UploadBytesPerFrame - used) / row_size);
+        if (rows == 0)
+            break;
+
+        PendingCopy copy;
+        copy.texture   = index;
+        copy.level     = level;
+        copy.first_row = texture.uploaded_rows;
+        copy.num_rows  = rows;
+        copy.offset    = used;
+        copy.size      = rows * row_size;
+        copies->push_back(copy);
+
+        texture.uploaded_rows += rows;
+        used += copy.size;
+
+        // Cada textura recebe no máximo um trecho por quadro; o nível só é
+        // marcado como pronto depois que as cópias forem enviadas.
+        skip[index] = true;
+    }
+}
+
+void TextureStreaming_Update()
+{
+    g_Frame += 1;
+    g_Stats.uploaded_bytes = 0;
+
+    GLint previous_texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+
+    for (size_t i = 0; i < g_Textures.size(); ++i)
+    {
+        StreamedTexture& texture = g_Textures[i];
+        if (!texture.requested)
+            texture.wanted_level = texture.initial_level;
+    }
+
+    // Se o orçamento diminuiu, descartamos o excesso imediatamente.
+    while (g_Stats.resident_bytes > g_Stats.budget_bytes && EvictOneLevel((uint32_t)g_Textures.size()))
+        ;
+
+    // O PBO deste quadro só pode ser reescrito quando a GPU terminou de ler
+    // as cópias feitas com ele; se ainda não terminou, não esperamos.
+    uint32_t buffer = g_NextPixelBuffer;
+    bool buffer_free = true;
+    if (g_Fences[buffer] != 0)
+    {
+        GLenum status = glClientWaitSync(g_Fences[buffer], 0, 0);
+        buffer_free = (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED);
+        if (buffer_free)
+        {
+            glDeleteSync(g_Fences[buffer]);
+            g_Fences[buffer] = 0;
+        }
+    }
+
+    std::vector<PendingCopy> copies;
+    if (buffer_free)
+        PlanCopies(&copies);
+
+    if (!copies.empty())
+    {
+        const PendingCopy& last = copies.back();
+        size_t total = last.offset + last.size;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_PixelBuffers[buffer]);
+        uint8_t* mapped = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)total,
+                                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        bool filled = false;
+        if (mapped != NULL)
+        {
+            for (size_t i = 0; i < copies.size(); ++i)
+            {
+                const PendingCopy& copy = copies[i];
+                const StreamedTexture& texture = g_Textures[copy.texture];
+                const uint8_t* source = texture.source.data.data() + texture.source.levels[copy.level].offset
+                                      + copy.first_row * LevelRowSize(texture, copy.level);
+                memcpy(mapped + copy.offset, source, copy.size);
+            }
+            // GL_FALSE: o conteúdo do buffer foi corrompido enquanto mapeado.
+            filled = (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE);
+        }
+
+        if (!filled)
+        {
+            // O conteúdo do PBO é indefinido: nada é copiado, e as linhas
+            // planejadas voltam a ser pendentes para um próximo quadro. O
+            // nível continua alocado e "resident_level" não muda.
+            for (size_t i = 0; i < copies.size(); ++i)
+                g_Textures[copies[i].texture].uploaded_rows = copies[i].first_row;
+            copies.clear();
+        }
+
+        for (size_t i = 0; i < copies.size(); ++i)
+        {
+            const PendingCopy& copy = copies[i];
+            StreamedTexture& texture = g_Textures[copy.texture];
+            const CompressedMipLevel& mip = texture.source.levels[copy.level];
+            uint32_t y = copy.first_row * 4;
+            uint32_t height = std::min(copy.num_rows * 4, mip.height - y);
+
+            glBindTexture(GL_TEXTURE_2D, texture.texture_id);
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)copy.level, 0, (GLint)y, (GLsizei)mip.width, (GLsizei)height,
+                                      GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, (GLsizei)copy.size, (const void*)copy.offset);
+
+            // Nível completo: pode ser amostrado a partir de agora.
+            if (texture.uploaded_rows == LevelBlockRows(texture, copy.level))
+            {
+                texture.resident_level = copy.level;
+                texture.uploaded_rows = 0;
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)copy.level);
+            }
+            g_Stats.uploaded_bytes += copy.size;
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (filled)
+        {
+            g_Fences[buffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            g_NextPixelBuffer = (buffer + 1) % TEXTURESTREAMING_PBO_COUNT;
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, (GLuint)previous_texture);
+
+    // Estatísticas e fim do quadro.
+    g_Stats.num_textures    = (uint32_t)g_Textures.size();
+    g_Stats.levels_resident = 0;
+    g_Stats.levels_total    = 0;
+    g_Stats.full_bytes      = 0;
+    g_Stats.pending_bytes   = 0;
+    for (size_t i = 0; i < g_Textures.size(); ++i)
+    {
+        StreamedTexture& texture = g_Textures[i];
+        g_Stats.levels_resident += texture.source.num_levels - texture.resident_level;
+        g_Stats.levels_total    += texture.source.num_levels;
+        g_Stats.full_bytes      += texture.source.data.size();
+
+        for (uint32_t level = texture.wanted_level; level < texture.resident_level; ++level)
+            g_Stats.pending_bytes += LevelSize(texture, level);
+        if (texture.allocated_level < texture.resident_level)
+            g_Stats.pending_bytes -= std::min(g_Stats.pending_bytes, texture.uploaded_rows * LevelRowSize(texture, texture.allocated_level));
+
+        texture.requested = false;
+    }
+}
+
+const TextureStreamingStats& TextureStreaming_Stats()
+{
+    return g_Stats;
+}
@@ -0,0 +1,44 @@
+#include "../include/timestep.h"
+
+#include <algorithm>
+
+void FixedTimestep_Init(FixedTimestep* timestep, double steps_per_second, int max_steps_per_frame)
+{
+    timestep->step              = 1.0 / std::max(steps_per_second, 1.0);
+    timestep->max_steps         = std::max(max_steps_per_frame, 1);
+    timestep->accumulator       = 0.0;
+    timestep->last_time         = -1.0;
+    timestep->num_steps         = 0;
+    timestep->num_dropped_steps = 0;
+}
+
+int FixedTimestep_Advance(FixedTimestep* timestep, double now)
+{
+    if (timestep->last_time < 0.0)
+    {
+        timestep->last_time = now;
+        return 0;
+    }
+
+    double elapsed = std::max(now - timestep->last_time, 0.0);
+    timestep->last_time = now;
+    timestep->accumulator += elapsed;
+
+    double pending = timestep->accumulator / timestep->step;
+    if (pending > (double)timestep->max_steps)
+    {
+        uint64_t dropped = (uint64_t)pending - (uint64_t)timestep->max_steps;
+        timestep->num_dropped_steps += dropped;
+        timestep->accumulator -= dropped * timestep->step;
+    }
+
+    int steps = std::min((int)(timestep->accumulator / timestep->step), timestep->max_steps);
+    timestep->accumulator = std::max(timestep->accumulator - steps * timestep->step, 0.0);
+    timestep->num_steps += steps;
+    return steps;
+}
+
+float FixedTimestep_Alpha(const FixedTimestep& timestep)
+{
+    return (float)std::min(timestep.accumulator / timestep.step, 1.0);
+}
@@ -0,0 +1,143 @@
+#include "../include/vertexformat.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex deve ter 20 bytes");
+
+const VertexFormat VERTEX_FORMAT_PACKED = {
+    "packed",
+    sizeof(PackedVertex),
+    3,
+    {
+        { ATTRIB_POSITION, 3, GL_FLOAT,              GL_FALSE, offsetof(PackedVertex, position) },
+        { ATTRIB_NORMAL,   4, GL_INT_2_10_10_10_REV, GL_TRUE,  offsetof(PackedVertex, normal)   },
+        { ATTRIB_TEXCOORD, 2, GL_HALF_FLOAT,         GL_FALSE, offsetof(PackedVertex, texcoord) },
+    }
+};
+
+void VertexFormat_Apply(const VertexFormat& format)
+{
+    for (int i = 0; i < format.num_attributes; ++i)
+    {
+        const VertexAttribute& attribute = format.attributes[i];
+        glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+                              format.stride, (void*)(size_t)attribute.offset);
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
+
+std::string VertexFormat_ShaderDefines()
+{
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+             "#define ATTRIB_POSITION %d\n"
+             "#define ATTRIB_COLOR %d\n"
+             "#define ATTRIB_TEXCOORD %d\n"
+             "#define ATTRIB_NORMAL %d\n"
+             "#define ATTRIB_INSTANCE_MODEL %d\n"
+             "#define ATTRIB_INSTANCE_NORMAL_MATRIX %d\n",
+             ATTRIB_POSITION, ATTRIB_COLOR, ATTRIB_TEXCOORD, ATTRIB_NORMAL,
+             ATTRIB_INSTANCE_MODEL, ATTRIB_INSTANCE_NORMAL_MATRIX);
+    return buffer;
+}
+
+// Converte um valor em [-1,1] para um inteiro com sinal de "bits" bits.
+static uint32_t PackSnorm(float value, int bits)
+{
+    const float max_value = (float)((1 << (bits - 1)) - 1);
+    value = std::fmax(-1.0f, std::fmin(1.0f, value));
+    int32_t integer = (int32_t)std::lround(value * max_value);
+    return (uint32_t)integer & ((1u << bits) - 1);
+}
+
+// Layout de GL_INT_2_10_10_10_REV: X nos bits 0-9, Y nos bits 10-19, Z nos
+// bits 20-29 e W nos bits 30-31. W fica em zero (normal é um vetor).
+uint32_t PackNormal_Int2_10_10_10(float x, float y, float z)
+{
+    return PackSnorm(x, 10) | (PackSnorm(y, 10) << 10) | (PackSnorm(z, 10) << 20);
+}
+
+// Conversão de float (IEEE 754 binary32) para half-float (binary16), com
+// arredondamento para o mais próximo.
+uint16_t PackHalfFloat(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign     = (bits >> 16) & 0x8000u;
+    int32_t  exponent = (int32_t)((bits >> 23) & 0xFFu) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+
+    // NaN e infinito
+    if (((bits >> 23) & 0xFFu) == 0xFFu)
+        return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+
+    // Grande demais: infinito
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7C00u);
+
+    // Pequeno demais: número subnormal ou zero
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+            return (uint16_t)sign;
+
+        mantissa |= 0x800000u;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1u)))
+            half += 1;
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+        half += 1; // Pode transbordar para o expoente, o que é correto.
+    return (uint16_t)half;
+}
+
+float UnpackHalfFloat(uint16_t value)
+{
+    uint32_t sign     = (uint32_t)(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1Fu;
+    uint32_t mantissa = value & 0x3FFu;
+    uint32_t bits;
+
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Subnormal: normalizamos a mantissa
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400u) == 0)
+            {
+                mantissa <<= 1;
+                exponent -= 1;
+            }
+            mantissa &= 0x3FFu;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    }
+    else if (exponent == 31)
+    {
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}